@@ -21,6 +21,8 @@
 #include "xenia/base/threading.h"
 #include "xenia/emulator.h"
 #include "xenia/gpu/graphics_system.h"
+#include "xenia/kernel/kernel_flags.h"
+#include "xenia/kernel/util/kernel_export_stats.h"
 #include "xenia/ui/file_picker.h"
 #include "xenia/ui/imgui_dialog.h"
 #include "xenia/ui/imgui_drawer.h"
@@ -119,6 +121,9 @@ bool EmulatorWindow::Initialize() {
       case 0x74: {  // VK_F5
         GpuClearCaches();
       } break;
+      case 0x75: {  // VK_F6
+        CpuDumpKernelExportStats();
+      } break;
       case 0x76: {  // VK_F7
         // Save to file
         // TODO: Choose path based on user input, or from options
@@ -233,6 +238,12 @@ bool EmulatorWindow::Initialize() {
         "Ctrl+Pause/Break",
         std::bind(&EmulatorWindow::CpuBreakIntoHostDebugger, this)));
   }
+  cpu_menu->AddChild(MenuItem::Create(MenuItem::Type::kSeparator));
+  {
+    cpu_menu->AddChild(MenuItem::Create(
+        MenuItem::Type::kString, "&Dump Kernel Export Stats", "F6",
+        std::bind(&EmulatorWindow::CpuDumpKernelExportStats, this)));
+  }
   main_menu->AddChild(std::move(cpu_menu));
 
   // GPU menu.
@@ -404,6 +415,14 @@ void EmulatorWindow::CpuBreakIntoDebugger() {
 
 void EmulatorWindow::CpuBreakIntoHostDebugger() { xe::debugging::Break(); }
 
+void EmulatorWindow::CpuDumpKernelExportStats() {
+  std::filesystem::path path = cvars::kernel_export_stats_path;
+  if (path.empty()) {
+    path = "kernel_export_stats.csv";
+  }
+  xe::kernel::util::KernelExportStats::DumpReport(path);
+}
+
 void EmulatorWindow::GpuTraceFrame() {
   emulator()->graphics_system()->RequestFrameTrace();
 }
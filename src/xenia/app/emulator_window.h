@@ -54,6 +54,7 @@ class EmulatorWindow {
   void CpuTimeScalarSetDouble();
   void CpuBreakIntoDebugger();
   void CpuBreakIntoHostDebugger();
+  void CpuDumpKernelExportStats();
   void GpuTraceFrame();
   void GpuClearCaches();
   void ShowHelpWebsite();
@@ -0,0 +1,321 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "third_party/fmt/include/fmt/format.h"
+#include "xenia/base/clock.h"
+#include "xenia/base/cvar.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/main.h"
+#include "xenia/base/math.h"
+#include "xenia/base/memory.h"
+#include "xenia/base/threading.h"
+
+DEFINE_string(bench, "all",
+              "Benchmark to run: [all, sleep, park, copy_and_swap].",
+              "General");
+DEFINE_int32(bench_sleep_time_ms, 200,
+             "Approximate time spent on each sleep or wait duration, in "
+             "milliseconds.",
+             "General");
+DEFINE_int32(bench_park_iterations, 100000,
+             "Number of lock handoffs or acquisitions timed for each park "
+             "benchmark configuration.",
+             "General");
+DEFINE_int32(bench_copy_megabytes, 1024,
+             "Amount of data each copy_and_swap kernel processes at each "
+             "buffer size, in megabytes.",
+             "General");
+
+namespace xe {
+namespace base {
+
+static double TicksToMicroseconds(uint64_t ticks) {
+  return double(ticks) * 1000000.0 / double(Clock::QueryHostTickFrequency());
+}
+
+// Measures how long sleeps and timed out waits actually take compared to what
+// was asked for, and how much CPU time they burn doing it.
+static void BenchmarkSleep() {
+  static const std::chrono::microseconds durations[] = {
+      std::chrono::microseconds(50),   std::chrono::microseconds(200),
+      std::chrono::microseconds(500),  std::chrono::microseconds(1000),
+      std::chrono::microseconds(2000), std::chrono::microseconds(5000),
+  };
+  static const threading::WaitPrecision precisions[] = {
+      threading::WaitPrecision::kCoarse,
+      threading::WaitPrecision::kPrecise,
+  };
+  // Never signaled, so every wait times out.
+  auto event = threading::Event::CreateAutoResetEvent(false);
+
+  fmt::print("{:<6} {:<8} {:>8} {:>6} {:>10} {:>10} {:>10} {:>6}\n", "op",
+             "mode", "want us", "count", "mean us", "median us", "max us",
+             "cpu %");
+  for (int op = 0; op < 2; ++op) {
+    for (threading::WaitPrecision precision : precisions) {
+      for (std::chrono::microseconds duration : durations) {
+        int32_t count = std::max(
+            int32_t(std::chrono::milliseconds(cvars::bench_sleep_time_ms) /
+                    duration),
+            int32_t(10));
+        std::vector<double> actual_us;
+        actual_us.reserve(count);
+        std::clock_t start_clock = std::clock();
+        uint64_t start_ticks = Clock::QueryHostTickCount();
+        for (int32_t i = 0; i < count; ++i) {
+          uint64_t sleep_start_ticks = Clock::QueryHostTickCount();
+          if (op == 0) {
+            threading::Sleep(duration, precision);
+          } else {
+            threading::Wait(event.get(), false, duration, precision);
+          }
+          actual_us.push_back(TicksToMicroseconds(Clock::QueryHostTickCount() -
+                                                  sleep_start_ticks));
+        }
+        double total_us =
+            TicksToMicroseconds(Clock::QueryHostTickCount() - start_ticks);
+        double cpu_us = double(std::clock() - start_clock) * 1000000.0 /
+                        double(CLOCKS_PER_SEC);
+        std::sort(actual_us.begin(), actual_us.end());
+        fmt::print(
+            "{:<6} {:<8} {:>8} {:>6} {:>10.1f} {:>10.1f} {:>10.1f} {:>6.1f}\n",
+            op == 0 ? "sleep" : "wait",
+            precision == threading::WaitPrecision::kCoarse ? "coarse"
+                                                           : "precise",
+            duration.count(), count, total_us / count,
+            actual_us[actual_us.size() / 2], actual_us.back(),
+            cpu_us * 100.0 / total_us);
+      }
+    }
+  }
+}
+
+// Blocking primitive that the park benchmark waits on when a lock is
+// contended: either the ParkingLot or one auto-reset event per lock, which is
+// what a lazily created kernel event comes down to on the host.
+class ParkBenchWaiter {
+ public:
+  explicit ParkBenchWaiter(bool use_parking_lot)
+      : use_parking_lot_(use_parking_lot) {
+    if (!use_parking_lot_) {
+      event_ = threading::Event::CreateAutoResetEvent(false);
+    }
+  }
+  void Wait() {
+    if (use_parking_lot_) {
+      threading::ParkingLot::Park(uintptr_t(this));
+    } else {
+      threading::Wait(event_.get(), false);
+    }
+  }
+  void Wake() {
+    if (use_parking_lot_) {
+      threading::ParkingLot::Unpark(uintptr_t(this));
+    } else {
+      event_->Set();
+    }
+  }
+
+ private:
+  bool use_parking_lot_;
+  std::unique_ptr<threading::Event> event_;
+};
+
+// Lock with the same protocol as the guest RTL_CRITICAL_SECTION: lock_count
+// is -1 when free, and every thread that fails to take it increments it and
+// waits for a handoff from the owner.
+class ParkBenchLock {
+ public:
+  ParkBenchLock(bool use_parking_lot, int32_t spin_count)
+      : waiter_(use_parking_lot), spin_count_(spin_count) {}
+  void Enter() {
+    for (int32_t i = 0; i < spin_count_; ++i) {
+      int32_t expected = -1;
+      if (lock_count_.compare_exchange_weak(expected, 0)) {
+        return;
+      }
+    }
+    if (lock_count_.fetch_add(1) != -1) {
+      waiter_.Wait();
+    }
+  }
+  void Leave() {
+    if (lock_count_.fetch_sub(1) != 0) {
+      waiter_.Wake();
+    }
+  }
+
+ private:
+  ParkBenchWaiter waiter_;
+  int32_t spin_count_;
+  std::atomic<int32_t> lock_count_ = {-1};
+};
+
+// Measures how fast contended locks hand off between threads when waiters
+// park on the ParkingLot, compared to waiting on a per-lock event.
+static void BenchmarkPark() {
+  int32_t iterations = std::max(cvars::bench_park_iterations, 1);
+
+  // Two threads waking each other in turn, so every handoff blocks.
+  fmt::print("ping-pong, {} round trips\n", iterations);
+  fmt::print("{:<12} {:>12} {:>14}\n", "waiter", "us/trip", "trips/s");
+  for (int use_parking_lot = 1; use_parking_lot >= 0; --use_parking_lot) {
+    ParkBenchWaiter ping(use_parking_lot != 0), pong(use_parking_lot != 0);
+    uint64_t start_ticks = Clock::QueryHostTickCount();
+    std::thread ponger([&]() {
+      for (int32_t i = 0; i < iterations; ++i) {
+        ping.Wait();
+        pong.Wake();
+      }
+    });
+    for (int32_t i = 0; i < iterations; ++i) {
+      ping.Wake();
+      pong.Wait();
+    }
+    ponger.join();
+    double total_us =
+        TicksToMicroseconds(Clock::QueryHostTickCount() - start_ticks);
+    fmt::print("{:<12} {:>12.2f} {:>14.0f}\n",
+               use_parking_lot ? "parking lot" : "event", total_us / iterations,
+               iterations * 1000000.0 / total_us);
+  }
+
+  // Threads hammering a single lock with a short critical section.
+  static const int32_t spin_counts[] = {0, 1024};
+  static const uint32_t thread_counts[] = {1, 2, 4, 8};
+  fmt::print("\ncontended lock, {} acquisitions per thread\n", iterations);
+  fmt::print("{:<12} {:>6} {:>8} {:>14}\n", "waiter", "spin", "threads",
+             "acquires/s");
+  for (int32_t spin_count : spin_counts) {
+    for (int use_parking_lot = 1; use_parking_lot >= 0; --use_parking_lot) {
+      for (uint32_t thread_count : thread_counts) {
+        ParkBenchLock lock(use_parking_lot != 0, spin_count);
+        uint64_t shared_value = 0;
+        uint64_t start_ticks = Clock::QueryHostTickCount();
+        std::vector<std::thread> threads;
+        for (uint32_t i = 0; i < thread_count; ++i) {
+          threads.emplace_back([&]() {
+            for (int32_t j = 0; j < iterations; ++j) {
+              lock.Enter();
+              shared_value = shared_value * 6364136223846793005ull + 1;
+              lock.Leave();
+            }
+          });
+        }
+        for (std::thread& thread : threads) {
+          thread.join();
+        }
+        double total_us =
+            TicksToMicroseconds(Clock::QueryHostTickCount() - start_ticks);
+        fmt::print("{:<12} {:>6} {:>8} {:>14.0f}\n",
+                   use_parking_lot ? "parking lot" : "event", spin_count,
+                   thread_count,
+                   double(iterations) * thread_count * 1000000.0 / total_us);
+      }
+    }
+  }
+}
+
+// Measures the throughput of the copy_and_swap kernels over buffers from
+// cache-resident to much larger than the last level cache.
+static void BenchmarkCopyAndSwap() {
+  struct Kernel {
+    const char* name;
+    void (*function)(void* dest, const void* src, size_t count);
+    size_t element_size;
+    bool aligned;
+  };
+  static const Kernel kernels[] = {
+      {"16_aligned", copy_and_swap_16_aligned, 2, true},
+      {"16_unaligned", copy_and_swap_16_unaligned, 2, false},
+      {"32_aligned", copy_and_swap_32_aligned, 4, true},
+      {"32_unaligned", copy_and_swap_32_unaligned, 4, false},
+      {"64_aligned", copy_and_swap_64_aligned, 8, true},
+      {"64_unaligned", copy_and_swap_64_unaligned, 8, false},
+      {"16_in_32_aligned", copy_and_swap_16_in_32_aligned, 4, true},
+      {"16_in_32_unaligned", copy_and_swap_16_in_32_unaligned, 4, false},
+  };
+  static const size_t sizes[] = {
+      size_t(4) << 10,
+      size_t(64) << 10,
+      size_t(1) << 20,
+      size_t(16) << 20,
+  };
+  const size_t kMaxSize = sizes[xe::countof(sizes) - 1];
+  // Extra space so that unaligned kernels can be given odd addresses.
+  std::vector<uint8_t> src(kMaxSize + 64), dest(kMaxSize + 64);
+  for (size_t i = 0; i < src.size(); ++i) {
+    src[i] = uint8_t(i);
+  }
+
+  fmt::print("{:<20}", "kernel GB/s");
+  for (size_t size : sizes) {
+    fmt::print(" {:>10}", fmt::format("{} KB", size >> 10));
+  }
+  fmt::print("\n");
+  uint64_t total_bytes = uint64_t(std::max(cvars::bench_copy_megabytes, 1))
+                         << 20;
+  for (const Kernel& kernel : kernels) {
+    fmt::print("{:<20}", kernel.name);
+    // 64-byte aligned, or off by one element.
+    size_t offset = kernel.aligned ? 0 : kernel.element_size + 1;
+    for (size_t size : sizes) {
+      size_t count = size / kernel.element_size;
+      uint64_t iterations = std::max(total_bytes / size, uint64_t(1));
+      // Warm up the caches and the page mappings of the output.
+      kernel.function(dest.data() + offset, src.data() + offset, count);
+      uint64_t start_ticks = Clock::QueryHostTickCount();
+      for (uint64_t i = 0; i < iterations; ++i) {
+        kernel.function(dest.data() + offset, src.data() + offset, count);
+      }
+      double seconds = TicksToMicroseconds(Clock::QueryHostTickCount() -
+                                           start_ticks) /
+                       1000000.0;
+      fmt::print(" {:>10.2f}",
+                 double(size) * double(iterations) / seconds / 1.0e9);
+    }
+    fmt::print("\n");
+  }
+}
+
+int base_bench_main(const std::vector<std::string>& args) {
+  bool all = cvars::bench == "all";
+  bool ran = false;
+  if (all || cvars::bench == "sleep") {
+    BenchmarkSleep();
+    ran = true;
+  }
+  if (all || cvars::bench == "park") {
+    BenchmarkPark();
+    ran = true;
+  }
+  if (all || cvars::bench == "copy_and_swap") {
+    BenchmarkCopyAndSwap();
+    ran = true;
+  }
+  if (!ran) {
+    XELOGE("Unknown benchmark {}", cvars::bench);
+    return 1;
+  }
+  return 0;
+}
+
+}  // namespace base
+}  // namespace xe
+
+DEFINE_ENTRY_POINT("xenia-base-bench", xe::base::base_bench_main,
+                   "[--bench=name]");
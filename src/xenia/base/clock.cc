@@ -200,6 +200,24 @@ uint32_t Clock::ScaleGuestDurationMillis(uint32_t guest_ms) {
   return static_cast<uint32_t>(std::min(scaled_ms, max));
 }
 
+std::chrono::nanoseconds Clock::ScaleGuestDuration(
+    std::chrono::nanoseconds guest_duration) {
+  if (cvars::clock_no_scaling) {
+    return guest_duration;
+  }
+
+  if (guest_duration <= std::chrono::nanoseconds::zero()) {
+    return std::chrono::nanoseconds::zero();
+  } else if (guest_duration == std::chrono::nanoseconds::max()) {
+    return guest_duration;
+  }
+  double scaled_ns = guest_duration.count() * guest_time_scalar_;
+  if (scaled_ns >= double(std::chrono::nanoseconds::max().count())) {
+    return std::chrono::nanoseconds::max();
+  }
+  return std::chrono::nanoseconds(static_cast<int64_t>(scaled_ns));
+}
+
 int64_t Clock::ScaleGuestDurationFileTime(int64_t guest_file_time) {
   if (cvars::clock_no_scaling) {
     return static_cast<uint64_t>(guest_file_time);
@@ -10,6 +10,7 @@
 #ifndef XENIA_BASE_CLOCK_H_
 #define XENIA_BASE_CLOCK_H_
 
+#include <chrono>
 #include <cstdint>
 
 #include "xenia/base/cvar.h"
@@ -68,6 +69,9 @@ class Clock {
 
   // Scales a time duration in milliseconds, from guest time.
   static uint32_t ScaleGuestDurationMillis(uint32_t guest_ms);
+  // Scales a time duration, from guest time.
+  static std::chrono::nanoseconds ScaleGuestDuration(
+      std::chrono::nanoseconds guest_duration);
   // Scales a time duration in 100ns ticks like FILETIME, from guest time.
   static int64_t ScaleGuestDurationFileTime(int64_t guest_file_time);
   // Scales a time duration represented as a timeval, from guest time.
@@ -0,0 +1,429 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/base/crypto.h"
+
+#include <cstring>
+
+#include "xenia/base/platform.h"
+
+#include "third_party/crypto/TinySHA1.hpp"
+#include "third_party/crypto/rijndael-alg-fst.c"
+#include "third_party/crypto/rijndael-alg-fst.h"
+
+#if XE_ARCH_AMD64 && !XE_COMPILER_MSVC
+#include <cpuid.h>
+#endif
+
+namespace xe {
+namespace crypto {
+
+namespace {
+
+typedef void (*AesCbcDecryptKernel)(const uint8_t* key, uint8_t* iv,
+                                    const uint8_t* input, uint8_t* output,
+                                    size_t block_count);
+typedef void (*Sha1Kernel)(const void* data, size_t length, uint8_t* digest);
+
+void Aes128CbcDecryptPortable(const uint8_t* key, uint8_t* iv,
+                              const uint8_t* input, uint8_t* output,
+                              size_t block_count) {
+  uint32_t rk[4 * (MAXNR + 1)];
+  int32_t Nr = rijndaelKeySetupDec(rk, key, 128);
+  uint8_t ct[kAesBlockLength];
+  for (size_t n = 0; n < block_count; ++n) {
+    // Keep the ciphertext as the next IV in case this is in place.
+    std::memcpy(ct, input + n * kAesBlockLength, kAesBlockLength);
+    uint8_t* pt = output + n * kAesBlockLength;
+    rijndaelDecrypt(rk, Nr, ct, pt);
+    for (size_t i = 0; i < kAesBlockLength; ++i) {
+      pt[i] ^= iv[i];
+      iv[i] = ct[i];
+    }
+  }
+}
+
+void Sha1Portable(const void* data, size_t length, uint8_t* digest) {
+  sha1::SHA1 s;
+  s.processBytes(data, length);
+  s.finalize(digest);
+}
+
+#if XE_ARCH_AMD64
+
+#if XE_COMPILER_MSVC
+#define XE_TARGET_AESNI
+#define XE_TARGET_VAES
+#define XE_TARGET_SHANI
+#else
+#define XE_TARGET_AESNI __attribute__((target("aes")))
+#define XE_TARGET_VAES __attribute__((target("aes,avx2,vaes")))
+#define XE_TARGET_SHANI __attribute__((target("sha,sse4.1")))
+#endif  // XE_COMPILER_MSVC
+
+void Cpuid(uint32_t level, uint32_t subleaf, uint32_t regs[4]) {
+#if XE_COMPILER_MSVC
+  __cpuidex(reinterpret_cast<int*>(regs), int(level), int(subleaf));
+#else
+  __cpuid_count(level, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif  // XE_COMPILER_MSVC
+}
+
+bool IsAesNiSupported() {
+  uint32_t regs[4];
+  Cpuid(1, 0, regs);
+  return regs[2] & (1 << 25);
+}
+
+bool IsVaesSupported() {
+  uint32_t regs[4];
+  Cpuid(0, 0, regs);
+  if (regs[0] < 7) {
+    return false;
+  }
+  Cpuid(1, 0, regs);
+  if (!(regs[2] & (1 << 25))) {  // AES
+    return false;
+  }
+#if XE_COMPILER_MSVC
+  if (!(regs[2] & (1 << 27)) || (_xgetbv(0) & 0x6) != 0x6) {
+    return false;
+  }
+#else
+  if (!__builtin_cpu_supports("avx2")) {
+    return false;
+  }
+#endif  // XE_COMPILER_MSVC
+  Cpuid(7, 0, regs);
+  return (regs[1] & (1 << 5)) && (regs[2] & (1 << 9));  // AVX2, VAES
+}
+
+bool IsShaNiSupported() {
+  uint32_t regs[4];
+  Cpuid(0, 0, regs);
+  if (regs[0] < 7) {
+    return false;
+  }
+  Cpuid(1, 0, regs);
+  if (!(regs[2] & (1 << 19))) {  // SSE4.1
+    return false;
+  }
+  Cpuid(7, 0, regs);
+  return regs[1] & (1 << 29);
+}
+
+// The decryption key schedule: the encryption round keys in reverse order,
+// with InvMixColumns applied to all but the first and last.
+constexpr size_t kAes128RoundKeyCount = 11;
+
+inline __m128i ExpandAes128KeyStep(__m128i key, __m128i key_assist) {
+  key_assist = _mm_shuffle_epi32(key_assist, _MM_SHUFFLE(3, 3, 3, 3));
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  return _mm_xor_si128(key, key_assist);
+}
+
+XE_TARGET_AESNI void ExpandAes128DecryptionKey(const uint8_t* key,
+                                               __m128i* round_keys) {
+  __m128i enc[kAes128RoundKeyCount];
+  enc[0] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key));
+  // The round constant must be an immediate.
+#define XE_AES_EXPAND(i, rcon) \
+  enc[i] = ExpandAes128KeyStep(enc[i - 1],  \
+                               _mm_aeskeygenassist_si128(enc[i - 1], rcon))
+  XE_AES_EXPAND(1, 0x01);
+  XE_AES_EXPAND(2, 0x02);
+  XE_AES_EXPAND(3, 0x04);
+  XE_AES_EXPAND(4, 0x08);
+  XE_AES_EXPAND(5, 0x10);
+  XE_AES_EXPAND(6, 0x20);
+  XE_AES_EXPAND(7, 0x40);
+  XE_AES_EXPAND(8, 0x80);
+  XE_AES_EXPAND(9, 0x1B);
+  XE_AES_EXPAND(10, 0x36);
+#undef XE_AES_EXPAND
+  round_keys[0] = enc[10];
+  for (size_t i = 1; i < kAes128RoundKeyCount - 1; ++i) {
+    round_keys[i] = _mm_aesimc_si128(enc[10 - i]);
+  }
+  round_keys[10] = enc[0];
+}
+
+XE_TARGET_AESNI inline __m128i DecryptAes128Block(const __m128i* round_keys,
+                                                  __m128i block) {
+  block = _mm_xor_si128(block, round_keys[0]);
+  for (size_t i = 1; i < kAes128RoundKeyCount - 1; ++i) {
+    block = _mm_aesdec_si128(block, round_keys[i]);
+  }
+  return _mm_aesdeclast_si128(block, round_keys[10]);
+}
+
+// CBC decryption has no dependency between blocks other than the XOR with
+// the previous ciphertext, so several blocks are kept in flight to hide the
+// latency of AESDEC.
+XE_TARGET_AESNI size_t Aes128CbcDecryptBlocksAesNi(const __m128i* round_keys,
+                                                   __m128i* iv,
+                                                   const uint8_t* input,
+                                                   uint8_t* output,
+                                                   size_t block_count) {
+  constexpr size_t kParallelBlocks = 8;
+  auto in = reinterpret_cast<const __m128i*>(input);
+  auto out = reinterpret_cast<__m128i*>(output);
+  size_t n = 0;
+  for (; n + kParallelBlocks <= block_count; n += kParallelBlocks) {
+    __m128i ct[kParallelBlocks], pt[kParallelBlocks];
+    for (size_t i = 0; i < kParallelBlocks; ++i) {
+      ct[i] = _mm_loadu_si128(in + n + i);
+      pt[i] = _mm_xor_si128(ct[i], round_keys[0]);
+    }
+    for (size_t r = 1; r < kAes128RoundKeyCount - 1; ++r) {
+      for (size_t i = 0; i < kParallelBlocks; ++i) {
+        pt[i] = _mm_aesdec_si128(pt[i], round_keys[r]);
+      }
+    }
+    for (size_t i = 0; i < kParallelBlocks; ++i) {
+      pt[i] = _mm_aesdeclast_si128(pt[i], round_keys[10]);
+    }
+    _mm_storeu_si128(out + n, _mm_xor_si128(pt[0], *iv));
+    for (size_t i = 1; i < kParallelBlocks; ++i) {
+      _mm_storeu_si128(out + n + i, _mm_xor_si128(pt[i], ct[i - 1]));
+    }
+    *iv = ct[kParallelBlocks - 1];
+  }
+  for (; n < block_count; ++n) {
+    __m128i ct = _mm_loadu_si128(in + n);
+    _mm_storeu_si128(out + n, _mm_xor_si128(DecryptAes128Block(round_keys, ct),
+                                            *iv));
+    *iv = ct;
+  }
+  return n;
+}
+
+XE_TARGET_AESNI void Aes128CbcDecryptAesNi(const uint8_t* key, uint8_t* iv,
+                                           const uint8_t* input,
+                                           uint8_t* output,
+                                           size_t block_count) {
+  __m128i round_keys[kAes128RoundKeyCount];
+  ExpandAes128DecryptionKey(key, round_keys);
+  __m128i iv_block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(iv));
+  Aes128CbcDecryptBlocksAesNi(round_keys, &iv_block, input, output,
+                              block_count);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(iv), iv_block);
+}
+
+// Same as the AES-NI kernel with two blocks per 256-bit vector.
+XE_TARGET_VAES void Aes128CbcDecryptVaes(const uint8_t* key, uint8_t* iv,
+                                         const uint8_t* input, uint8_t* output,
+                                         size_t block_count) {
+  constexpr size_t kParallelVectors = 8;
+  constexpr size_t kParallelBlocks = kParallelVectors * 2;
+  __m128i round_keys[kAes128RoundKeyCount];
+  ExpandAes128DecryptionKey(key, round_keys);
+  __m256i round_keys_256[kAes128RoundKeyCount];
+  for (size_t r = 0; r < kAes128RoundKeyCount; ++r) {
+    round_keys_256[r] = _mm256_broadcastsi128_si256(round_keys[r]);
+  }
+  __m128i iv_block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(iv));
+
+  size_t n = 0;
+  for (; n + kParallelBlocks <= block_count; n += kParallelBlocks) {
+    const uint8_t* in = input + n * kAesBlockLength;
+    uint8_t* out = output + n * kAesBlockLength;
+    // Everything is loaded before anything is stored, so that in-place
+    // decryption still XORs with the ciphertext.
+    __m256i ct[kParallelVectors], prev[kParallelVectors], pt[kParallelVectors];
+    for (size_t i = 0; i < kParallelVectors; ++i) {
+      ct[i] = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(in + i * 2 * kAesBlockLength));
+    }
+    prev[0] = _mm256_inserti128_si256(_mm256_castsi128_si256(iv_block),
+                                      _mm256_castsi256_si128(ct[0]), 1);
+    for (size_t i = 1; i < kParallelVectors; ++i) {
+      prev[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(
+          in + (i * 2 - 1) * kAesBlockLength));
+    }
+    iv_block = _mm256_extracti128_si256(ct[kParallelVectors - 1], 1);
+    for (size_t i = 0; i < kParallelVectors; ++i) {
+      pt[i] = _mm256_xor_si256(ct[i], round_keys_256[0]);
+    }
+    for (size_t r = 1; r < kAes128RoundKeyCount - 1; ++r) {
+      for (size_t i = 0; i < kParallelVectors; ++i) {
+        pt[i] = _mm256_aesdec_epi128(pt[i], round_keys_256[r]);
+      }
+    }
+    for (size_t i = 0; i < kParallelVectors; ++i) {
+      pt[i] = _mm256_aesdeclast_epi128(pt[i], round_keys_256[10]);
+      _mm256_storeu_si256(
+          reinterpret_cast<__m256i*>(out + i * 2 * kAesBlockLength),
+          _mm256_xor_si256(pt[i], prev[i]));
+    }
+  }
+  Aes128CbcDecryptBlocksAesNi(round_keys, &iv_block,
+                              input + n * kAesBlockLength,
+                              output + n * kAesBlockLength, block_count - n);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(iv), iv_block);
+}
+
+// One group of four SHA-1 rounds. Groups alternate which of e0 and e1 holds
+// the E value for the rounds, and the message schedule for later groups is
+// advanced in the otherwise unused message registers.
+template <int k>
+XE_TARGET_SHANI inline void Sha1RoundsShaNi(__m128i& abcd, __m128i& e0,
+                                            __m128i& e1, __m128i* msg) {
+  __m128i& e = (k & 1) ? e1 : e0;
+  __m128i& e_next = (k & 1) ? e0 : e1;
+  if (k == 0) {
+    e = _mm_add_epi32(e, msg[0]);
+  } else {
+    e = _mm_sha1nexte_epu32(e, msg[k & 3]);
+  }
+  e_next = abcd;
+  abcd = _mm_sha1rnds4_epu32(abcd, e, k / 5);
+  // W[k + 3] = msg2(msg1(W[k - 1], W[k]) ^ W[k + 1], W[k + 2]), spread over
+  // groups k to k + 2.
+  if (k >= 3 && k <= 18) {
+    msg[(k + 1) & 3] = _mm_sha1msg2_epu32(msg[(k + 1) & 3], msg[k & 3]);
+  }
+  if (k >= 2 && k <= 17) {
+    msg[(k + 2) & 3] = _mm_xor_si128(msg[(k + 2) & 3], msg[k & 3]);
+  }
+  if (k >= 1 && k <= 16) {
+    msg[(k + 3) & 3] = _mm_sha1msg1_epu32(msg[(k + 3) & 3], msg[k & 3]);
+  }
+}
+
+XE_TARGET_SHANI void Sha1BlocksShaNi(uint32_t* state, const uint8_t* data,
+                                     size_t block_count) {
+  const __m128i byte_swap_mask =
+      _mm_set_epi64x(0x0001020304050607ull, 0x08090A0B0C0D0E0Full);
+  __m128i abcd = _mm_shuffle_epi32(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0x1B);
+  __m128i e0 = _mm_set_epi32(int(state[4]), 0, 0, 0);
+  for (size_t n = 0; n < block_count; ++n, data += 64) {
+    __m128i abcd_save = abcd;
+    __m128i e0_save = e0;
+    __m128i e1;
+    __m128i msg[4];
+    for (size_t i = 0; i < 4; ++i) {
+      msg[i] = _mm_shuffle_epi8(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 16)),
+          byte_swap_mask);
+    }
+    Sha1RoundsShaNi<0>(abcd, e0, e1, msg);
+    Sha1RoundsShaNi<1>(abcd, e0, e1, msg);
+    Sha1RoundsShaNi<2>(abcd, e0, e1, msg);
+    Sha1RoundsShaNi<3>(abcd, e0, e1, msg);
+    Sha1RoundsShaNi<4>(abcd, e0, e1, msg);
+    Sha1RoundsShaNi<5>(abcd, e0, e1, msg);
+    Sha1RoundsShaNi<6>(abcd, e0, e1, msg);
+    Sha1RoundsShaNi<7>(abcd, e0, e1, msg);
+    Sha1RoundsShaNi<8>(abcd, e0, e1, msg);
+    Sha1RoundsShaNi<9>(abcd, e0, e1, msg);
+    Sha1RoundsShaNi<10>(abcd, e0, e1, msg);
+    Sha1RoundsShaNi<11>(abcd, e0, e1, msg);
+    Sha1RoundsShaNi<12>(abcd, e0, e1, msg);
+    Sha1RoundsShaNi<13>(abcd, e0, e1, msg);
+    Sha1RoundsShaNi<14>(abcd, e0, e1, msg);
+    Sha1RoundsShaNi<15>(abcd, e0, e1, msg);
+    Sha1RoundsShaNi<16>(abcd, e0, e1, msg);
+    Sha1RoundsShaNi<17>(abcd, e0, e1, msg);
+    Sha1RoundsShaNi<18>(abcd, e0, e1, msg);
+    Sha1RoundsShaNi<19>(abcd, e0, e1, msg);
+    e0 = _mm_sha1nexte_epu32(e0, e0_save);
+    abcd = _mm_add_epi32(abcd, abcd_save);
+  }
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(state),
+                   _mm_shuffle_epi32(abcd, 0x1B));
+  state[4] = uint32_t(_mm_extract_epi32(e0, 3));
+}
+
+XE_TARGET_SHANI void Sha1ShaNi(const void* data, size_t length,
+                               uint8_t* digest) {
+  uint32_t state[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476,
+                       0xC3D2E1F0};
+  auto bytes = reinterpret_cast<const uint8_t*>(data);
+  size_t full_block_count = length / 64;
+  Sha1BlocksShaNi(state, bytes, full_block_count);
+
+  // Padding: 0x80, zeros, then the big-endian bit length, in one or two
+  // blocks.
+  uint8_t tail[128] = {};
+  size_t tail_length = length % 64;
+  if (tail_length) {
+    std::memcpy(tail, bytes + full_block_count * 64, tail_length);
+  }
+  tail[tail_length] = 0x80;
+  size_t tail_block_count = tail_length < 56 ? 1 : 2;
+  uint64_t bit_length = uint64_t(length) * 8;
+  for (size_t i = 0; i < 8; ++i) {
+    tail[tail_block_count * 64 - 1 - i] = uint8_t(bit_length >> (i * 8));
+  }
+  Sha1BlocksShaNi(state, tail, tail_block_count);
+
+  for (size_t i = 0; i < 5; ++i) {
+    digest[i * 4 + 0] = uint8_t(state[i] >> 24);
+    digest[i * 4 + 1] = uint8_t(state[i] >> 16);
+    digest[i * 4 + 2] = uint8_t(state[i] >> 8);
+    digest[i * 4 + 3] = uint8_t(state[i]);
+  }
+}
+
+#endif  // XE_ARCH_AMD64
+
+void Aes128CbcDecryptResolve(const uint8_t* key, uint8_t* iv,
+                             const uint8_t* input, uint8_t* output,
+                             size_t block_count);
+void Sha1Resolve(const void* data, size_t length, uint8_t* digest);
+
+// Start out as the resolvers so that calls during static initialization work
+// regardless of initialization order.
+AesCbcDecryptKernel aes128_cbc_decrypt_kernel_ = Aes128CbcDecryptResolve;
+Sha1Kernel sha1_kernel_ = Sha1Resolve;
+
+void Aes128CbcDecryptResolve(const uint8_t* key, uint8_t* iv,
+                             const uint8_t* input, uint8_t* output,
+                             size_t block_count) {
+  AesCbcDecryptKernel kernel = Aes128CbcDecryptPortable;
+#if XE_ARCH_AMD64
+  if (IsVaesSupported()) {
+    kernel = Aes128CbcDecryptVaes;
+  } else if (IsAesNiSupported()) {
+    kernel = Aes128CbcDecryptAesNi;
+  }
+#endif  // XE_ARCH_AMD64
+  aes128_cbc_decrypt_kernel_ = kernel;
+  kernel(key, iv, input, output, block_count);
+}
+
+void Sha1Resolve(const void* data, size_t length, uint8_t* digest) {
+  Sha1Kernel kernel = Sha1Portable;
+#if XE_ARCH_AMD64
+  if (IsShaNiSupported()) {
+    kernel = Sha1ShaNi;
+  }
+#endif  // XE_ARCH_AMD64
+  sha1_kernel_ = kernel;
+  kernel(data, length, digest);
+}
+
+}  // namespace
+
+void Aes128CbcDecrypt(const uint8_t* key, uint8_t* iv, const uint8_t* input,
+                      uint8_t* output, size_t length) {
+  aes128_cbc_decrypt_kernel_(key, iv, input, output,
+                             length / kAesBlockLength);
+}
+
+void Sha1(const void* data, size_t length, uint8_t* digest) {
+  sha1_kernel_(data, length, digest);
+}
+
+}  // namespace crypto
+}  // namespace xe
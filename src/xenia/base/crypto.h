@@ -0,0 +1,37 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_BASE_CRYPTO_H_
+#define XENIA_BASE_CRYPTO_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace xe {
+namespace crypto {
+
+constexpr size_t kAesBlockLength = 16;
+constexpr size_t kAes128KeyLength = 16;
+constexpr size_t kSha1DigestLength = 20;
+
+// Decrypts the whole 16-byte blocks of input with AES-128 in CBC mode, using
+// AES-NI (or VAES) when the host has it. iv is updated to the last ciphertext
+// block, so a stream can be decrypted in several calls. input and output may
+// be the same buffer.
+void Aes128CbcDecrypt(const uint8_t* key, uint8_t* iv, const uint8_t* input,
+                      uint8_t* output, size_t length);
+
+// Computes the SHA-1 digest of data, using the SHA extensions when the host
+// has them.
+void Sha1(const void* data, size_t length, uint8_t* digest);
+
+}  // namespace crypto
+}  // namespace xe
+
+#endif  // XENIA_BASE_CRYPTO_H_
@@ -195,10 +195,14 @@ std::unique_ptr<FileHandle> FileHandle::OpenExisting(
 bool GetInfo(const std::filesystem::path& path, FileInfo* out_info) {
   struct stat st;
   if (stat(path.c_str(), &st) == 0) {
+    out_info->name = path.filename();
+    out_info->path = path.parent_path();
     if (S_ISDIR(st.st_mode)) {
       out_info->type = FileInfo::Type::kDirectory;
+      out_info->total_size = 0;
     } else {
       out_info->type = FileInfo::Type::kFile;
+      out_info->total_size = st.st_size;
     }
     out_info->create_timestamp = convertUnixtimeToWinFiletime(st.st_ctime);
     out_info->access_timestamp = convertUnixtimeToWinFiletime(st.st_atime);
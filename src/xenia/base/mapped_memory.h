@@ -49,6 +49,11 @@ class MappedMemory {
   // Changes the offset inside the file. This will update data() and size()!
   virtual bool Remap(size_t offset, size_t length) { return false; }
 
+  // Hints that the given range will be accessed soon, so the OS can start
+  // reading it in with large requests instead of page by page as it faults.
+  // Also works on slices.
+  void Prefetch(size_t offset, size_t length);
+
  protected:
   std::filesystem::path path_;
   Mode mode_;
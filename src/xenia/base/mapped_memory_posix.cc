@@ -10,9 +10,11 @@
 #include "xenia/base/mapped_memory.h"
 
 #include <sys/mman.h>
+#include <algorithm>
 #include <cstdio>
 #include <memory>
 
+#include "xenia/base/memory.h"
 #include "xenia/base/string.h"
 
 namespace xe {
@@ -76,6 +78,18 @@ std::unique_ptr<MappedMemory> MappedMemory::Open(
   return std::move(mm);
 }
 
+void MappedMemory::Prefetch(size_t offset, size_t length) {
+  if (!data_ || offset >= size_) {
+    return;
+  }
+  length = std::min(length, size_ - offset);
+  // madvise requires a page-aligned start.
+  uintptr_t start = reinterpret_cast<uintptr_t>(data() + offset);
+  uintptr_t aligned_start = start & ~uintptr_t(xe::memory::page_size() - 1);
+  madvise(reinterpret_cast<void*>(aligned_start),
+          length + (start - aligned_start), MADV_WILLNEED);
+}
+
 std::unique_ptr<ChunkedMappedMemoryWriter> ChunkedMappedMemoryWriter::Open(
     const std::filesystem::path& path, size_t chunk_size,
     bool low_address_space) {
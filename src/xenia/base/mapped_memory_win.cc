@@ -7,6 +7,7 @@
  ******************************************************************************
  */
 
+#include <algorithm>
 #include <memory>
 #include <mutex>
 #include <vector>
@@ -155,6 +156,16 @@ std::unique_ptr<MappedMemory> MappedMemory::Open(
   return std::move(mm);
 }
 
+void MappedMemory::Prefetch(size_t offset, size_t length) {
+  if (!data_ || offset >= size_) {
+    return;
+  }
+  WIN32_MEMORY_RANGE_ENTRY range;
+  range.VirtualAddress = data() + offset;
+  range.NumberOfBytes = std::min(length, size_ - offset);
+  PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
 class Win32ChunkedMappedMemoryWriter : public ChunkedMappedMemoryWriter {
  public:
   Win32ChunkedMappedMemoryWriter(const std::filesystem::path& path,
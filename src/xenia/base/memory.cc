@@ -14,7 +14,6 @@
 
 namespace xe {
 
-// TODO(benvanik): fancy AVX versions.
 // https://github.com/gnuradio/volk/blob/master/kernels/volk/volk_16u_byteswap.h
 // https://github.com/gnuradio/volk/blob/master/kernels/volk/volk_32u_byteswap.h
 // https://github.com/gnuradio/volk/blob/master/kernels/volk/volk_64u_byteswap.h
@@ -28,156 +27,231 @@ void copy_128_aligned(void* dest, const void* src, size_t count) {
 }
 
 #if XE_ARCH_AMD64
-void copy_and_swap_16_aligned(void* dest_ptr, const void* src_ptr,
-                              size_t count) {
-  assert_zero(reinterpret_cast<uintptr_t>(dest_ptr) & 0xF);
-  assert_zero(reinterpret_cast<uintptr_t>(src_ptr) & 0xF);
+namespace {
 
-  auto dest = reinterpret_cast<uint16_t*>(dest_ptr);
-  auto src = reinterpret_cast<const uint16_t*>(src_ptr);
+#if XE_COMPILER_MSVC
+#define XE_TARGET_AVX2
+#define XE_TARGET_AVX512
+#else
+#define XE_TARGET_AVX2 __attribute__((target("avx2")))
+#define XE_TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+#endif  // XE_COMPILER_MSVC
+
+// All the swaps are byte shuffles within each 16-byte lane, so one kernel per
+// instruction set handles all of them.
+alignas(16) const uint8_t kSwap16Shuffle[16] = {1, 0, 3,  2,  5,  4,  7,  6,
+                                                9, 8, 11, 10, 13, 12, 15, 14};
+alignas(16) const uint8_t kSwap32Shuffle[16] = {3,  2,  1, 0, 7,  6,  5,  4,
+                                                11, 10, 9, 8, 15, 14, 13, 12};
+alignas(16) const uint8_t kSwap64Shuffle[16] = {7,  6,  5,  4,  3,  2, 1, 0,
+                                                15, 14, 13, 12, 11, 10, 9, 8};
+alignas(16) const uint8_t kSwap16In32Shuffle[16] = {
+    2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13};
+
+// Above this size the destination is written with non-temporal stores - it's
+// usually an upload buffer that the CPU won't read again, and a copy this big
+// would just evict everything else from the cache.
+constexpr size_t kNonTemporalThreshold = 4 * 1024 * 1024;
+
+// Each kernel swaps as many whole vectors as fit in size and returns the number
+// of bytes it has processed; the caller handles the remainder.
+typedef size_t (*CopySwapKernel)(uint8_t* dest, const uint8_t* src,
+                                 size_t size, const uint8_t* shuffle);
+
+size_t CopySwapSSSE3(uint8_t* dest, const uint8_t* src, size_t size,
+                     const uint8_t* shuffle) {
   __m128i shufmask =
-      _mm_set_epi8(0x0E, 0x0F, 0x0C, 0x0D, 0x0A, 0x0B, 0x08, 0x09, 0x06, 0x07,
-                   0x04, 0x05, 0x02, 0x03, 0x00, 0x01);
+      _mm_load_si128(reinterpret_cast<const __m128i*>(shuffle));
+  size_t i;
+  for (i = 0; i + 16 <= size; i += 16) {
+    __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&src[i]));
+    __m128i output = _mm_shuffle_epi8(input, shufmask);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&dest[i]), output);
+  }
+  return i;
+}
 
+XE_TARGET_AVX2 size_t CopySwapAVX2(uint8_t* dest, const uint8_t* src,
+                                   size_t size, const uint8_t* shuffle) {
+  __m256i shufmask = _mm256_broadcastsi128_si256(
+      _mm_load_si128(reinterpret_cast<const __m128i*>(shuffle)));
   size_t i = 0;
-  for (i = 0; i + 8 <= count; i += 8) {
-    __m128i input = _mm_load_si128(reinterpret_cast<const __m128i*>(&src[i]));
-    __m128i output = _mm_shuffle_epi8(input, shufmask);
-    _mm_store_si128(reinterpret_cast<__m128i*>(&dest[i]), output);
+  if (size >= kNonTemporalThreshold &&
+      !(reinterpret_cast<uintptr_t>(dest) & 15)) {
+    // Align the destination for the streaming stores - the head is a whole
+    // number of 16-byte vectors as the destination is 16-byte aligned.
+    size_t head = (32 - (reinterpret_cast<uintptr_t>(dest) & 31)) & 31;
+    i = CopySwapSSSE3(dest, src, head, shuffle);
+    for (; i + 32 <= size; i += 32) {
+      __m256i input =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&src[i]));
+      _mm256_stream_si256(reinterpret_cast<__m256i*>(&dest[i]),
+                          _mm256_shuffle_epi8(input, shufmask));
+    }
+    _mm_sfence();
   }
-  for (; i < count; ++i) {  // handle residual elements
-    dest[i] = byte_swap(src[i]);
+  for (; i + 32 <= size; i += 32) {
+    __m256i input =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&src[i]));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(&dest[i]),
+                        _mm256_shuffle_epi8(input, shufmask));
   }
+  return i + CopySwapSSSE3(dest + i, src + i, size - i, shuffle);
 }
 
-void copy_and_swap_16_unaligned(void* dest_ptr, const void* src_ptr,
-                                size_t count) {
-  auto dest = reinterpret_cast<uint16_t*>(dest_ptr);
-  auto src = reinterpret_cast<const uint16_t*>(src_ptr);
-  __m128i shufmask =
-      _mm_set_epi8(0x0E, 0x0F, 0x0C, 0x0D, 0x0A, 0x0B, 0x08, 0x09, 0x06, 0x07,
-                   0x04, 0x05, 0x02, 0x03, 0x00, 0x01);
+XE_TARGET_AVX512 size_t CopySwapAVX512(uint8_t* dest, const uint8_t* src,
+                                       size_t size, const uint8_t* shuffle) {
+  __m512i shufmask = _mm512_broadcast_i32x4(
+      _mm_load_si128(reinterpret_cast<const __m128i*>(shuffle)));
+  size_t i = 0;
+  if (size >= kNonTemporalThreshold &&
+      !(reinterpret_cast<uintptr_t>(dest) & 15)) {
+    // Align the destination for the streaming stores - the head is a whole
+    // number of 16-byte vectors as the destination is 16-byte aligned.
+    size_t head = (64 - (reinterpret_cast<uintptr_t>(dest) & 63)) & 63;
+    i = CopySwapSSSE3(dest, src, head, shuffle);
+    for (; i + 64 <= size; i += 64) {
+      __m512i input =
+          _mm512_loadu_si512(reinterpret_cast<const __m512i*>(&src[i]));
+      _mm512_stream_si512(reinterpret_cast<__m512i*>(&dest[i]),
+                          _mm512_shuffle_epi8(input, shufmask));
+    }
+    _mm_sfence();
+  }
+  for (; i + 64 <= size; i += 64) {
+    __m512i input =
+        _mm512_loadu_si512(reinterpret_cast<const __m512i*>(&src[i]));
+    _mm512_storeu_si512(reinterpret_cast<__m512i*>(&dest[i]),
+                        _mm512_shuffle_epi8(input, shufmask));
+  }
+  return i + CopySwapSSSE3(dest + i, src + i, size - i, shuffle);
+}
 
-  size_t i;
-  for (i = 0; i + 8 <= count; i += 8) {
-    __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&src[i]));
-    __m128i output = _mm_shuffle_epi8(input, shufmask);
-    _mm_storeu_si128(reinterpret_cast<__m128i*>(&dest[i]), output);
+bool IsAVX512Supported() {
+#if XE_COMPILER_MSVC
+  int regs[4];
+  __cpuid(regs, 0);
+  if (regs[0] < 7) {
+    return false;
   }
-  for (; i < count; ++i) {  // handle residual elements
-    dest[i] = byte_swap(src[i]);
+  __cpuid(regs, 1);
+  if (!(regs[2] & (1 << 27))) {  // OSXSAVE
+    return false;
   }
+  // XMM, YMM, opmask and both halves of the ZMM state enabled by the OS.
+  if ((_xgetbv(0) & 0xE6) != 0xE6) {
+    return false;
+  }
+  __cpuidex(regs, 7, 0);
+  return (regs[1] & (1 << 16)) && (regs[1] & (1 << 30));  // AVX512F, BW
+#else
+  return __builtin_cpu_supports("avx512f") &&
+         __builtin_cpu_supports("avx512bw");
+#endif  // XE_COMPILER_MSVC
 }
 
-void copy_and_swap_32_aligned(void* dest_ptr, const void* src_ptr,
-                              size_t count) {
-  assert_zero(reinterpret_cast<uintptr_t>(dest_ptr) & 0xF);
-  assert_zero(reinterpret_cast<uintptr_t>(src_ptr) & 0xF);
+bool IsAVX2Supported() {
+#if XE_COMPILER_MSVC
+  int regs[4];
+  __cpuid(regs, 0);
+  if (regs[0] < 7) {
+    return false;
+  }
+  __cpuid(regs, 1);
+  if (!(regs[2] & (1 << 27)) || (_xgetbv(0) & 0x6) != 0x6) {
+    return false;
+  }
+  __cpuidex(regs, 7, 0);
+  return regs[1] & (1 << 5);
+#else
+  return __builtin_cpu_supports("avx2");
+#endif  // XE_COMPILER_MSVC
+}
 
-  auto dest = reinterpret_cast<uint32_t*>(dest_ptr);
-  auto src = reinterpret_cast<const uint32_t*>(src_ptr);
-  __m128i shufmask =
-      _mm_set_epi8(0x0C, 0x0D, 0x0E, 0x0F, 0x08, 0x09, 0x0A, 0x0B, 0x04, 0x05,
-                   0x06, 0x07, 0x00, 0x01, 0x02, 0x03);
+size_t CopySwapResolve(uint8_t* dest, const uint8_t* src, size_t size,
+                       const uint8_t* shuffle);
 
-  size_t i;
-  for (i = 0; i + 4 <= count; i += 4) {
-    __m128i input = _mm_load_si128(reinterpret_cast<const __m128i*>(&src[i]));
-    __m128i output = _mm_shuffle_epi8(input, shufmask);
-    _mm_store_si128(reinterpret_cast<__m128i*>(&dest[i]), output);
+// Starts out as the resolver so copies made during static initialization work
+// regardless of initialization order.
+CopySwapKernel copy_swap_kernel_ = CopySwapResolve;
+
+size_t CopySwapResolve(uint8_t* dest, const uint8_t* src, size_t size,
+                       const uint8_t* shuffle) {
+  CopySwapKernel kernel = CopySwapSSSE3;
+  if (IsAVX512Supported()) {
+    kernel = CopySwapAVX512;
+  } else if (IsAVX2Supported()) {
+    kernel = CopySwapAVX2;
   }
+  copy_swap_kernel_ = kernel;
+  return kernel(dest, src, size, shuffle);
+}
+
+}  // namespace
+
+void copy_and_swap_16_aligned(void* dest, const void* src, size_t count) {
+  return copy_and_swap_16_unaligned(dest, src, count);
+}
+
+void copy_and_swap_16_unaligned(void* dest_ptr, const void* src_ptr,
+                                size_t count) {
+  auto dest = reinterpret_cast<uint16_t*>(dest_ptr);
+  auto src = reinterpret_cast<const uint16_t*>(src_ptr);
+  size_t i = copy_swap_kernel_(reinterpret_cast<uint8_t*>(dest),
+                               reinterpret_cast<const uint8_t*>(src),
+                               count * sizeof(uint16_t), kSwap16Shuffle) /
+             sizeof(uint16_t);
   for (; i < count; ++i) {  // handle residual elements
     dest[i] = byte_swap(src[i]);
   }
 }
 
+void copy_and_swap_32_aligned(void* dest, const void* src, size_t count) {
+  return copy_and_swap_32_unaligned(dest, src, count);
+}
+
 void copy_and_swap_32_unaligned(void* dest_ptr, const void* src_ptr,
                                 size_t count) {
   auto dest = reinterpret_cast<uint32_t*>(dest_ptr);
   auto src = reinterpret_cast<const uint32_t*>(src_ptr);
-  __m128i shufmask =
-      _mm_set_epi8(0x0C, 0x0D, 0x0E, 0x0F, 0x08, 0x09, 0x0A, 0x0B, 0x04, 0x05,
-                   0x06, 0x07, 0x00, 0x01, 0x02, 0x03);
-
-  size_t i;
-  for (i = 0; i + 4 <= count; i += 4) {
-    __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&src[i]));
-    __m128i output = _mm_shuffle_epi8(input, shufmask);
-    _mm_storeu_si128(reinterpret_cast<__m128i*>(&dest[i]), output);
-  }
+  size_t i = copy_swap_kernel_(reinterpret_cast<uint8_t*>(dest),
+                               reinterpret_cast<const uint8_t*>(src),
+                               count * sizeof(uint32_t), kSwap32Shuffle) /
+             sizeof(uint32_t);
   for (; i < count; ++i) {  // handle residual elements
     dest[i] = byte_swap(src[i]);
   }
 }
 
-void copy_and_swap_64_aligned(void* dest_ptr, const void* src_ptr,
-                              size_t count) {
-  assert_zero(reinterpret_cast<uintptr_t>(dest_ptr) & 0xF);
-  assert_zero(reinterpret_cast<uintptr_t>(src_ptr) & 0xF);
-
-  auto dest = reinterpret_cast<uint64_t*>(dest_ptr);
-  auto src = reinterpret_cast<const uint64_t*>(src_ptr);
-  __m128i shufmask =
-      _mm_set_epi8(0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x00, 0x01,
-                   0x02, 0x03, 0x04, 0x05, 0x06, 0x07);
-
-  size_t i;
-  for (i = 0; i + 2 <= count; i += 2) {
-    __m128i input = _mm_load_si128(reinterpret_cast<const __m128i*>(&src[i]));
-    __m128i output = _mm_shuffle_epi8(input, shufmask);
-    _mm_store_si128(reinterpret_cast<__m128i*>(&dest[i]), output);
-  }
-  for (; i < count; ++i) {  // handle residual elements
-    dest[i] = byte_swap(src[i]);
-  }
+void copy_and_swap_64_aligned(void* dest, const void* src, size_t count) {
+  return copy_and_swap_64_unaligned(dest, src, count);
 }
 
 void copy_and_swap_64_unaligned(void* dest_ptr, const void* src_ptr,
                                 size_t count) {
   auto dest = reinterpret_cast<uint64_t*>(dest_ptr);
   auto src = reinterpret_cast<const uint64_t*>(src_ptr);
-  __m128i shufmask =
-      _mm_set_epi8(0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x00, 0x01,
-                   0x02, 0x03, 0x04, 0x05, 0x06, 0x07);
-
-  size_t i;
-  for (i = 0; i + 2 <= count; i += 2) {
-    __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&src[i]));
-    __m128i output = _mm_shuffle_epi8(input, shufmask);
-    _mm_storeu_si128(reinterpret_cast<__m128i*>(&dest[i]), output);
-  }
+  size_t i = copy_swap_kernel_(reinterpret_cast<uint8_t*>(dest),
+                               reinterpret_cast<const uint8_t*>(src),
+                               count * sizeof(uint64_t), kSwap64Shuffle) /
+             sizeof(uint64_t);
   for (; i < count; ++i) {  // handle residual elements
     dest[i] = byte_swap(src[i]);
   }
 }
 
-void copy_and_swap_16_in_32_aligned(void* dest_ptr, const void* src_ptr,
-                                    size_t count) {
-  auto dest = reinterpret_cast<uint64_t*>(dest_ptr);
-  auto src = reinterpret_cast<const uint64_t*>(src_ptr);
-  size_t i;
-  for (i = 0; i + 4 <= count; i += 4) {
-    __m128i input = _mm_load_si128(reinterpret_cast<const __m128i*>(&src[i]));
-    __m128i output =
-        _mm_or_si128(_mm_slli_epi32(input, 16), _mm_srli_epi32(input, 16));
-    _mm_store_si128(reinterpret_cast<__m128i*>(&dest[i]), output);
-  }
-  for (; i < count; ++i) {  // handle residual elements
-    dest[i] = (src[i] >> 16) | (src[i] << 16);
-  }
+void copy_and_swap_16_in_32_aligned(void* dest, const void* src, size_t count) {
+  return copy_and_swap_16_in_32_unaligned(dest, src, count);
 }
 
 void copy_and_swap_16_in_32_unaligned(void* dest_ptr, const void* src_ptr,
                                       size_t count) {
-  auto dest = reinterpret_cast<uint64_t*>(dest_ptr);
-  auto src = reinterpret_cast<const uint64_t*>(src_ptr);
-  size_t i;
-  for (i = 0; i + 4 <= count; i += 4) {
-    __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&src[i]));
-    __m128i output =
-        _mm_or_si128(_mm_slli_epi32(input, 16), _mm_srli_epi32(input, 16));
-    _mm_storeu_si128(reinterpret_cast<__m128i*>(&dest[i]), output);
-  }
+  auto dest = reinterpret_cast<uint32_t*>(dest_ptr);
+  auto src = reinterpret_cast<const uint32_t*>(src_ptr);
+  size_t i = copy_swap_kernel_(reinterpret_cast<uint8_t*>(dest),
+                               reinterpret_cast<const uint8_t*>(src),
+                               count * sizeof(uint32_t), kSwap16In32Shuffle) /
+             sizeof(uint32_t);
   for (; i < count; ++i) {  // handle residual elements
     dest[i] = (src[i] >> 16) | (src[i] << 16);
   }
@@ -229,8 +303,8 @@ void copy_and_swap_16_in_32_aligned(void* dest, const void* src, size_t count) {
 
 void copy_and_swap_16_in_32_unaligned(void* dest_ptr, const void* src_ptr,
                                       size_t count) {
-  auto dest = reinterpret_cast<uint64_t*>(dest_ptr);
-  auto src = reinterpret_cast<const uint64_t*>(src_ptr);
+  auto dest = reinterpret_cast<uint32_t*>(dest_ptr);
+  auto src = reinterpret_cast<const uint32_t*>(src_ptr);
   for (size_t i = 0; i < count; ++i) {
     dest[i] = (src[i] >> 16) | (src[i] << 16);
   }
@@ -125,6 +125,10 @@ inline void* low_address(void* address) {
 
 void copy_128_aligned(void* dest, const void* src, size_t count);
 
+// Copies count elements, swapping the byte order of each (or, for 16_in_32,
+// the two 16-bit halves of each 32-bit element). On x64 the widest vector
+// kernel the CPU supports is picked on first use, and large copies bypass the
+// cache on the destination side.
 void copy_and_swap_16_aligned(void* dest, const void* src, size_t count);
 void copy_and_swap_16_unaligned(void* dest, const void* src, size_t count);
 void copy_and_swap_32_aligned(void* dest, const void* src, size_t count);
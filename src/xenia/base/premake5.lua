@@ -16,4 +16,20 @@ project("xenia-base")
     "debug_visualizers.natvis",
   })
 
+group("src")
+project("xenia-base-bench")
+  uuid("e1a7c3f2-5b84-4d9e-8f06-3a2d91c7b4e5")
+  kind("ConsoleApp")
+  language("C++")
+  links({
+    "fmt",
+    "xenia-base",
+  })
+  defines({
+  })
+  files({
+    "base_bench_main.cc",
+    "main_"..platform_suffix..".cc",
+  })
+
 include("testing")
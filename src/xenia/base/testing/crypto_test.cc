@@ -0,0 +1,123 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/base/crypto.h"
+
+#include <cstring>
+#include <vector>
+
+#include "third_party/catch/include/catch.hpp"
+#include "third_party/crypto/TinySHA1.hpp"
+#include "third_party/crypto/rijndael-alg-fst.h"
+
+namespace xe {
+namespace base {
+namespace test {
+
+static std::vector<uint8_t> MakeTestData(size_t length) {
+  std::vector<uint8_t> data(length);
+  uint32_t value = 0x12345678;
+  for (auto& byte : data) {
+    value = value * 1664525 + 1013904223;
+    byte = uint8_t(value >> 24);
+  }
+  return data;
+}
+
+TEST_CASE("Aes128CbcDecrypt known answer", "Crypto") {
+  // NIST SP 800-38A F.2.2, CBC-AES128.Decrypt.
+  const uint8_t key[16] = {0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6,
+                           0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C};
+  const uint8_t ciphertext[32] = {
+      0x76, 0x49, 0xAB, 0xAC, 0x81, 0x19, 0xB2, 0x46, 0xCE, 0xE9, 0x8E,
+      0x9B, 0x12, 0xE9, 0x19, 0x7D, 0x50, 0x86, 0xCB, 0x9B, 0x50, 0x72,
+      0x19, 0xEE, 0x95, 0xDB, 0x11, 0x3A, 0x91, 0x76, 0x78, 0xB2};
+  const uint8_t plaintext[32] = {
+      0x6B, 0xC1, 0xBE, 0xE2, 0x2E, 0x40, 0x9F, 0x96, 0xE9, 0x3D, 0x7E,
+      0x11, 0x73, 0x93, 0x17, 0x2A, 0xAE, 0x2D, 0x8A, 0x57, 0x1E, 0x03,
+      0xAC, 0x9C, 0x9E, 0xB7, 0x6F, 0xAC, 0x45, 0xAF, 0x8E, 0x51};
+  uint8_t iv[16];
+  for (uint8_t i = 0; i < 16; ++i) {
+    iv[i] = i;
+  }
+  uint8_t output[32];
+  crypto::Aes128CbcDecrypt(key, iv, ciphertext, output, sizeof(output));
+  REQUIRE(std::memcmp(output, plaintext, sizeof(plaintext)) == 0);
+  REQUIRE(std::memcmp(iv, ciphertext + 16, 16) == 0);
+}
+
+TEST_CASE("Aes128CbcDecrypt matches reference", "Crypto") {
+  auto key = MakeTestData(16);
+  auto input = MakeTestData(4096);
+  uint32_t rk[4 * (MAXNR + 1)];
+  int Nr = rijndaelKeySetupDec(rk, key.data(), 128);
+  // Lengths around the multi-block batch sizes of the vectorized paths.
+  for (size_t block_count : {1, 7, 8, 9, 15, 16, 17, 33, 256}) {
+    size_t length = block_count * 16;
+    std::vector<uint8_t> expected(length);
+    uint8_t expected_iv[16] = {};
+    for (size_t n = 0; n < block_count; ++n) {
+      rijndaelDecrypt(rk, Nr, &input[n * 16], &expected[n * 16]);
+      for (size_t i = 0; i < 16; ++i) {
+        expected[n * 16 + i] ^= expected_iv[i];
+        expected_iv[i] = input[n * 16 + i];
+      }
+    }
+
+    std::vector<uint8_t> output(length);
+    uint8_t iv[16] = {};
+    crypto::Aes128CbcDecrypt(key.data(), iv, input.data(), output.data(),
+                             length);
+    REQUIRE(output == expected);
+    REQUIRE(std::memcmp(iv, expected_iv, 16) == 0);
+
+    // In place, split in two calls.
+    std::vector<uint8_t> in_place(input.begin(), input.begin() + length);
+    std::memset(iv, 0, sizeof(iv));
+    size_t split = (block_count / 2) * 16;
+    crypto::Aes128CbcDecrypt(key.data(), iv, in_place.data(), in_place.data(),
+                             split);
+    crypto::Aes128CbcDecrypt(key.data(), iv, in_place.data() + split,
+                             in_place.data() + split, length - split);
+    REQUIRE(in_place == expected);
+  }
+}
+
+TEST_CASE("Sha1 known answer", "Crypto") {
+  const uint8_t abc_digest[20] = {0xA9, 0x99, 0x3E, 0x36, 0x47, 0x06, 0x81,
+                                  0x6A, 0xBA, 0x3E, 0x25, 0x71, 0x78, 0x50,
+                                  0xC2, 0x6C, 0x9C, 0xD0, 0xD8, 0x9D};
+  uint8_t digest[20];
+  crypto::Sha1("abc", 3, digest);
+  REQUIRE(std::memcmp(digest, abc_digest, 20) == 0);
+
+  const uint8_t empty_digest[20] = {0xDA, 0x39, 0xA3, 0xEE, 0x5E, 0x6B, 0x4B,
+                                    0x0D, 0x32, 0x55, 0xBF, 0xEF, 0x95, 0x60,
+                                    0x18, 0x90, 0xAF, 0xD8, 0x07, 0x09};
+  crypto::Sha1(nullptr, 0, digest);
+  REQUIRE(std::memcmp(digest, empty_digest, 20) == 0);
+}
+
+TEST_CASE("Sha1 matches reference", "Crypto") {
+  auto data = MakeTestData(1024);
+  // Every tail length, for both one and two padding blocks.
+  for (size_t length = 0; length <= 200; ++length) {
+    uint8_t expected[20];
+    sha1::SHA1 s;
+    s.processBytes(data.data(), length);
+    s.finalize(expected);
+    uint8_t digest[20];
+    crypto::Sha1(data.data(), length, digest);
+    REQUIRE(std::memcmp(digest, expected, 20) == 0);
+  }
+}
+
+}  // namespace test
+}  // namespace base
+}  // namespace xe
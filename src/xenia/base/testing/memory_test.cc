@@ -9,6 +9,10 @@
 
 #include "xenia/base/memory.h"
 
+#include <vector>
+
+#include "xenia/base/math.h"
+
 #include "third_party/catch/include/catch.hpp"
 
 namespace xe {
@@ -405,13 +409,64 @@ TEST_CASE("copy_and_swap_64_unaligned", "Copy and Swap") {
 }
 
 TEST_CASE("copy_and_swap_16_in_32_aligned", "Copy and Swap") {
-  // TODO(bwrsandman): test once properly understood.
-  REQUIRE(true == true);
+  alignas(16) uint32_t a[5] = {};
+  alignas(16) uint32_t b[5] = {0x01234567, 0x89ABCDEF, 0xE887EEED, 0xD8514199,
+                               0x21D4745A};
+  copy_and_swap_16_in_32_aligned(a, b, 5);
+  REQUIRE(a[0] == 0x45670123);
+  REQUIRE(a[1] == 0xCDEF89AB);
+  REQUIRE(a[2] == 0xEEEDE887);
+  REQUIRE(a[3] == 0x4199D851);
+  REQUIRE(a[4] == 0x745A21D4);
 }
 
 TEST_CASE("copy_and_swap_16_in_32_unaligned", "Copy and Swap") {
-  // TODO(bwrsandman): test once properly understood.
-  REQUIRE(true == true);
+  uint8_t a[4 * 9 + 1] = {};
+  uint8_t b[4 * 9 + 1];
+  for (size_t i = 0; i < xe::countof(b); ++i) {
+    b[i] = uint8_t(i);
+  }
+  copy_and_swap_16_in_32_unaligned(a + 1, b + 1, 9);
+  REQUIRE(a[0] == 0);
+  for (size_t i = 0; i < 9; ++i) {
+    REQUIRE(a[1 + i * 4 + 0] == b[1 + i * 4 + 2]);
+    REQUIRE(a[1 + i * 4 + 1] == b[1 + i * 4 + 3]);
+    REQUIRE(a[1 + i * 4 + 2] == b[1 + i * 4 + 0]);
+    REQUIRE(a[1 + i * 4 + 3] == b[1 + i * 4 + 1]);
+  }
+}
+
+TEST_CASE("copy_and_swap_sizes", "Copy and Swap") {
+  // Covers the vector kernels, their remainders and, past 4 MB, the
+  // non-temporal path, at several alignments.
+  std::vector<uint8_t> src(4 * 1024 * 1024 + 64);
+  for (size_t i = 0; i < src.size(); ++i) {
+    src[i] = uint8_t(i * 7 + (i >> 8));
+  }
+  std::vector<uint8_t> dest(src.size());
+  for (size_t size : {size_t(0), size_t(8), size_t(24), size_t(40),
+                      size_t(72), size_t(200), size_t(1000),
+                      size_t(4 * 1024 * 1024)}) {
+    for (size_t offset = 0; offset < 64; offset += 8) {
+      std::fill(dest.begin(), dest.end(), uint8_t(0xCD));
+      copy_and_swap_16_unaligned(&dest[offset], &src[offset], size / 2);
+      for (size_t i = 0; i < size; ++i) {
+        REQUIRE(dest[offset + i] == src[offset + (i ^ 1)]);
+      }
+      REQUIRE(dest[offset + size] == 0xCD);
+
+      copy_and_swap_32_unaligned(&dest[offset], &src[offset], size / 4);
+      for (size_t i = 0; i < size; ++i) {
+        REQUIRE(dest[offset + i] == src[offset + (i ^ 3)]);
+      }
+
+      copy_and_swap_64_unaligned(&dest[offset], &src[offset], size / 8);
+      for (size_t i = 0; i < size; ++i) {
+        REQUIRE(dest[offset + i] == src[offset + (i ^ 7)]);
+      }
+      REQUIRE(dest[offset + size] == 0xCD);
+    }
+  }
 }
 
 }  // namespace test
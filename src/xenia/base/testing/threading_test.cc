@@ -0,0 +1,63 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/base/threading.h"
+
+#include "third_party/catch/include/catch.hpp"
+
+namespace xe {
+namespace base {
+namespace test {
+
+using xe::threading::ParkingLot;
+
+TEST_CASE("ParkingLot wake before park", "Parking Lot") {
+  int key = 0;
+  ParkingLot::Unpark(reinterpret_cast<uintptr_t>(&key));
+  ParkingLot::Unpark(reinterpret_cast<uintptr_t>(&key));
+  // Both wakes are banked, so neither of these blocks.
+  ParkingLot::Park(reinterpret_cast<uintptr_t>(&key));
+  ParkingLot::Park(reinterpret_cast<uintptr_t>(&key));
+}
+
+TEST_CASE("ParkingLot contention", "Parking Lot") {
+  // Simple lock in the style of RtlEnterCriticalSection: -1 when free,
+  // otherwise the number of threads waiting for it.
+  for (uint32_t thread_count = 2; thread_count <= 8; thread_count *= 2) {
+    std::atomic<int32_t> lock_count(-1);
+    uint32_t counter = 0;
+    const uint32_t iterations = 10000;
+    auto key = reinterpret_cast<uintptr_t>(&lock_count);
+
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < thread_count; ++i) {
+      threads.emplace_back([&] {
+        for (uint32_t j = 0; j < iterations; ++j) {
+          if (lock_count.fetch_add(1) != -1) {
+            ParkingLot::Park(key);
+          }
+          ++counter;
+          if (lock_count.fetch_sub(1) != 0) {
+            ParkingLot::Unpark(key);
+          }
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    REQUIRE(counter == thread_count * iterations);
+    REQUIRE(lock_count == -1);
+  }
+}
+
+}  // namespace test
+}  // namespace base
+}  // namespace xe
@@ -29,5 +29,39 @@ uint32_t current_thread_id() {
 
 void set_current_thread_id(uint32_t id) { current_thread_id_ = id; }
 
+ParkingLot::Bucket& ParkingLot::GetBucket(uintptr_t key) {
+  static Bucket buckets[kBucketCount];
+  // Keys are usually aligned addresses, so mix in the high bits.
+  uint64_t hash = uint64_t(key) * 0x9E3779B97F4A7C15ull;
+  return buckets[(hash >> 32) % kBucketCount];
+}
+
+void ParkingLot::Park(uintptr_t key) {
+  auto& bucket = GetBucket(key);
+  std::unique_lock<std::mutex> lock(bucket.mutex);
+  // References into the map stay valid across inserts of other keys, and the
+  // queue is only erased once it has no waiters left.
+  auto& queue = bucket.queues[key];
+  if (!queue.wake_count) {
+    ++queue.waiter_count;
+    queue.cond.wait(lock, [&queue] { return queue.wake_count != 0; });
+    --queue.waiter_count;
+  }
+  --queue.wake_count;
+  if (!queue.waiter_count && !queue.wake_count) {
+    bucket.queues.erase(key);
+  }
+}
+
+void ParkingLot::Unpark(uintptr_t key) {
+  auto& bucket = GetBucket(key);
+  std::lock_guard<std::mutex> lock(bucket.mutex);
+  auto& queue = bucket.queues[key];
+  ++queue.wake_count;
+  if (queue.waiter_count) {
+    queue.cond.notify_one();
+  }
+}
+
 }  // namespace threading
 }  // namespace xe
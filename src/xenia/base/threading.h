@@ -21,6 +21,7 @@
 #include <mutex>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -49,6 +50,32 @@ class Fence {
   std::atomic<bool> signaled_;
 };
 
+// Global table of wait queues keyed by an arbitrary address, in the spirit of
+// Linux futexes and WebKit's ParkingLot. Lets lock implementations block
+// without owning any kernel object of their own.
+// Wakes are counted: an Unpark that happens before the matching Park is not
+// lost, which makes each key behave like a lazily created semaphore.
+class ParkingLot {
+ public:
+  // Blocks the calling thread until a wake is available for the key.
+  static void Park(uintptr_t key);
+  // Releases one wake for the key, waking a parked thread if there is one.
+  static void Unpark(uintptr_t key);
+
+ private:
+  struct Queue {
+    std::condition_variable cond;
+    uint32_t waiter_count = 0;
+    uint32_t wake_count = 0;
+  };
+  struct Bucket {
+    std::mutex mutex;
+    std::unordered_map<uintptr_t, Queue> queues;
+  };
+  static constexpr size_t kBucketCount = 64;
+  static Bucket& GetBucket(uintptr_t key);
+};
+
 // Returns the total number of logical processors in the host system.
 uint32_t logical_processor_count();
 
@@ -78,11 +105,28 @@ void MaybeYield();
 // Memory barrier (request - may be ignored).
 void SyncMemory();
 
+// How waits and sleeps handle timeouts shorter than the OS wait primitives can
+// honor, which may oversleep by up to a scheduler quantum.
+enum class WaitPrecision {
+  // Always block in the OS. For host threads, which shouldn't burn a core on
+  // short sleeps in a loop.
+  kCoarse,
+  // Block in the OS for all but the last kSpinWaitThreshold of the timeout,
+  // then poll until the deadline. For guest waits and delays, which can ask
+  // for sub-millisecond timeouts.
+  kPrecise,
+};
+constexpr std::chrono::nanoseconds kSpinWaitThreshold =
+    std::chrono::milliseconds(1);
+
 // Sleeps the current thread for at least as long as the given duration.
-void Sleep(std::chrono::microseconds duration);
+void Sleep(std::chrono::nanoseconds duration,
+           WaitPrecision precision = WaitPrecision::kCoarse);
 template <typename Rep, typename Period>
-void Sleep(std::chrono::duration<Rep, Period> duration) {
-  Sleep(std::chrono::duration_cast<std::chrono::microseconds>(duration));
+void Sleep(std::chrono::duration<Rep, Period> duration,
+           WaitPrecision precision = WaitPrecision::kCoarse) {
+  Sleep(std::chrono::duration_cast<std::chrono::nanoseconds>(duration),
+        precision);
 }
 
 enum class SleepResult {
@@ -93,11 +137,14 @@ enum class SleepResult {
 // The thread is put in an alertable state and may wake to dispatch user
 // callbacks. If this happens the sleep returns early with
 // SleepResult::kAlerted.
-SleepResult AlertableSleep(std::chrono::microseconds duration);
+SleepResult AlertableSleep(std::chrono::nanoseconds duration,
+                           WaitPrecision precision = WaitPrecision::kCoarse);
 template <typename Rep, typename Period>
-SleepResult AlertableSleep(std::chrono::duration<Rep, Period> duration) {
+SleepResult AlertableSleep(std::chrono::duration<Rep, Period> duration,
+                           WaitPrecision precision = WaitPrecision::kCoarse) {
   return AlertableSleep(
-      std::chrono::duration_cast<std::chrono::microseconds>(duration));
+      std::chrono::duration_cast<std::chrono::nanoseconds>(duration),
+      precision);
 }
 
 typedef uint32_t TlsHandle;
@@ -162,7 +209,8 @@ class WaitHandle {
 // if the timeout is max() the wait will not time out.
 WaitResult Wait(
     WaitHandle* wait_handle, bool is_alertable,
-    std::chrono::milliseconds timeout = std::chrono::milliseconds::max());
+    std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max(),
+    WaitPrecision precision = WaitPrecision::kCoarse);
 
 // Signals one object and waits on another object as a single operation.
 // Waits until the wait handle is in the signaled state, an alert triggers and
@@ -172,12 +220,14 @@ WaitResult Wait(
 WaitResult SignalAndWait(
     WaitHandle* wait_handle_to_signal, WaitHandle* wait_handle_to_wait_on,
     bool is_alertable,
-    std::chrono::milliseconds timeout = std::chrono::milliseconds::max());
+    std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max(),
+    WaitPrecision precision = WaitPrecision::kCoarse);
 
 std::pair<WaitResult, size_t> WaitMultiple(
     WaitHandle* wait_handles[], size_t wait_handle_count, bool wait_all,
     bool is_alertable,
-    std::chrono::milliseconds timeout = std::chrono::milliseconds::max());
+    std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max(),
+    WaitPrecision precision = WaitPrecision::kCoarse);
 
 // Waits until all of the specified objects are in the signaled state, a
 // user callback is queued to the thread, or the time-out interval elapses.
@@ -185,16 +235,18 @@ std::pair<WaitResult, size_t> WaitMultiple(
 // if the timeout is max() the wait will not time out.
 inline WaitResult WaitAll(
     WaitHandle* wait_handles[], size_t wait_handle_count, bool is_alertable,
-    std::chrono::milliseconds timeout = std::chrono::milliseconds::max()) {
+    std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max(),
+    WaitPrecision precision = WaitPrecision::kCoarse) {
   return WaitMultiple(wait_handles, wait_handle_count, true, is_alertable,
-                      timeout)
+                      timeout, precision)
       .first;
 }
 inline WaitResult WaitAll(
     std::vector<WaitHandle*> wait_handles, bool is_alertable,
-    std::chrono::milliseconds timeout = std::chrono::milliseconds::max()) {
+    std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max(),
+    WaitPrecision precision = WaitPrecision::kCoarse) {
   return WaitAll(wait_handles.data(), wait_handles.size(), is_alertable,
-                 timeout);
+                 timeout, precision);
 }
 
 // Waits until any of the specified objects are in the signaled state, a
@@ -205,15 +257,17 @@ inline WaitResult WaitAll(
 // the wait to be satisfied or abandoned.
 inline std::pair<WaitResult, size_t> WaitAny(
     WaitHandle* wait_handles[], size_t wait_handle_count, bool is_alertable,
-    std::chrono::milliseconds timeout = std::chrono::milliseconds::max()) {
+    std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max(),
+    WaitPrecision precision = WaitPrecision::kCoarse) {
   return WaitMultiple(wait_handles, wait_handle_count, false, is_alertable,
-                      timeout);
+                      timeout, precision);
 }
 inline std::pair<WaitResult, size_t> WaitAny(
     std::vector<WaitHandle*> wait_handles, bool is_alertable,
-    std::chrono::milliseconds timeout = std::chrono::milliseconds::max()) {
+    std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max(),
+    WaitPrecision precision = WaitPrecision::kCoarse) {
   return WaitAny(wait_handles.data(), wait_handles.size(), is_alertable,
-                 timeout);
+                 timeout, precision);
 }
 
 // Models a Win32-like event object.
@@ -32,8 +32,9 @@ void set_name(std::thread::native_handle_type handle, const std::string& name) {
 
 void MaybeYield() { pthread_yield_np(); }
 
-void Sleep(std::chrono::microseconds duration) {
-  timespec rqtp = {duration.count() / 1000000, duration.count() % 1000};
+void Sleep(std::chrono::nanoseconds duration, WaitPrecision precision) {
+  timespec rqtp = {time_t(duration.count() / 1000000000),
+                   long(duration.count() % 1000000000)};
   nanosleep(&rqtp, nullptr);
   // TODO(benvanik): spin while rmtp >0?
 }
@@ -12,6 +12,7 @@
 #include "xenia/base/assert.h"
 #include "xenia/base/logging.h"
 
+#include <poll.h>
 #include <pthread.h>
 #include <sys/eventfd.h>
 #include <sys/syscall.h>
@@ -46,16 +47,40 @@ void MaybeYield() {
 
 void SyncMemory() { __sync_synchronize(); }
 
-void Sleep(std::chrono::microseconds duration) {
-  timespec rqtp = {time_t(duration.count() / 1000000),
-                   time_t(duration.count() % 1000)};
-  nanosleep(&rqtp, nullptr);
-  // TODO(benvanik): spin while rmtp >0?
+static timespec DurationToTimespec(std::chrono::nanoseconds duration) {
+  return timespec{time_t(duration.count() / 1000000000),
+                  long(duration.count() % 1000000000)};
+}
+
+static void NanoSleep(std::chrono::nanoseconds duration) {
+  timespec rqtp = DurationToTimespec(duration);
+  while (nanosleep(&rqtp, &rqtp) == -1 && errno == EINTR) {
+  }
+}
+
+void Sleep(std::chrono::nanoseconds duration, WaitPrecision precision) {
+  if (duration <= std::chrono::nanoseconds::zero()) {
+    MaybeYield();
+    return;
+  }
+  if (precision == WaitPrecision::kCoarse) {
+    NanoSleep(duration);
+    return;
+  }
+  auto deadline = std::chrono::steady_clock::now() + duration;
+  if (duration > kSpinWaitThreshold) {
+    NanoSleep(duration - kSpinWaitThreshold);
+  }
+  // Spin out the remainder, as nanosleep may overshoot by the timer slack.
+  while (std::chrono::steady_clock::now() < deadline) {
+    MaybeYield();
+  }
 }
 
 // TODO(dougvj) Not sure how to implement the equivalent of this on POSIX.
-SleepResult AlertableSleep(std::chrono::microseconds duration) {
-  sleep(duration.count() / 1000);
+SleepResult AlertableSleep(std::chrono::nanoseconds duration,
+                           WaitPrecision precision) {
+  Sleep(duration, precision);
   return SleepResult::kSuccess;
 }
 
@@ -223,19 +248,32 @@ class PosixFdHandle : public T {
 
 // TODO(dougvj)
 WaitResult Wait(WaitHandle* wait_handle, bool is_alertable,
-                std::chrono::milliseconds timeout) {
+                std::chrono::nanoseconds timeout, WaitPrecision precision) {
   intptr_t handle = reinterpret_cast<intptr_t>(wait_handle->native_handle());
 
-  fd_set set;
-  struct timeval time_val;
+  pollfd poll_fd = {int(handle), POLLIN, 0};
   int ret;
-
-  FD_ZERO(&set);
-  FD_SET(handle, &set);
-
-  time_val.tv_sec = timeout.count() / 1000;
-  time_val.tv_usec = timeout.count() * 1000;
-  ret = select(handle + 1, &set, NULL, NULL, &time_val);
+  if (precision == WaitPrecision::kPrecise &&
+      timeout > std::chrono::nanoseconds::zero() &&
+      timeout != std::chrono::nanoseconds::max()) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    timespec timeout_ts = DurationToTimespec(
+        timeout > kSpinWaitThreshold ? timeout - kSpinWaitThreshold
+                                     : std::chrono::nanoseconds::zero());
+    ret = ppoll(&poll_fd, 1, &timeout_ts, nullptr);
+    // Poll out the remainder, as ppoll may overshoot by the timer slack.
+    timespec zero_ts = {};
+    while (!ret && std::chrono::steady_clock::now() < deadline) {
+      MaybeYield();
+      ret = ppoll(&poll_fd, 1, &zero_ts, nullptr);
+    }
+  } else {
+    timespec timeout_ts = DurationToTimespec(timeout);
+    ret = ppoll(&poll_fd, 1,
+                timeout == std::chrono::nanoseconds::max() ? nullptr
+                                                           : &timeout_ts,
+                nullptr);
+  }
   if (ret == -1) {
     return WaitResult::kFailed;
   } else if (ret == 0) {
@@ -254,7 +292,8 @@ WaitResult Wait(WaitHandle* wait_handle, bool is_alertable,
 // TODO(dougvj)
 WaitResult SignalAndWait(WaitHandle* wait_handle_to_signal,
                          WaitHandle* wait_handle_to_wait_on, bool is_alertable,
-                         std::chrono::milliseconds timeout) {
+                         std::chrono::nanoseconds timeout,
+                         WaitPrecision precision) {
   assert_always();
   return WaitResult::kFailed;
 }
@@ -263,7 +302,8 @@ WaitResult SignalAndWait(WaitHandle* wait_handle_to_signal,
 std::pair<WaitResult, size_t> WaitMultiple(WaitHandle* wait_handles[],
                                            size_t wait_handle_count,
                                            bool wait_all, bool is_alertable,
-                                           std::chrono::milliseconds timeout) {
+                                           std::chrono::nanoseconds timeout,
+                                           WaitPrecision precision) {
   assert_always();
   return std::pair<WaitResult, size_t>(WaitResult::kFailed, 0);
 }
@@ -295,7 +335,7 @@ std::unique_ptr<Event> Event::CreateAutoResetEvent(bool initial_state) {
     return nullptr;
   }
 
-  return std::make_unique<PosixEvent>(PosixEvent(fd));
+  return std::make_unique<PosixEvent>(fd);
 }
 
 // TODO(dougvj)
@@ -80,17 +80,66 @@ void MaybeYield() {
 
 void SyncMemory() { MemoryBarrier(); }
 
-void Sleep(std::chrono::microseconds duration) {
-  if (duration.count() < 100) {
-    MaybeYield();
-  } else {
-    ::Sleep(static_cast<DWORD>(duration.count() / 1000));
+// Converts a timeout to the millisecond granularity of the Win32 wait
+// functions, rounding down. Precise waits poll out the remainder.
+static DWORD TimeoutToMillis(std::chrono::nanoseconds timeout) {
+  if (timeout == std::chrono::nanoseconds::max()) {
+    return INFINITE;
+  } else if (timeout <= std::chrono::nanoseconds::zero()) {
+    return 0;
+  }
+  int64_t timeout_ms =
+      std::chrono::duration_cast<std::chrono::milliseconds>(timeout).count();
+  return DWORD(std::min(timeout_ms, int64_t(INFINITE - 1)));
+}
+
+// Runs a Win32 wait function. Precise waits block for all but the last
+// kSpinWaitThreshold, which the OS may overshoot by a scheduler quantum, and
+// poll until the deadline after that. wait_fn takes a timeout in milliseconds
+// and returns a WAIT_* code.
+template <typename F>
+static DWORD HybridWait(std::chrono::nanoseconds timeout,
+                        WaitPrecision precision, F wait_fn) {
+  if (precision == WaitPrecision::kCoarse ||
+      timeout == std::chrono::nanoseconds::max() ||
+      timeout <= std::chrono::nanoseconds::zero()) {
+    return wait_fn(TimeoutToMillis(timeout));
+  }
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  DWORD result = wait_fn(TimeoutToMillis(timeout - kSpinWaitThreshold));
+  while (result == WAIT_TIMEOUT &&
+         std::chrono::steady_clock::now() < deadline) {
+    YieldProcessor();
+    result = wait_fn(0);
+  }
+  return result;
+}
+
+void Sleep(std::chrono::nanoseconds duration, WaitPrecision precision) {
+  if (precision == WaitPrecision::kCoarse) {
+    if (duration < std::chrono::microseconds(100)) {
+      MaybeYield();
+    } else {
+      ::Sleep(TimeoutToMillis(duration));
+    }
+    return;
+  }
+  auto deadline = std::chrono::steady_clock::now() + duration;
+  if (duration > kSpinWaitThreshold) {
+    ::Sleep(TimeoutToMillis(duration - kSpinWaitThreshold));
   }
+  do {
+    MaybeYield();
+  } while (std::chrono::steady_clock::now() < deadline);
 }
 
-SleepResult AlertableSleep(std::chrono::microseconds duration) {
-  if (SleepEx(static_cast<DWORD>(duration.count() / 1000), TRUE) ==
-      WAIT_IO_COMPLETION) {
+SleepResult AlertableSleep(std::chrono::nanoseconds duration,
+                           WaitPrecision precision) {
+  DWORD result = HybridWait(duration, precision, [](DWORD timeout_ms) -> DWORD {
+    return SleepEx(timeout_ms, TRUE) == WAIT_IO_COMPLETION ? WAIT_IO_COMPLETION
+                                                            : WAIT_TIMEOUT;
+  });
+  if (result == WAIT_IO_COMPLETION) {
     return SleepResult::kAlerted;
   }
   return SleepResult::kSuccess;
@@ -162,10 +211,12 @@ class Win32Handle : public T {
 };
 
 WaitResult Wait(WaitHandle* wait_handle, bool is_alertable,
-                std::chrono::milliseconds timeout) {
+                std::chrono::nanoseconds timeout, WaitPrecision precision) {
   HANDLE handle = wait_handle->native_handle();
-  DWORD result = WaitForSingleObjectEx(handle, DWORD(timeout.count()),
-                                       is_alertable ? TRUE : FALSE);
+  DWORD result = HybridWait(timeout, precision, [&](DWORD timeout_ms) {
+    return WaitForSingleObjectEx(handle, timeout_ms,
+                                 is_alertable ? TRUE : FALSE);
+  });
   switch (result) {
     case WAIT_OBJECT_0:
       return WaitResult::kSuccess;
@@ -183,12 +234,21 @@ WaitResult Wait(WaitHandle* wait_handle, bool is_alertable,
 
 WaitResult SignalAndWait(WaitHandle* wait_handle_to_signal,
                          WaitHandle* wait_handle_to_wait_on, bool is_alertable,
-                         std::chrono::milliseconds timeout) {
+                         std::chrono::nanoseconds timeout,
+                         WaitPrecision precision) {
   HANDLE handle_to_signal = wait_handle_to_signal->native_handle();
   HANDLE handle_to_wait_on = wait_handle_to_wait_on->native_handle();
-  DWORD result =
-      SignalObjectAndWait(handle_to_signal, handle_to_wait_on,
-                          DWORD(timeout.count()), is_alertable ? TRUE : FALSE);
+  bool signaled = false;
+  DWORD result = HybridWait(timeout, precision, [&](DWORD timeout_ms) {
+    // Only the first wait may signal; polls just wait.
+    if (signaled) {
+      return WaitForSingleObjectEx(handle_to_wait_on, timeout_ms,
+                                   is_alertable ? TRUE : FALSE);
+    }
+    signaled = true;
+    return SignalObjectAndWait(handle_to_signal, handle_to_wait_on, timeout_ms,
+                               is_alertable ? TRUE : FALSE);
+  });
   switch (result) {
     case WAIT_OBJECT_0:
       return WaitResult::kSuccess;
@@ -207,14 +267,17 @@ WaitResult SignalAndWait(WaitHandle* wait_handle_to_signal,
 std::pair<WaitResult, size_t> WaitMultiple(WaitHandle* wait_handles[],
                                            size_t wait_handle_count,
                                            bool wait_all, bool is_alertable,
-                                           std::chrono::milliseconds timeout) {
+                                           std::chrono::nanoseconds timeout,
+                                           WaitPrecision precision) {
   std::vector<HANDLE> handles(wait_handle_count);
   for (size_t i = 0; i < wait_handle_count; ++i) {
     handles[i] = wait_handles[i]->native_handle();
   }
-  DWORD result = WaitForMultipleObjectsEx(
-      DWORD(handles.size()), handles.data(), wait_all ? TRUE : FALSE,
-      DWORD(timeout.count()), is_alertable ? TRUE : FALSE);
+  DWORD result = HybridWait(timeout, precision, [&](DWORD timeout_ms) {
+    return WaitForMultipleObjectsEx(DWORD(handles.size()), handles.data(),
+                                    wait_all ? TRUE : FALSE, timeout_ms,
+                                    is_alertable ? TRUE : FALSE);
+  });
   if (result >= WAIT_OBJECT_0 && result < WAIT_OBJECT_0 + handles.size()) {
     return std::pair<WaitResult, size_t>(WaitResult::kSuccess,
                                          result - WAIT_OBJECT_0);
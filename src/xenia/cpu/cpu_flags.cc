@@ -48,3 +48,9 @@ DEFINE_bool(break_condition_truncate, true, "truncate value to 32-bits", "CPU");
 
 DEFINE_bool(break_on_debugbreak, true, "int3 on JITed __debugbreak requests.",
             "CPU");
+
+DEFINE_path(xex_image_cache_path, "",
+            "Directory to keep decompressed and patched XEX images in, so "
+            "that later launches skip decryption, decompression and title "
+            "update patching. Empty to disable.",
+            "CPU");
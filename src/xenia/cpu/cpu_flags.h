@@ -34,4 +34,6 @@ DECLARE_bool(break_condition_truncate);
 
 DECLARE_bool(break_on_debugbreak);
 
+DECLARE_path(xex_image_cache_path);
+
 #endif  // XENIA_CPU_CPU_FLAGS_H_
@@ -11,6 +11,7 @@
 
 #include <algorithm>
 #include <climits>
+#include <memory>
 
 #include "xenia/base/byte_order.h"
 #include "xenia/base/logging.h"
@@ -93,32 +94,46 @@ mspack_system* mspack_memory_sys_create() {
 
 void mspack_memory_sys_destroy(struct mspack_system* sys) { free(sys); }
 
-int lzx_decompress(const void* lzx_data, size_t lzx_len, void* dest,
-                   size_t dest_len, uint32_t window_size, void* window_data,
-                   size_t window_data_len) {
-  int result_code = 1;
+typedef struct mspack_stream_file_t {
+  const std::function<size_t(void* buffer, size_t length)>* read_input;
+} mspack_stream_file;
 
-  uint32_t window_bits;
-  if (!xe::bit_scan_forward(window_size, &window_bits)) {
-    return result_code;
-  }
+int mspack_stream_read(mspack_file* file, void* buffer, int chars) {
+  auto streamfile = (mspack_stream_file*)file;
+  return (int)(*streamfile->read_input)(buffer, size_t(std::max(chars, 0)));
+}
+
+static int lzx_decompress(mspack_system* sys, const void* lzx_data,
+                          size_t lzx_len, void* dest, size_t dest_len,
+                          uint32_t window_bits, void* window_data,
+                          size_t window_data_len) {
+  int result_code = 1;
 
-  mspack_system* sys = mspack_memory_sys_create();
   mspack_memory_file* lzxsrc =
       mspack_memory_open(sys, (void*)lzx_data, lzx_len);
   mspack_memory_file* lzxdst = mspack_memory_open(sys, dest, dest_len);
-  lzxd_stream* lzxd = lzxd_init(sys, (mspack_file*)lzxsrc, (mspack_file*)lzxdst,
-                                window_bits, 0, 0x8000, (off_t)dest_len, 0);
+  lzxd_stream* lzxd = nullptr;
+  if (lzxsrc && lzxdst) {
+    lzxd = lzxd_init(sys, (mspack_file*)lzxsrc, (mspack_file*)lzxdst,
+                     window_bits, 0, 0x8000, (off_t)dest_len, 0);
+  }
 
   if (lzxd) {
     if (window_data) {
+      // Only the end of the reference data can be matched against if it's
+      // larger than the window.
+      size_t window_size = size_t(1) << window_bits;
+      if (window_data_len > window_size) {
+        window_data = (uint8_t*)window_data + window_data_len - window_size;
+        window_data_len = window_size;
+      }
       // zero the window and then copy window_data to the end of it
       auto padding_len = window_size - window_data_len;
       std::memset(&lzxd->window[0], 0, padding_len);
       std::memcpy(&lzxd->window[padding_len], window_data, window_data_len);
       // TODO(gibbed): should this be set regardless if source window data is
       // available or not?
-      lzxd->ref_data_size = window_size;
+      lzxd->ref_data_size = (unsigned int)window_size;
     }
 
     result_code = lzxd_decompress(lzxd, (off_t)dest_len);
@@ -137,11 +152,57 @@ int lzx_decompress(const void* lzx_data, size_t lzx_len, void* dest,
     lzxdst = NULL;
   }
 
-  if (sys) {
-    mspack_memory_sys_destroy(sys);
-    sys = NULL;
+  return result_code;
+}
+
+int lzx_decompress(const void* lzx_data, size_t lzx_len, void* dest,
+                   size_t dest_len, uint32_t window_size, void* window_data,
+                   size_t window_data_len) {
+  uint32_t window_bits;
+  if (!xe::bit_scan_forward(window_size, &window_bits)) {
+    return 1;
   }
 
+  mspack_system* sys = mspack_memory_sys_create();
+  if (!sys) {
+    return 1;
+  }
+  int result_code = lzx_decompress(sys, lzx_data, lzx_len, dest, dest_len,
+                                   window_bits, window_data, window_data_len);
+  mspack_memory_sys_destroy(sys);
+  return result_code;
+}
+
+int lzx_decompress_stream(
+    const std::function<size_t(void* buffer, size_t length)>& read_input,
+    void* dest, size_t dest_len, uint32_t window_size) {
+  int result_code = 1;
+
+  uint32_t window_bits;
+  if (!xe::bit_scan_forward(window_size, &window_bits)) {
+    return result_code;
+  }
+
+  mspack_system* sys = mspack_memory_sys_create();
+  if (!sys) {
+    return result_code;
+  }
+  // lzxd only reads from the source and only writes to the destination.
+  sys->read = mspack_stream_read;
+  mspack_stream_file lzxsrc = {&read_input};
+  mspack_memory_file* lzxdst = mspack_memory_open(sys, dest, dest_len);
+  lzxd_stream* lzxd = lzxd_init(sys, (mspack_file*)&lzxsrc,
+                                (mspack_file*)lzxdst, window_bits, 0, 0x8000,
+                                (off_t)dest_len, 0);
+  if (lzxd) {
+    result_code = lzxd_decompress(lzxd, (off_t)dest_len);
+    lzxd_free(lzxd);
+  }
+
+  if (lzxdst) {
+    mspack_memory_close(lzxdst);
+  }
+  mspack_memory_sys_destroy(sys);
   return result_code;
 }
 
@@ -150,6 +211,17 @@ int lzxdelta_apply_patch(xe::xex2_delta_patch* patch, size_t patch_len,
   void* patch_end = (char*)patch + patch_len;
   auto* cur_patch = patch;
 
+  uint32_t window_bits;
+  if (!xe::bit_scan_forward(window_size, &window_bits)) {
+    return 1;
+  }
+  // Title updates are made of many small deltas, so they share one system.
+  std::unique_ptr<mspack_system, decltype(&mspack_memory_sys_destroy)> sys(
+      mspack_memory_sys_create(), mspack_memory_sys_destroy);
+  if (!sys) {
+    return 1;
+  }
+
   while (patch_end > cur_patch) {
     int patch_sz = -4;  // 0 byte patches need us to remove 4 byte from next
                         // patch addr because of patch_data field
@@ -170,10 +242,12 @@ int lzxdelta_apply_patch(xe::xex2_delta_patch* patch, size_t patch_len,
         patch_sz =
             cur_patch->compressed_len - 4;  // -4 because of patch_data field
 
+        // Decompressed straight into the image, the old data is copied into
+        // the window first so new and old ranges may overlap.
         int result = lzx_decompress(
-            cur_patch->patch_data, cur_patch->compressed_len,
+            sys.get(), cur_patch->patch_data, cur_patch->compressed_len,
             (char*)dest + cur_patch->new_addr, cur_patch->uncompressed_len,
-            window_size, (char*)dest + cur_patch->old_addr,
+            window_bits, (char*)dest + cur_patch->old_addr,
             cur_patch->uncompressed_len);
 
         if (result) {
@@ -10,6 +10,7 @@
 #ifndef XENIA_CPU_LZX_H_
 #define XENIA_CPU_LZX_H_
 
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -23,6 +24,13 @@ int lzx_decompress(const void* lzx_data, size_t lzx_len, void* dest,
                    size_t dest_len, uint32_t window_size, void* window_data,
                    size_t window_data_len);
 
+// Same as lzx_decompress, with the compressed data pulled through read_input
+// so that it can be decompressed while it's still being produced. read_input
+// must block until it can return at least one byte, and return 0 at the end.
+int lzx_decompress_stream(
+    const std::function<size_t(void* buffer, size_t length)>& read_input,
+    void* dest, size_t dest_len, uint32_t window_size);
+
 int lzxdelta_apply_patch(xe::xex2_delta_patch* patch, size_t patch_len,
                          uint32_t window_size, void* dest);
 
@@ -9,6 +9,7 @@ project("xenia-cpu")
   links({
     "xenia-base",
     "mspack",
+    "xxhash",
   })
   includedirs({
     project_root.."/third_party/llvm/include",
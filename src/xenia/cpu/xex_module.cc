@@ -10,13 +10,20 @@
 #include "xenia/cpu/xex_module.h"
 
 #include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 #include "third_party/fmt/include/fmt/format.h"
 
 #include "xenia/base/byte_order.h"
+#include "xenia/base/crypto.h"
+#include "xenia/base/filesystem.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/math.h"
 #include "xenia/base/memory.h"
+#include "xenia/base/threading.h"
 #include "xenia/cpu/cpu_flags.h"
 #include "xenia/cpu/export_resolver.h"
 #include "xenia/cpu/lzx.h"
@@ -24,10 +31,8 @@
 #include "xenia/kernel/kernel_state.h"
 #include "xenia/kernel/xmodule.h"
 
-#include "third_party/crypto/TinySHA1.hpp"
-#include "third_party/crypto/rijndael-alg-fst.c"
-#include "third_party/crypto/rijndael-alg-fst.h"
 #include "third_party/pe/pe_image.h"
+#include "third_party/xxhash/xxhash.h"
 
 static const uint8_t xe_xex2_retail_key[16] = {
     0x20, 0xB1, 0x85, 0xA5, 0x9D, 0x28, 0xFD, 0xC3,
@@ -39,21 +44,9 @@ static const uint8_t xe_xex2_devkit_key[16] = {
 void aes_decrypt_buffer(const uint8_t* session_key, const uint8_t* input_buffer,
                         const size_t input_size, uint8_t* output_buffer,
                         const size_t output_size) {
-  uint32_t rk[4 * (MAXNR + 1)];
-  uint8_t ivec[16] = {0};
-  int32_t Nr = rijndaelKeySetupDec(rk, session_key, 128);
-  const uint8_t* ct = input_buffer;
-  uint8_t* pt = output_buffer;
-  for (size_t n = 0; n < input_size; n += 16, ct += 16, pt += 16) {
-    // Decrypt 16 uint8_ts from input -> output.
-    rijndaelDecrypt(rk, Nr, ct, pt);
-    for (size_t i = 0; i < 16; i++) {
-      // XOR with previous.
-      pt[i] ^= ivec[i];
-      // Set previous.
-      ivec[i] = ct[i];
-    }
-  }
+  uint8_t ivec[xe::crypto::kAesBlockLength] = {0};
+  xe::crypto::Aes128CbcDecrypt(session_key, ivec, input_buffer, output_buffer,
+                               std::min(input_size, output_size));
 }
 
 namespace xe {
@@ -61,6 +54,78 @@ namespace cpu {
 
 using xe::kernel::KernelState;
 
+namespace {
+
+constexpr uint32_t kImageCacheMagic = 'XIMG';
+constexpr uint32_t kImageCacheVersion = 1;
+
+struct ImageCacheHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t image_size;
+  uint32_t reserved;
+  uint64_t image_hash;
+};
+
+bool IsImageCacheEnabled() { return !cvars::xex_image_cache_path.empty(); }
+
+std::filesystem::path GetImageCachePath(uint64_t key) {
+  return cvars::xex_image_cache_path / fmt::format("{:016X}.bin", key);
+}
+
+bool ReadCachedImage(const std::filesystem::path& path, uint8_t* image,
+                     uint32_t image_size) {
+  auto file = xe::filesystem::OpenFile(path, "rb");
+  if (!file) {
+    return false;
+  }
+  ImageCacheHeader header;
+  bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+               header.magic == kImageCacheMagic &&
+               header.version == kImageCacheVersion &&
+               header.image_size == image_size &&
+               fread(image, 1, image_size, file) == image_size &&
+               XXH64(image, image_size, 0) == header.image_hash;
+  fclose(file);
+  if (!valid) {
+    XELOGW("Ignoring invalid cached XEX image {}", xe::path_to_utf8(path));
+  }
+  return valid;
+}
+
+void WriteCachedImage(const std::filesystem::path& path, const uint8_t* image,
+                      uint32_t image_size) {
+  // Written under a temporary name so that an interrupted write is never
+  // picked up.
+  auto temp_path = path;
+  temp_path += ".tmp";
+  xe::filesystem::CreateParentFolder(temp_path);
+  auto file = xe::filesystem::OpenFile(temp_path, "wb");
+  if (!file) {
+    XELOGW("Failed to create cached XEX image {}", xe::path_to_utf8(path));
+    return;
+  }
+  ImageCacheHeader header;
+  header.magic = kImageCacheMagic;
+  header.version = kImageCacheVersion;
+  header.image_size = image_size;
+  header.reserved = 0;
+  header.image_hash = XXH64(image, image_size, 0);
+  bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                 fwrite(image, 1, image_size, file) == image_size;
+  fclose(file);
+  std::error_code error;
+  if (written) {
+    std::filesystem::rename(temp_path, path, error);
+  }
+  if (!written || error) {
+    std::filesystem::remove(temp_path, error);
+    XELOGW("Failed to write cached XEX image {}", xe::path_to_utf8(path));
+  }
+}
+
+}  // namespace
+
 XexModule::XexModule(Processor* processor, KernelState* kernel_state)
     : Module(processor), processor_(processor), kernel_state_(kernel_state) {}
 
@@ -211,9 +276,8 @@ int XexModule::ApplyPatch(XexModule* module) {
 
   // Compare hash inside delta descriptor to base XEX signature
   uint8_t digest[0x14];
-  sha1::SHA1 s;
-  s.processBytes(module->xex_security_info()->rsa_signature, 0x100);
-  s.finalize(digest);
+  xe::crypto::Sha1(module->xex_security_info()->rsa_signature, 0x100,
+                   digest);
 
   if (memcmp(digest, patch_header->digest_source, 0x14) != 0) {
     XELOGW(
@@ -249,6 +313,20 @@ int XexModule::ApplyPatch(XexModule* module) {
 
   // Patch base XEX header
   uint32_t original_image_size = module->image_size();
+  uint8_t* base_exe = memory()->TranslateVirtual(module->base_address_);
+
+  // The patched image only depends on the base XEX as loaded and on the whole
+  // patch, so hash both before the headers are modified.
+  std::filesystem::path cache_path;
+  if (IsImageCacheEnabled()) {
+    uint64_t key = XXH64(module->xex_header_mem_.data(),
+                         module->xex_header_mem_.size(),
+                         module->is_dev_kit_ ? 1 : 0);
+    key = XXH64(base_exe, original_image_size, key);
+    key = XXH64(xex_header_mem_.data(), xex_header_mem_.size(), key);
+    key = XXH64(xexp_data_mem_.data(), xexp_data_mem_.size(), key);
+    cache_path = GetImageCachePath(key);
+  }
   uint32_t header_target_size = patch_header->delta_headers_target_offset +
                                 patch_header->delta_headers_source_size;
 
@@ -349,23 +427,85 @@ int XexModule::ApplyPatch(XexModule* module) {
     return 7;
   }
 
-  // Decrypt (if needed).
-  bool free_input = false;
-  const uint8_t* patch_buffer = xexp_data_mem_.data();
-  const size_t patch_length = xexp_data_mem_.size();
+  // The cached image is only copied in once it's known to be intact, as the
+  // base image is still needed to patch it otherwise.
+  std::vector<uint8_t> cached_image;
+  if (!cache_path.empty()) {
+    cached_image.resize(new_image_size);
+    if (!ReadCachedImage(cache_path, cached_image.data(), new_image_size)) {
+      cached_image.clear();
+    }
+  }
+  if (!cached_image.empty()) {
+    std::memcpy(base_exe, cached_image.data(), new_image_size);
+    XELOGI("Loaded patched XEX image from {}", xe::path_to_utf8(cache_path));
+    result_code = 0;
+  } else {
+    result_code = PatchImage(patch_header, base_exe, original_image_size);
+    if (!result_code && !cache_path.empty()) {
+      WriteCachedImage(cache_path, base_exe, new_image_size);
+    }
+  }
+
+  if (!result_code) {
+    // Decommit unused pages if new image size is smaller than original
+    if (original_image_size > new_image_size) {
+      uint32_t size_delta = original_image_size - new_image_size;
+      uint32_t addr_free_mem = module->base_address_ + new_image_size;
+
+      bool free_result = memory()
+                             ->LookupHeap(addr_free_mem)
+                             ->Decommit(addr_free_mem, size_delta);
+
+      if (!free_result) {
+        XELOGE("Unable to decommit XEX memory at {:08X}-{:08X}.", addr_free_mem,
+               size_delta);
+        assert_always();
+      }
+    }
+
+    // byteswap versions because of bitfields...
+    xex2_version source_ver, target_ver;
+    source_ver.value =
+        xe::byte_swap<uint32_t>(patch_header->source_version.value);
+
+    target_ver.value =
+        xe::byte_swap<uint32_t>(patch_header->target_version.value);
+
+    XELOGI(
+        "XEX patch applied successfully: base version: {}.{}.{}.{}, new "
+        "version: {}.{}.{}.{}",
+        source_ver.major, source_ver.minor, source_ver.build, source_ver.qfe,
+        target_ver.major, target_ver.minor, target_ver.build, target_ver.qfe);
+  } else {
+    XELOGE("XEX patch application failed, error code {}", result_code);
+  }
+
+  return result_code;
+}
 
-  const uint8_t* input_buffer = patch_buffer;
+int XexModule::PatchImage(const xex2_opt_delta_patch_descriptor* patch_header,
+                          uint8_t* base_exe, uint32_t original_image_size) {
+  auto file_format_header = opt_file_format_info();
 
+  // Decrypt (if needed). The patch data is only kept around to be applied, so
+  // it's decrypted in place instead of into a copy.
   switch (file_format_header->encryption_type) {
     case XEX_ENCRYPTION_NONE:
       // No-op.
       break;
     case XEX_ENCRYPTION_NORMAL:
-      // TODO: a way to do without a copy/alloc?
-      free_input = true;
-      input_buffer = (const uint8_t*)calloc(1, patch_length);
-      aes_decrypt_buffer(session_key_, patch_buffer, patch_length,
-                         (uint8_t*)input_buffer, patch_length);
+      if (!xexp_data_decrypted_) {
+        aes_decrypt_buffer(session_key_, xexp_data_mem_.data(),
+                           xexp_data_mem_.size(), xexp_data_mem_.data(),
+                           xexp_data_mem_.size());
+        // Trailing bytes that don't fill a whole AES block aren't decrypted.
+        size_t tail_length =
+            xexp_data_mem_.size() % xe::crypto::kAesBlockLength;
+        std::memset(xexp_data_mem_.data() + xexp_data_mem_.size() - tail_length,
+                    0, tail_length);
+        xexp_data_decrypted_ = true;
+      }
       break;
     default:
       assert_always();
@@ -375,8 +515,7 @@ int XexModule::ApplyPatch(XexModule* module) {
   const xex2_compressed_block_info* cur_block =
       &file_format_header->compression_info.normal.first_block;
 
-  const uint8_t* p = input_buffer;
-  uint8_t* base_exe = memory()->TranslateVirtual(module->base_address_);
+  const uint8_t* p = xexp_data_mem_.data();
 
   // If image_source_offset is set, copy [source_offset:source_size] to
   // target_offset
@@ -397,18 +536,16 @@ int XexModule::ApplyPatch(XexModule* module) {
   }
 
   // Now loop through each block and apply the delta patches inside
+  uint8_t digest[0x14];
   while (cur_block->block_size) {
     const auto* next_block = (const xex2_compressed_block_info*)p;
 
     // Compare block hash, if no match we probably used wrong decrypt key
-    s.reset();
-    s.processBytes(p, cur_block->block_size);
-    s.finalize(digest);
+    xe::crypto::Sha1(p, cur_block->block_size, digest);
 
     if (memcmp(digest, cur_block->block_hash, 0x14) != 0) {
-      result_code = 9;
       XELOGE("XEX patch block hash doesn't match hash inside block info!");
-      break;
+      return 9;
     }
 
     // skip block info
@@ -418,55 +555,18 @@ int XexModule::ApplyPatch(XexModule* module) {
     uint32_t block_data_size = cur_block->block_size - 20 - 4;
 
     // Apply delta patch
-    result_code = lzxdelta_apply_patch(
+    int result_code = lzxdelta_apply_patch(
         (xex2_delta_patch*)p, block_data_size,
         file_format_header->compression_info.normal.window_size, base_exe);
     if (result_code) {
-      break;
+      return result_code;
     }
 
     p += block_data_size;
     cur_block = next_block;
   }
 
-  if (!result_code) {
-    // Decommit unused pages if new image size is smaller than original
-    if (original_image_size > new_image_size) {
-      uint32_t size_delta = original_image_size - new_image_size;
-      uint32_t addr_free_mem = module->base_address_ + new_image_size;
-
-      bool free_result = memory()
-                             ->LookupHeap(addr_free_mem)
-                             ->Decommit(addr_free_mem, size_delta);
-
-      if (!free_result) {
-        XELOGE("Unable to decommit XEX memory at {:08X}-{:08X}.", addr_free_mem,
-               size_delta);
-        assert_always();
-      }
-    }
-
-    // byteswap versions because of bitfields...
-    xex2_version source_ver, target_ver;
-    source_ver.value =
-        xe::byte_swap<uint32_t>(patch_header->source_version.value);
-
-    target_ver.value =
-        xe::byte_swap<uint32_t>(patch_header->target_version.value);
-
-    XELOGI(
-        "XEX patch applied successfully: base version: {}.{}.{}.{}, new "
-        "version: {}.{}.{}.{}",
-        source_ver.major, source_ver.minor, source_ver.build, source_ver.qfe,
-        target_ver.major, target_ver.minor, target_ver.build, target_ver.qfe);
-  } else {
-    XELOGE("XEX patch application failed, error code {}", result_code);
-  }
-
-  if (free_input) {
-    free((void*)input_buffer);
-  }
-  return result_code;
+  return 0;
 }
 
 int XexModule::ReadImage(const void* xex_addr, size_t xex_length,
@@ -612,9 +712,7 @@ int XexModule::ReadImageBasicCompressed(const void* xex_addr,
   std::memset(buffer, 0, total_size);  // Quickly zero the contents.
   uint8_t* d = buffer;
 
-  uint32_t rk[4 * (MAXNR + 1)];
-  uint8_t ivec[16] = {0};
-  int32_t Nr = rijndaelKeySetupDec(rk, session_key_, 128);
+  uint8_t ivec[xe::crypto::kAesBlockLength] = {0};
 
   for (size_t n = 0; n < block_count; n++) {
     const uint32_t data_size = comp_info.blocks[n].data_size;
@@ -628,20 +726,14 @@ int XexModule::ReadImageBasicCompressed(const void* xex_addr,
         }
         memcpy(d, p, data_size);
         break;
-      case XEX_ENCRYPTION_NORMAL: {
-        const uint8_t* ct = p;
-        uint8_t* pt = d;
-        for (size_t m = 0; m < data_size; m += 16, ct += 16, pt += 16) {
-          // Decrypt 16 uint8_ts from input -> output.
-          rijndaelDecrypt(rk, Nr, ct, pt);
-          for (size_t i = 0; i < 16; i++) {
-            // XOR with previous.
-            pt[i] ^= ivec[i];
-            // Set previous.
-            ivec[i] = ct[i];
-          }
+      case XEX_ENCRYPTION_NORMAL:
+        if (data_size > uncompressed_size - (d - buffer)) {
+          // Overflow.
+          return 1;
         }
-      } break;
+        // The IV carries over between blocks.
+        xe::crypto::Aes128CbcDecrypt(session_key_, ivec, p, d, data_size);
+        break;
       default:
         assert_always();
         return 1;
@@ -668,26 +760,13 @@ int XexModule::ReadImageCompressed(const void* xex_addr, size_t xex_length) {
   //    Nb block uint8_ts
   // - decompress block contents
 
-  uint8_t* compress_buffer = NULL;
-  const uint8_t* p = NULL;
-  uint8_t* d = NULL;
-  sha1::SHA1 s;
-
-  // Decrypt (if needed).
-  bool free_input = false;
-  const uint8_t* input_buffer = exe_buffer;
-  size_t input_size = exe_length;
-
+  bool encrypted;
   switch (opt_file_format_info()->encryption_type) {
     case XEX_ENCRYPTION_NONE:
-      // No-op.
+      encrypted = false;
       break;
     case XEX_ENCRYPTION_NORMAL:
-      // TODO: a way to do without a copy/alloc?
-      free_input = true;
-      input_buffer = (const uint8_t*)calloc(1, exe_length);
-      aes_decrypt_buffer(session_key_, exe_buffer, exe_length,
-                         (uint8_t*)input_buffer, exe_length);
+      encrypted = true;
       break;
     default:
       assert_always();
@@ -695,83 +774,200 @@ int XexModule::ReadImageCompressed(const void* xex_addr, size_t xex_length) {
   }
 
   const auto* compression_info = &opt_file_format_info()->compression_info;
-  const xex2_compressed_block_info* cur_block =
+  std::unique_ptr<uint8_t[]> decrypt_buffer;
+  if (encrypted) {
+    decrypt_buffer = std::make_unique<uint8_t[]>(exe_length);
+  }
+  const uint8_t* input_buffer = encrypted ? decrypt_buffer.get() : exe_buffer;
+
+  // CBC carries over between blocks, so the IV and how far the input has been
+  // decrypted are shared by the first block check and the worker.
+  uint8_t iv[xe::crypto::kAesBlockLength] = {0};
+  size_t decrypted_length = 0;
+  // Decrypts the input up to at least end, rounded to whole AES blocks.
+  // Returns false if the input ends before that.
+  auto decrypt_to = [&](size_t end) -> bool {
+    if (!encrypted || decrypted_length >= end) {
+      return true;
+    }
+    size_t decrypt_end =
+        std::min(xe::round_up(end, xe::crypto::kAesBlockLength),
+                 size_t(exe_length) & ~(xe::crypto::kAesBlockLength - 1));
+    if (decrypt_end < end) {
+      return false;
+    }
+    xe::crypto::Aes128CbcDecrypt(session_key_, iv,
+                                 exe_buffer + decrypted_length,
+                                 decrypt_buffer.get() + decrypted_length,
+                                 decrypt_end - decrypted_length);
+    decrypted_length = decrypt_end;
+    return true;
+  };
+
+  // Check the hash of the first block before touching guest memory, so that
+  // a wrong key is rejected without allocating and clearing the whole image
+  // (ReadImage then retries with the other key).
+  const xex2_compressed_block_info* first_block =
       &compression_info->normal.first_block;
+  uint8_t block_calced_digest[0x14];
+  if (first_block->block_size) {
+    const size_t block_size = first_block->block_size;
+    if (block_size < sizeof(xex2_compressed_block_info) ||
+        block_size > exe_length || !decrypt_to(block_size)) {
+      return 2;
+    }
+    xe::crypto::Sha1(input_buffer, block_size, block_calced_digest);
+    if (memcmp(block_calced_digest, first_block->block_hash, 0x14) != 0) {
+      return 2;
+    }
+  }
 
-  compress_buffer = (uint8_t*)calloc(1, exe_length);
+  // Allocated up front so that decompression can start as soon as the first
+  // block is ready. ReadImage resets the heap if this fails and it retries
+  // with the other key.
+  uint32_t uncompressed_size = image_size();
+  bool alloc_result =
+      memory()
+          ->LookupHeap(base_address_)
+          ->AllocFixed(
+              base_address_, uncompressed_size, 4096,
+              xe::kMemoryAllocationReserve | xe::kMemoryAllocationCommit,
+              xe::kMemoryProtectRead | xe::kMemoryProtectWrite);
+  if (!alloc_result) {
+    XELOGE("Unable to allocate XEX memory at {:08X}-{:08X}.", base_address_,
+           uncompressed_size);
+    return 3;
+  }
+  uint8_t* buffer = memory()->TranslateVirtual(base_address_);
 
-  p = input_buffer;
-  d = compress_buffer;
+  // Keyed by the whole XEX file, as the same image can be encrypted or
+  // compressed differently, and by the key that decrypted it.
+  std::filesystem::path cache_path;
+  if (IsImageCacheEnabled()) {
+    cache_path =
+        GetImageCachePath(XXH64(xex_addr, xex_length, is_dev_kit_ ? 1 : 0));
+  }
+  if (!cache_path.empty() &&
+      ReadCachedImage(cache_path, buffer, uncompressed_size)) {
+    XELOGI("Loaded decompressed XEX image from {}",
+           xe::path_to_utf8(cache_path));
+    return 0;
+  }
+  std::memset(buffer, 0, uncompressed_size);
 
-  // De-block.
-  int result_code = 0;
+  auto compress_buffer = std::make_unique<uint8_t[]>(exe_length);
+
+  // Decryption, hash checks and de-blocking run on a worker thread, and this
+  // thread decompresses each block as soon as it has been published. Both
+  // stages share compress_buffer: the worker only appends past
+  // deblocked_length, which is all the decompressor reads up to.
+  std::mutex deblock_mutex;
+  std::condition_variable deblock_cond;
+  size_t deblocked_length = 0;
+  bool deblock_done = false;
+  int deblock_result = 0;
+
+  auto deblock = [&]() {
+    size_t offset = 0;
+    uint8_t* d = compress_buffer.get();
+    const xex2_compressed_block_info* cur_block = first_block;
+    while (cur_block->block_size) {
+      const size_t block_size = cur_block->block_size;
+      if (block_size < sizeof(xex2_compressed_block_info) ||
+          block_size > exe_length - offset) {
+        deblock_result = 2;
+        break;
+      }
+      if (!decrypt_to(offset + block_size)) {
+        deblock_result = 2;
+        break;
+      }
 
-  uint8_t block_calced_digest[0x14];
-  while (cur_block->block_size) {
-    const uint8_t* pnext = p + cur_block->block_size;
-    const auto* next_block = (const xex2_compressed_block_info*)p;
+      const uint8_t* p = input_buffer + offset;
+      const uint8_t* pnext = p + block_size;
+      const auto* next_block = (const xex2_compressed_block_info*)p;
+
+      // Compare block hash, if no match we probably used wrong decrypt key. The
+      // first block has already been checked.
+      if (offset) {
+        xe::crypto::Sha1(p, block_size, block_calced_digest);
+        if (memcmp(block_calced_digest, cur_block->block_hash, 0x14) != 0) {
+          deblock_result = 2;
+          break;
+        }
+      }
 
-    // Compare block hash, if no match we probably used wrong decrypt key
-    s.reset();
-    s.processBytes(p, cur_block->block_size);
-    s.finalize(block_calced_digest);
-    if (memcmp(block_calced_digest, cur_block->block_hash, 0x14) != 0) {
-      result_code = 2;
-      break;
-    }
+      // skip block info
+      p += 4;
+      p += 20;
 
-    // skip block info
-    p += 4;
-    p += 20;
+      while (pnext - p >= 2) {
+        const size_t chunk_size = (p[0] << 8) | p[1];
+        p += 2;
+        if (!chunk_size) {
+          break;
+        }
+        if (chunk_size > size_t(pnext - p)) {
+          deblock_result = 2;
+          break;
+        }
 
-    while (true) {
-      const size_t chunk_size = (p[0] << 8) | p[1];
-      p += 2;
-      if (!chunk_size) {
+        memcpy(d, p, chunk_size);
+        p += chunk_size;
+        d += chunk_size;
+      }
+      if (deblock_result) {
         break;
       }
 
-      memcpy(d, p, chunk_size);
-      p += chunk_size;
-      d += chunk_size;
-    }
-
-    p = pnext;
-    cur_block = next_block;
-  }
+      {
+        std::lock_guard<std::mutex> lock(deblock_mutex);
+        deblocked_length = d - compress_buffer.get();
+      }
+      deblock_cond.notify_one();
 
-  if (!result_code) {
-    uint32_t uncompressed_size = image_size();
+      offset += block_size;
+      cur_block = next_block;
+    }
+    {
+      std::lock_guard<std::mutex> lock(deblock_mutex);
+      deblock_done = true;
+    }
+    deblock_cond.notify_one();
+  };
 
-    // Allocate in-place the XEX memory.
-    bool alloc_result =
-        memory()
-            ->LookupHeap(base_address_)
-            ->AllocFixed(
-                base_address_, uncompressed_size, 4096,
-                xe::kMemoryAllocationReserve | xe::kMemoryAllocationCommit,
-                xe::kMemoryProtectRead | xe::kMemoryProtectWrite);
+  size_t read_offset = 0;
+  auto read_input = [&](void* dest, size_t length) -> size_t {
+    size_t ready_length;
+    {
+      std::unique_lock<std::mutex> lock(deblock_mutex);
+      deblock_cond.wait(lock, [&]() {
+        return deblocked_length > read_offset || deblock_done;
+      });
+      ready_length = deblocked_length;
+    }
+    size_t count = std::min(length, ready_length - read_offset);
+    std::memcpy(dest, compress_buffer.get() + read_offset, count);
+    read_offset += count;
+    return count;
+  };
 
-    if (alloc_result) {
-      uint8_t* buffer = memory()->TranslateVirtual(base_address_);
-      std::memset(buffer, 0, uncompressed_size);
+  // Joined before returning, as the worker uses the locals above.
+  std::thread deblock_thread([&deblock]() {
+    xe::threading::set_name("XEX Deblock");
+    deblock();
+  });
 
-      // Decompress into XEX base
-      result_code = lzx_decompress(
-          compress_buffer, d - compress_buffer, buffer, uncompressed_size,
-          compression_info->normal.window_size, nullptr, 0);
-    } else {
-      XELOGE("Unable to allocate XEX memory at {:08X}-{:08X}.", base_address_,
-             uncompressed_size);
-      result_code = 3;
-    }
+  // Decompress into XEX base
+  int result_code = lzx_decompress_stream(read_input, buffer, uncompressed_size,
+                                          compression_info->normal.window_size);
+  deblock_thread.join();
+  if (deblock_result) {
+    return deblock_result;
   }
 
-  if (compress_buffer) {
-    free((void*)compress_buffer);
-  }
-  if (free_input) {
-    free((void*)input_buffer);
+  if (!result_code && !cache_path.empty()) {
+    WriteCachedImage(cache_path, buffer, uncompressed_size);
   }
   return result_code;
 }
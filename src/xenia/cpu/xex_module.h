@@ -174,6 +174,8 @@ class XexModule : public xe::cpu::Module {
   int ReadImageUncompressed(const void* xex_addr, size_t xex_length);
   int ReadImageBasicCompressed(const void* xex_addr, size_t xex_length);
   int ReadImageCompressed(const void* xex_addr, size_t xex_length);
+  int PatchImage(const xex2_opt_delta_patch_descriptor* patch_header,
+                 uint8_t* base_exe, uint32_t original_image_size);
 
   int ReadPEHeaders();
 
@@ -187,6 +189,7 @@ class XexModule : public xe::cpu::Module {
   std::string path_;
   std::vector<uint8_t> xex_header_mem_;  // Holds the xex header
   std::vector<uint8_t> xexp_data_mem_;   // Holds XEXP patch data
+  bool xexp_data_decrypted_ = false;     // Patch data decrypted in place?
 
   std::vector<ImportLibrary>
       import_libs_;  // pre-loaded import libraries for ease of use
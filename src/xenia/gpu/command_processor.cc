@@ -17,6 +17,7 @@
 #include "xenia/base/byte_stream.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/math.h"
+#include "xenia/base/memory.h"
 #include "xenia/base/profiling.h"
 #include "xenia/base/ring_buffer.h"
 #include "xenia/gpu/gpu_flags.h"
@@ -142,7 +143,10 @@ void CommandProcessor::CallInThread(std::function<void()> fn) {
 void CommandProcessor::ClearCaches() {}
 
 void CommandProcessor::WorkerThreadMain() {
-  context_->MakeCurrent();
+  // Headless backends may run without a graphics context.
+  if (context_) {
+    context_->MakeCurrent();
+  }
   if (!SetupContext()) {
     xe::FatalError("Unable to setup command processor internal state");
     return;
@@ -312,6 +316,57 @@ void CommandProcessor::WriteRegister(uint32_t index, uint32_t value) {
   }
 }
 
+void CommandProcessor::SavePlaybackCheckpoint(
+    PlaybackCheckpointState* state) const {
+  state->bin_select = bin_select_;
+  state->bin_mask = bin_mask_;
+  state->active_vertex_shader = active_vertex_shader_;
+  state->active_pixel_shader = active_pixel_shader_;
+  state->gamma_ramp = gamma_ramp_;
+  state->gamma_ramp_rw_subindex = gamma_ramp_rw_subindex_;
+}
+
+void CommandProcessor::RestorePlaybackCheckpoint(
+    const PlaybackCheckpointState& state) {
+  bin_select_ = state.bin_select;
+  bin_mask_ = state.bin_mask;
+  active_vertex_shader_ = state.active_vertex_shader;
+  active_pixel_shader_ = state.active_pixel_shader;
+  gamma_ramp_ = state.gamma_ramp;
+  gamma_ramp_rw_subindex_ = state.gamma_ramp_rw_subindex;
+  dirty_gamma_ramp_normal_ = true;
+  dirty_gamma_ramp_pwl_ = true;
+  OnShaderConstantsWritten(XE_GPU_REG_SHADER_CONSTANT_000_X,
+                           XE_GPU_REG_SHADER_CONSTANT_LOOP_31 -
+                               XE_GPU_REG_SHADER_CONSTANT_000_X + 1);
+}
+
+void CommandProcessor::WriteRegistersFromMem(uint32_t start_index,
+                                             const uint32_t* source,
+                                             uint32_t count) {
+  if (register_file_->WriteShaderConstantsFromMem(start_index, source, count)) {
+    OnShaderConstantsWritten(start_index, count);
+    return;
+  }
+  // Registers with side effects, or out of bounds - write one by one.
+  for (uint32_t i = 0; i < count; ++i) {
+    WriteRegister(start_index + i, xe::load_and_swap<uint32_t>(source + i));
+  }
+}
+
+void CommandProcessor::WriteRegistersFromRing(RingBuffer* reader,
+                                              uint32_t start_index,
+                                              uint32_t count) {
+  if (register_file_->WriteShaderConstantsFromRing(reader, start_index,
+                                                   count)) {
+    OnShaderConstantsWritten(start_index, count);
+    return;
+  }
+  for (uint32_t i = 0; i < count; ++i) {
+    WriteRegister(start_index + i, reader->ReadAndSwap<uint32_t>());
+  }
+}
+
 void CommandProcessor::UpdateGammaRampValue(GammaRampType type,
                                             uint32_t value) {
   RegisterFile* regs = register_file_;
@@ -551,10 +606,12 @@ bool CommandProcessor::ExecutePacketType0(RingBuffer* reader, uint32_t packet) {
 
   uint32_t base_index = (packet & 0x7FFF);
   uint32_t write_one_reg = (packet >> 15) & 0x1;
-  for (uint32_t m = 0; m < count; m++) {
-    uint32_t reg_data = reader->ReadAndSwap<uint32_t>();
-    uint32_t target_index = write_one_reg ? base_index : base_index + m;
-    WriteRegister(target_index, reg_data);
+  if (write_one_reg) {
+    for (uint32_t m = 0; m < count; m++) {
+      WriteRegister(base_index, reader->ReadAndSwap<uint32_t>());
+    }
+  } else {
+    WriteRegistersFromRing(reader, base_index, count);
   }
 
   trace_writer_.WritePacketEnd();
@@ -1288,10 +1345,7 @@ bool CommandProcessor::ExecutePacketType3_SET_CONSTANT(RingBuffer* reader,
       reader->AdvanceRead((count - 1) * sizeof(uint32_t));
       return true;
   }
-  for (uint32_t n = 0; n < count - 1; n++, index++) {
-    uint32_t data = reader->ReadAndSwap<uint32_t>();
-    WriteRegister(index, data);
-  }
+  WriteRegistersFromRing(reader, index, count - 1);
   return true;
 }
 
@@ -1300,10 +1354,7 @@ bool CommandProcessor::ExecutePacketType3_SET_CONSTANT2(RingBuffer* reader,
                                                         uint32_t count) {
   uint32_t offset_type = reader->ReadAndSwap<uint32_t>();
   uint32_t index = offset_type & 0xFFFF;
-  for (uint32_t n = 0; n < count - 1; n++, index++) {
-    uint32_t data = reader->ReadAndSwap<uint32_t>();
-    WriteRegister(index, data);
-  }
+  WriteRegistersFromRing(reader, index, count - 1);
   return true;
 }
 
@@ -1339,11 +1390,8 @@ bool CommandProcessor::ExecutePacketType3_LOAD_ALU_CONSTANT(RingBuffer* reader,
       return true;
   }
   trace_writer_.WriteMemoryRead(CpuToGpu(address), size_dwords * 4);
-  for (uint32_t n = 0; n < size_dwords; n++, index++) {
-    uint32_t data = xe::load_and_swap<uint32_t>(
-        memory_->TranslatePhysical(address + n * 4));
-    WriteRegister(index, data);
-  }
+  WriteRegistersFromMem(
+      index, memory_->TranslatePhysical<const uint32_t*>(address), size_dwords);
   return true;
 }
 
@@ -1351,10 +1399,7 @@ bool CommandProcessor::ExecutePacketType3_SET_SHADER_CONSTANTS(
     RingBuffer* reader, uint32_t packet, uint32_t count) {
   uint32_t offset_type = reader->ReadAndSwap<uint32_t>();
   uint32_t index = offset_type & 0xFFFF;
-  for (uint32_t n = 0; n < count - 1; n++, index++) {
-    uint32_t data = reader->ReadAndSwap<uint32_t>();
-    WriteRegister(index, data);
-  }
+  WriteRegistersFromRing(reader, index, count - 1);
   return true;
 }
 
@@ -144,6 +144,25 @@ class CommandProcessor {
   virtual void TracePlaybackWroteMemory(uint32_t base_ptr, uint32_t length) = 0;
 
   virtual void RestoreEDRAMSnapshot(const void* snapshot) = 0;
+  // Copies the current EDRAM contents (in the same layout as trace EDRAM
+  // snapshots) to snapshot. Returns false if the backend can't do this, in
+  // which case RestoreEDRAMSnapshot is a no-op too.
+  virtual bool CaptureEDRAMSnapshot(void* snapshot) { return false; }
+
+  // Command processor state not stored in the register file, saved and
+  // restored together with it by trace playback checkpoints.
+  struct PlaybackCheckpointState {
+    uint64_t bin_select;
+    uint64_t bin_mask;
+    Shader* active_vertex_shader;
+    Shader* active_pixel_shader;
+    GammaRamp gamma_ramp;
+    int gamma_ramp_rw_subindex;
+  };
+  void SavePlaybackCheckpoint(PlaybackCheckpointState* state) const;
+  // Restores the state and marks everything derived from the shader constants
+  // as dirty, as the register file may have been overwritten directly.
+  void RestorePlaybackCheckpoint(const PlaybackCheckpointState& state);
 
   void InitializeRingBuffer(uint32_t ptr, uint32_t page_count);
   void EnableReadPointerWriteBack(uint32_t ptr, uint32_t block_size);
@@ -173,6 +192,18 @@ class CommandProcessor {
   virtual void ShutdownContext() = 0;
 
   virtual void WriteRegister(uint32_t index, uint32_t value);
+  // Writes count big-endian register values. Ranges within the shader
+  // constants (which make up most register packets) are swapped and stored in
+  // one go and reported once via OnShaderConstantsWritten instead of going
+  // through WriteRegister for every dword.
+  void WriteRegistersFromMem(uint32_t start_index, const uint32_t* source,
+                             uint32_t count);
+  // Same as WriteRegistersFromMem, for values read from the ring buffer.
+  void WriteRegistersFromRing(RingBuffer* reader, uint32_t start_index,
+                              uint32_t count);
+  // Called after a range of shader constant registers (float, fetch, bool or
+  // loop) has been written without WriteRegister.
+  virtual void OnShaderConstantsWritten(uint32_t start_index, uint32_t count) {}
 
   void UpdateGammaRampValue(GammaRampType type, uint32_t value);
 
@@ -105,6 +105,18 @@ void D3D12CommandProcessor::RestoreEDRAMSnapshot(const void* snapshot) {
   render_target_cache_->RestoreEDRAMSnapshot(snapshot);
 }
 
+bool D3D12CommandProcessor::CaptureEDRAMSnapshot(void* snapshot) {
+  BeginSubmission(false);
+  if (!render_target_cache_->InitializeTraceSubmitDownloads()) {
+    return false;
+  }
+  if (!EndSubmission(false)) {
+    return false;
+  }
+  AwaitAllSubmissionsCompletion();
+  return render_target_cache_->CompleteEDRAMSnapshotDownload(snapshot);
+}
+
 uint32_t D3D12CommandProcessor::GetCurrentColorMask(
     const D3D12Shader* pixel_shader) const {
   if (pixel_shader == nullptr) {
@@ -1577,6 +1589,76 @@ void D3D12CommandProcessor::WriteRegister(uint32_t index, uint32_t value) {
   }
 }
 
+void D3D12CommandProcessor::OnShaderConstantsWritten(uint32_t start_index,
+                                                     uint32_t count) {
+  uint32_t last_index = start_index + count - 1;
+
+  if (frame_open_ && start_index <= XE_GPU_REG_SHADER_CONSTANT_511_W &&
+      last_index >= XE_GPU_REG_SHADER_CONSTANT_000_X) {
+    uint32_t first_constant =
+        (std::max(start_index, uint32_t(XE_GPU_REG_SHADER_CONSTANT_000_X)) -
+         XE_GPU_REG_SHADER_CONSTANT_000_X) >>
+        2;
+    uint32_t last_constant =
+        (std::min(last_index, uint32_t(XE_GPU_REG_SHADER_CONSTANT_511_W)) -
+         XE_GPU_REG_SHADER_CONSTANT_000_X) >>
+        2;
+    // Checks whether any constant in [first, last] is used by the shader.
+    auto constants_used = [](const uint64_t* map, uint32_t first,
+                             uint32_t last) {
+      for (uint32_t i = first >> 6; i <= last >> 6; ++i) {
+        uint64_t mask = ~uint64_t(0);
+        if (i == first >> 6) {
+          mask &= ~uint64_t(0) << (first & 63);
+        }
+        if (i == last >> 6) {
+          mask &= ~uint64_t(0) >> (63 - (last & 63));
+        }
+        if (map[i] & mask) {
+          return true;
+        }
+      }
+      return false;
+    };
+    if (first_constant < 256 &&
+        constants_used(current_float_constant_map_vertex_, first_constant,
+                       std::min(last_constant, uint32_t(255)))) {
+      cbuffer_binding_float_vertex_.up_to_date = false;
+    }
+    if (last_constant >= 256 &&
+        constants_used(current_float_constant_map_pixel_,
+                       std::max(first_constant, uint32_t(256)) - 256,
+                       last_constant - 256)) {
+      cbuffer_binding_float_pixel_.up_to_date = false;
+    }
+  }
+
+  if (start_index <= XE_GPU_REG_SHADER_CONSTANT_FETCH_31_5 &&
+      last_index >= XE_GPU_REG_SHADER_CONSTANT_FETCH_00_0) {
+    cbuffer_binding_fetch_.up_to_date = false;
+    if (texture_cache_ != nullptr) {
+      uint32_t first_fetch =
+          (std::max(start_index,
+                    uint32_t(XE_GPU_REG_SHADER_CONSTANT_FETCH_00_0)) -
+           XE_GPU_REG_SHADER_CONSTANT_FETCH_00_0) /
+          6;
+      uint32_t last_fetch =
+          (std::min(last_index,
+                    uint32_t(XE_GPU_REG_SHADER_CONSTANT_FETCH_31_5)) -
+           XE_GPU_REG_SHADER_CONSTANT_FETCH_00_0) /
+          6;
+      for (uint32_t i = first_fetch; i <= last_fetch; ++i) {
+        texture_cache_->TextureFetchConstantWritten(i);
+      }
+    }
+  }
+
+  if (start_index <= XE_GPU_REG_SHADER_CONSTANT_LOOP_31 &&
+      last_index >= XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031) {
+    cbuffer_binding_bool_loop_.up_to_date = false;
+  }
+}
+
 void D3D12CommandProcessor::PerformSwap(uint32_t frontbuffer_ptr,
                                         uint32_t frontbuffer_width,
                                         uint32_t frontbuffer_height) {
@@ -52,6 +52,7 @@ class D3D12CommandProcessor : public CommandProcessor {
   void TracePlaybackWroteMemory(uint32_t base_ptr, uint32_t length) override;
 
   void RestoreEDRAMSnapshot(const void* snapshot) override;
+  bool CaptureEDRAMSnapshot(void* snapshot) override;
 
   // Needed by everything that owns transient objects.
   ui::d3d12::D3D12Context* GetD3D12Context() const {
@@ -200,6 +201,7 @@ class D3D12CommandProcessor : public CommandProcessor {
   void ShutdownContext() override;
 
   void WriteRegister(uint32_t index, uint32_t value) override;
+  void OnShaderConstantsWritten(uint32_t start_index, uint32_t count) override;
 
   void PerformSwap(uint32_t frontbuffer_ptr, uint32_t frontbuffer_width,
                    uint32_t frontbuffer_height) override;
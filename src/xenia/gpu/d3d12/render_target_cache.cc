@@ -2310,6 +2310,27 @@ void RenderTargetCache::InitializeTraceCompleteDownloads() {
   edram_snapshot_download_buffer_ = nullptr;
 }
 
+bool RenderTargetCache::CompleteEDRAMSnapshotDownload(void* snapshot) {
+  if (!edram_snapshot_download_buffer_) {
+    return false;
+  }
+  const uint32_t kEDRAMSize = 2048 * 5120;
+  bool copied = false;
+  void* download_mapping;
+  if (SUCCEEDED(edram_snapshot_download_buffer_->Map(0, nullptr,
+                                                     &download_mapping))) {
+    std::memcpy(snapshot, download_mapping, kEDRAMSize);
+    D3D12_RANGE download_write_range = {};
+    edram_snapshot_download_buffer_->Unmap(0, &download_write_range);
+    copied = true;
+  } else {
+    XELOGE("Failed to map the EDRAM snapshot download buffer");
+  }
+  edram_snapshot_download_buffer_->Release();
+  edram_snapshot_download_buffer_ = nullptr;
+  return copied;
+}
+
 void RenderTargetCache::RestoreEDRAMSnapshot(const void* snapshot) {
   if (resolution_scale_2x_) {
     // No 1:1 mapping.
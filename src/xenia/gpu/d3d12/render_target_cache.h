@@ -312,6 +312,9 @@ class RenderTargetCache {
   // Returns true if any downloads were submitted to the command processor.
   bool InitializeTraceSubmitDownloads();
   void InitializeTraceCompleteDownloads();
+  // Copies the EDRAM contents downloaded by InitializeTraceSubmitDownloads to
+  // snapshot instead of writing them to the trace.
+  bool CompleteEDRAMSnapshotDownload(void* snapshot);
   void RestoreEDRAMSnapshot(const void* snapshot);
 
  private:
@@ -12,6 +12,10 @@
 DEFINE_path(trace_gpu_prefix, "scratch/gpu/",
             "Prefix path for GPU trace files.", "GPU");
 DEFINE_bool(trace_gpu_stream, false, "Trace all GPU packets.", "GPU");
+DEFINE_bool(trace_gpu_deduplicate_memory, true,
+            "Store memory read by the GPU only once per trace file when the "
+            "same contents are read again, at any address.",
+            "GPU");
 
 DEFINE_path(
     dump_shaders, "",
@@ -34,3 +38,10 @@ DEFINE_int32(query_occlusion_fake_sample_count, 1000,
              "EVENT_WRITE_ZPD by this number. Setting this to 0 means "
              "everything is reported as occluded.",
              "GPU");
+
+DEFINE_int32(trace_playback_checkpoint_interval, 64,
+             "Number of draws between the checkpoints trace playback records "
+             "so that seeking backwards within a frame only replays the draws "
+             "after the nearest checkpoint. 0 to always replay from the start "
+             "of the frame.",
+             "GPU");
@@ -13,6 +13,7 @@
 
 DECLARE_path(trace_gpu_prefix);
 DECLARE_bool(trace_gpu_stream);
+DECLARE_bool(trace_gpu_deduplicate_memory);
 
 DECLARE_path(dump_shaders);
 
@@ -22,4 +23,6 @@ DECLARE_bool(gpu_allow_invalid_fetch_constants);
 
 DECLARE_int32(query_occlusion_fake_sample_count);
 
+DECLARE_int32(trace_playback_checkpoint_interval);
+
 #endif  // XENIA_GPU_GPU_FLAGS_H_
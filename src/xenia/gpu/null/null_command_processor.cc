@@ -31,6 +31,16 @@ void NullCommandProcessor::ShutdownContext() {
   return CommandProcessor::ShutdownContext();
 }
 
+void NullCommandProcessor::WriteRegister(uint32_t index, uint32_t value) {
+  CommandProcessor::WriteRegister(index, value);
+  ++stats_.register_write_count;
+}
+
+void NullCommandProcessor::OnShaderConstantsWritten(uint32_t start_index,
+                                                    uint32_t count) {
+  stats_.register_write_count += count;
+}
+
 void NullCommandProcessor::PerformSwap(uint32_t frontbuffer_ptr,
                                        uint32_t frontbuffer_width,
                                        uint32_t frontbuffer_height) {}
@@ -46,10 +56,14 @@ bool NullCommandProcessor::IssueDraw(xenos::PrimitiveType prim_type,
                                      uint32_t index_count,
                                      IndexBufferInfo* index_buffer_info,
                                      bool major_mode_explicit) {
+  ++stats_.draw_count;
   return true;
 }
 
-bool NullCommandProcessor::IssueCopy() { return true; }
+bool NullCommandProcessor::IssueCopy() {
+  ++stats_.copy_count;
+  return true;
+}
 
 void NullCommandProcessor::InitializeTrace() {}
 
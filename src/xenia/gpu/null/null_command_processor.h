@@ -29,10 +29,23 @@ class NullCommandProcessor : public CommandProcessor {
 
   void RestoreEDRAMSnapshot(const void* snapshot) override;
 
+  // Work done by the command processor front end, for benchmarking. Only
+  // accessed on the command processor thread or while it's idle.
+  struct Stats {
+    uint64_t register_write_count = 0;
+    uint64_t draw_count = 0;
+    uint64_t copy_count = 0;
+  };
+  const Stats& stats() const { return stats_; }
+  void ResetStats() { stats_ = Stats(); }
+
  private:
   bool SetupContext() override;
   void ShutdownContext() override;
 
+  void WriteRegister(uint32_t index, uint32_t value) override;
+  void OnShaderConstantsWritten(uint32_t start_index, uint32_t count) override;
+
   void PerformSwap(uint32_t frontbuffer_ptr, uint32_t frontbuffer_width,
                    uint32_t frontbuffer_height) override;
 
@@ -47,6 +60,8 @@ class NullCommandProcessor : public CommandProcessor {
 
   void InitializeTrace() override;
   void FinalizeTrace() override;
+
+  Stats stats_;
 };
 
 }  // namespace null
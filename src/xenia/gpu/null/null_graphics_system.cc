@@ -26,7 +26,11 @@ X_STATUS NullGraphicsSystem::Setup(cpu::Processor* processor,
                                    ui::Window* target_window) {
   // This is a null graphics system, but we still setup vulkan because UI needs
   // it through us :|
-  provider_ = xe::ui::vulkan::VulkanProvider::Create(target_window);
+  // Headless (no window) users, such as the trace benchmark, don't need it, so
+  // they can run on hosts without a GPU.
+  if (target_window) {
+    provider_ = xe::ui::vulkan::VulkanProvider::Create(target_window);
+  }
 
   return GraphicsSystem::Setup(processor, kernel_state, target_window);
 }
@@ -0,0 +1,211 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "third_party/fmt/include/fmt/format.h"
+#include "xenia/base/clock.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/main.h"
+#include "xenia/emulator.h"
+#include "xenia/gpu/graphics_system.h"
+#include "xenia/gpu/null/null_command_processor.h"
+#include "xenia/gpu/null/null_graphics_system.h"
+#include "xenia/gpu/trace_player.h"
+
+DEFINE_transient_path(trace_file, "", "Trace file to replay.", "General");
+DEFINE_int32(bench_iterations, 5, "Number of timed replays of the trace.",
+             "General");
+DEFINE_int32(bench_warmup_iterations, 1,
+             "Number of untimed replays before the timed ones.", "General");
+DEFINE_int32(bench_seek_count, 0,
+             "Number of random command seeks to time within the frame with the "
+             "most commands after the replays.",
+             "General");
+
+namespace xe {
+namespace gpu {
+namespace null {
+
+// Replays a trace through the command processor front end with no host GPU
+// work, so that packet processing can be measured on any machine.
+class NullTraceBench {
+ public:
+  int Main(const std::vector<std::string>& args);
+
+ private:
+  struct RunResult {
+    double seconds;
+    TracePlayer::PlaybackStats playback_stats;
+    NullCommandProcessor::Stats command_processor_stats;
+  };
+
+  bool Setup();
+  RunResult Run();
+  void BenchmarkSeeks(int32_t seek_count);
+
+  std::unique_ptr<Emulator> emulator_;
+  NullCommandProcessor* command_processor_ = nullptr;
+  std::unique_ptr<TracePlayer> player_;
+};
+
+int NullTraceBench::Main(const std::vector<std::string>& args) {
+  if (cvars::trace_file.empty()) {
+    XELOGE("Usage: {} [--bench_iterations=N] trace_file",
+           xe::path_to_utf8(args[0]));
+    return 1;
+  }
+
+  if (!Setup()) {
+    XELOGE("Unable to setup the null graphics system");
+    return 1;
+  }
+  if (!player_->Open(std::filesystem::absolute(cvars::trace_file))) {
+    XELOGE("Unable to load trace file {}",
+           xe::path_to_utf8(cvars::trace_file));
+    return 1;
+  }
+  if (!player_->frame_count()) {
+    XELOGE("Trace file {} has no frames", xe::path_to_utf8(cvars::trace_file));
+    return 1;
+  }
+
+  for (int32_t i = 0; i < cvars::bench_warmup_iterations; ++i) {
+    Run();
+  }
+
+  fmt::print("{:>4} {:>10} {:>14} {:>14} {:>12} {:>12} {:>12}\n", "run", "ms",
+             "packets/s", "reg writes/s", "draws/s", "mem cmds/s", "mem MB/s");
+  std::vector<double> packet_rates;
+  for (int32_t i = 0; i < cvars::bench_iterations; ++i) {
+    RunResult result = Run();
+    double packet_rate = result.playback_stats.packet_count / result.seconds;
+    packet_rates.push_back(packet_rate);
+    fmt::print(
+        "{:>4} {:>10.3f} {:>14.0f} {:>14.0f} {:>12.0f} {:>12.0f} {:>12.2f}\n",
+        i, result.seconds * 1000.0, packet_rate,
+        result.command_processor_stats.register_write_count / result.seconds,
+        result.command_processor_stats.draw_count / result.seconds,
+        result.playback_stats.memory_read_count / result.seconds,
+        result.playback_stats.memory_read_bytes / result.seconds /
+            (1024.0 * 1024.0));
+  }
+  if (!packet_rates.empty()) {
+    std::sort(packet_rates.begin(), packet_rates.end());
+    fmt::print("packets/s: min {:.0f}, median {:.0f}, max {:.0f}\n",
+               packet_rates.front(), packet_rates[packet_rates.size() / 2],
+               packet_rates.back());
+  }
+
+  if (cvars::bench_seek_count > 0) {
+    BenchmarkSeeks(cvars::bench_seek_count);
+  }
+
+  player_.reset();
+  emulator_.reset();
+  return 0;
+}
+
+bool NullTraceBench::Setup() {
+  emulator_ = std::make_unique<Emulator>("", "", "");
+  X_STATUS result = emulator_->Setup(
+      nullptr, nullptr,
+      []() {
+        return std::unique_ptr<GraphicsSystem>(new NullGraphicsSystem());
+      },
+      nullptr);
+  if (XFAILED(result)) {
+    XELOGE("Failed to setup emulator: {:08X}", result);
+    return false;
+  }
+  auto graphics_system = emulator_->graphics_system();
+  command_processor_ =
+      static_cast<NullCommandProcessor*>(graphics_system->command_processor());
+  player_ = std::make_unique<TracePlayer>(nullptr, graphics_system);
+  return true;
+}
+
+NullTraceBench::RunResult NullTraceBench::Run() {
+  // The command processor thread is idle between playbacks.
+  command_processor_->ResetStats();
+  uint64_t start_ticks = Clock::QueryHostTickCount();
+  player_->PlayAll(true);
+  player_->WaitOnPlayback();
+  uint64_t end_ticks = Clock::QueryHostTickCount();
+
+  RunResult result;
+  result.seconds =
+      double(end_ticks - start_ticks) / double(Clock::QueryHostTickFrequency());
+  result.playback_stats = player_->playback_stats();
+  result.command_processor_stats = command_processor_->stats();
+  return result;
+}
+
+void NullTraceBench::BenchmarkSeeks(int32_t seek_count) {
+  int frame_index = 0;
+  for (int i = 1; i < player_->frame_count(); ++i) {
+    if (player_->frame(i)->commands.size() >
+        player_->frame(frame_index)->commands.size()) {
+      frame_index = i;
+    }
+  }
+  int command_count = int(player_->frame(frame_index)->commands.size());
+  if (command_count < 2) {
+    return;
+  }
+  // After PlayAll the player isn't in any frame, so this always plays it.
+  player_->SeekFrame(frame_index);
+  player_->WaitOnPlayback();
+
+  // Fixed seed so that runs with different settings are comparable.
+  std::mt19937 random_engine(0);
+  std::uniform_int_distribution<int> command_distribution(0,
+                                                          command_count - 1);
+  std::vector<double> latencies_ms;
+  for (int32_t i = 0; i < seek_count; ++i) {
+    int target_command = command_distribution(random_engine);
+    if (target_command == player_->current_command_index()) {
+      // Seeking to the current command doesn't play anything.
+      target_command = (target_command + 1) % command_count;
+    }
+    uint64_t start_ticks = Clock::QueryHostTickCount();
+    player_->SeekCommand(target_command);
+    player_->WaitOnPlayback();
+    uint64_t end_ticks = Clock::QueryHostTickCount();
+    latencies_ms.push_back(double(end_ticks - start_ticks) * 1000.0 /
+                           double(Clock::QueryHostTickFrequency()));
+  }
+  std::sort(latencies_ms.begin(), latencies_ms.end());
+  double total_ms = 0.0;
+  for (double latency_ms : latencies_ms) {
+    total_ms += latency_ms;
+  }
+  fmt::print(
+      "seeks in frame {} ({} commands): mean {:.3f} ms, median {:.3f} ms, "
+      "max {:.3f} ms\n",
+      frame_index, command_count, total_ms / latencies_ms.size(),
+      latencies_ms[latencies_ms.size() / 2], latencies_ms.back());
+}
+
+int null_trace_bench_main(const std::vector<std::string>& args) {
+  NullTraceBench bench;
+  return bench.Main(args);
+}
+
+}  // namespace null
+}  // namespace gpu
+}  // namespace xe
+
+DEFINE_ENTRY_POINT("xenia-gpu-null-trace-bench",
+                   xe::gpu::null::null_trace_bench_main,
+                   "[--bench_iterations=N] some.xtr", "trace_file");
@@ -16,3 +16,52 @@ project("xenia-gpu-null")
   defines({
   })
   local_platform_files()
+
+group("src")
+project("xenia-gpu-null-trace-bench")
+  uuid("b3f5e8a2-6c1d-4f7e-9a24-5d8c0e1b7f63")
+  kind("ConsoleApp")
+  language("C++")
+  links({
+    "aes_128",
+    "capstone",
+    "fmt",
+    "glslang-spirv",
+    "imgui",
+    "libavcodec",
+    "libavutil",
+    "mspack",
+    "snappy",
+    "spirv-tools",
+    "volk",
+    "xenia-apu",
+    "xenia-apu-nop",
+    "xenia-base",
+    "xenia-core",
+    "xenia-cpu",
+    "xenia-cpu-backend-x64",
+    "xenia-gpu",
+    "xenia-gpu-null",
+    "xenia-hid",
+    "xenia-hid-nop",
+    "xenia-kernel",
+    "xenia-ui",
+    "xenia-ui-spirv",
+    "xenia-ui-vulkan",
+    "xenia-vfs",
+    "xxhash",
+  })
+  defines({
+  })
+  files({
+    "null_trace_bench_main.cc",
+    "../../base/main_"..platform_suffix..".cc",
+  })
+
+  filter("platforms:Linux")
+    links({
+      "X11",
+      "xcb",
+      "X11-xcb",
+      "vulkan",
+    })
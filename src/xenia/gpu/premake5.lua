@@ -57,3 +57,38 @@ project("xenia-gpu-shader-compiler")
         "1>scratch/stdout-shader-compiler.txt",
       })
     end
+
+group("src")
+project("xenia-gpu-texture-bench")
+  uuid("6d2e91c4-8a3b-4f05-b7d1-2c9e4a70f358")
+  kind("ConsoleApp")
+  language("C++")
+  links({
+    "fmt",
+    "xenia-base",
+    "xenia-gpu",
+    "xxhash",
+  })
+  defines({
+  })
+  files({
+    "texture_bench_main.cc",
+    "../base/main_"..platform_suffix..".cc",
+  })
+
+project("xenia-gpu-register-bench")
+  uuid("5256b12c-dd52-417f-8e3d-d814d2367f4d")
+  kind("ConsoleApp")
+  language("C++")
+  links({
+    "fmt",
+    "xenia-base",
+    "xenia-gpu",
+    "xxhash",
+  })
+  defines({
+  })
+  files({
+    "register_bench_main.cc",
+    "../base/main_"..platform_suffix..".cc",
+  })
@@ -0,0 +1,167 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "third_party/fmt/include/fmt/format.h"
+#include "xenia/base/byte_order.h"
+#include "xenia/base/clock.h"
+#include "xenia/base/cvar.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/main.h"
+#include "xenia/base/ring_buffer.h"
+#include "xenia/gpu/register_file.h"
+#include "xenia/gpu/xenos.h"
+
+DEFINE_int32(bench_packets, 100000,
+             "Number of SET_CONSTANT packets executed in each timed run.",
+             "General");
+DEFINE_int32(bench_iterations, 10, "Number of timed runs of each path.",
+             "General");
+
+namespace xe {
+namespace gpu {
+
+using namespace xe::gpu::xenos;
+
+// Executes SET_CONSTANT packets the way CommandProcessor does, with either
+// one register write per dword or the bulk shader constant path, and the
+// dirty constant tracking of the Vulkan backend on top. The bulk path and the
+// dirty tracking are the ones CommandProcessor and VulkanCommandProcessor
+// use. A real CommandProcessor needs a graphics system, guest memory and a
+// kernel, so the per-register path only does the register file part of
+// CommandProcessor::WriteRegister.
+class RegisterWriter {
+ public:
+  void ExecuteSetConstant(RingBuffer* reader, uint32_t count, bool bulk);
+
+ private:
+  void WriteRegister(uint32_t index, uint32_t value);
+
+  RegisterFile register_file_;
+  DirtyShaderConstants dirty_shader_constants_;
+};
+
+void RegisterWriter::ExecuteSetConstant(RingBuffer* reader, uint32_t count,
+                                        bool bulk) {
+  uint32_t offset_type = reader->ReadAndSwap<uint32_t>();
+  uint32_t index = offset_type & 0x7FF;
+  switch ((offset_type >> 16) & 0xFF) {
+    case 0:  // ALU
+      index += 0x4000;
+      break;
+    case 1:  // FETCH
+      index += 0x4800;
+      break;
+    case 2:  // BOOL
+      index += 0x4900;
+      break;
+    case 3:  // LOOP
+      index += 0x4908;
+      break;
+    default:
+      reader->AdvanceRead((count - 1) * sizeof(uint32_t));
+      return;
+  }
+  if (bulk &&
+      register_file_.WriteShaderConstantsFromRing(reader, index, count - 1)) {
+    dirty_shader_constants_.MarkRange(index, count - 1);
+    return;
+  }
+  for (uint32_t n = 0; n < count - 1; n++, index++) {
+    WriteRegister(index, reader->ReadAndSwap<uint32_t>());
+  }
+}
+
+void RegisterWriter::WriteRegister(uint32_t index, uint32_t value) {
+  if (index >= RegisterFile::kRegisterCount) {
+    return;
+  }
+  register_file_.values[index].u32 = value;
+  if (!register_file_.GetRegisterInfo(index)) {
+    XELOGW("GPU: Write to unknown register ({:04X} = {:08X})", index, value);
+  }
+  dirty_shader_constants_.MarkRegister(index);
+}
+
+// Builds a ring of SET_CONSTANT packets, each writing data_dwords float
+// constants at offsets walking through the constant file. The ring holds a
+// whole number of packets, so they can be executed in a loop.
+static std::vector<uint32_t> BuildPackets(uint32_t data_dwords) {
+  uint32_t packet_dwords = 2 + data_dwords;
+  uint32_t packet_count = std::max(64 * 1024 / packet_dwords, uint32_t(1));
+  std::vector<uint32_t> ring;
+  ring.reserve(packet_count * packet_dwords);
+  for (uint32_t i = 0; i < packet_count; ++i) {
+    ring.push_back(xe::byte_swap((3u << 30) | ((packet_dwords - 2) << 16) |
+                                 (uint32_t(PM4_SET_CONSTANT) << 8)));
+    // Type 0 (ALU) in the upper half.
+    ring.push_back(xe::byte_swap(i * data_dwords % (0x800 - data_dwords + 1)));
+    for (uint32_t j = 0; j < data_dwords; ++j) {
+      ring.push_back(xe::byte_swap(i + j));
+    }
+  }
+  return ring;
+}
+
+// Returns the median time of executing cvars::bench_packets packets from the
+// ring, in seconds.
+static double TimePackets(std::vector<uint32_t>& ring, bool bulk) {
+  auto writer = std::make_unique<RegisterWriter>();
+  RingBuffer reader(reinterpret_cast<uint8_t*>(ring.data()),
+                    ring.size() * sizeof(uint32_t));
+  std::vector<double> seconds;
+  // The first run is a warm-up.
+  for (int32_t i = 0; i <= cvars::bench_iterations; ++i) {
+    uint64_t start_ticks = Clock::QueryHostTickCount();
+    for (int32_t j = 0; j < cvars::bench_packets; ++j) {
+      uint32_t packet = reader.ReadAndSwap<uint32_t>();
+      writer->ExecuteSetConstant(&reader, ((packet >> 16) & 0x3FFF) + 1, bulk);
+    }
+    uint64_t end_ticks = Clock::QueryHostTickCount();
+    if (i) {
+      seconds.push_back(double(end_ticks - start_ticks) /
+                        double(Clock::QueryHostTickFrequency()));
+    }
+  }
+  std::sort(seconds.begin(), seconds.end());
+  return seconds[seconds.size() / 2];
+}
+
+int register_bench_main(const std::vector<std::string>& args) {
+  if (cvars::bench_packets <= 0 || cvars::bench_iterations <= 0) {
+    XELOGE("Usage: {} [--bench_packets=N] [--bench_iterations=N]",
+           xe::path_to_utf8(args[0]));
+    return 1;
+  }
+  static const uint32_t data_sizes[] = {4, 16, 64, 256};
+  fmt::print("{} SET_CONSTANT packets, median of {} runs\n",
+             cvars::bench_packets, cvars::bench_iterations);
+  fmt::print("{:>7} {:>16} {:>16} {:>8}\n", "dwords", "per-reg pkt/s",
+             "bulk pkt/s", "speedup");
+  for (uint32_t data_dwords : data_sizes) {
+    auto ring = BuildPackets(data_dwords);
+    double per_register_seconds = TimePackets(ring, false);
+    double bulk_seconds = TimePackets(ring, true);
+    fmt::print("{:>7} {:>16.0f} {:>16.0f} {:>7.2f}x\n", data_dwords,
+               cvars::bench_packets / per_register_seconds,
+               cvars::bench_packets / bulk_seconds,
+               per_register_seconds / bulk_seconds);
+  }
+  return 0;
+}
+
+}  // namespace gpu
+}  // namespace xe
+
+DEFINE_ENTRY_POINT("xenia-gpu-register-bench", xe::gpu::register_bench_main,
+                   "[--bench_packets=N] [--bench_iterations=N]");
@@ -9,29 +9,143 @@
 
 #include "xenia/gpu/register_file.h"
 
+#include <algorithm>
 #include <cstring>
 
 #include "xenia/base/math.h"
+#include "xenia/base/memory.h"
 
 namespace xe {
 namespace gpu {
 
-RegisterFile::RegisterFile() { std::memset(values, 0, sizeof(values)); }
+namespace {
 
-const RegisterInfo* RegisterFile::GetRegisterInfo(uint32_t index) {
-  switch (index) {
+struct RegisterTableEntry {
+  uint32_t index;
+  RegisterInfo info;
+};
+
+constexpr RegisterTableEntry kRegisterTable[] = {
 #define XE_GPU_REGISTER(index, type, name) \
-  case index: {                            \
-    static const RegisterInfo reg_info = { \
-        RegisterInfo::Type::type,          \
-        #name,                             \
-    };                                     \
-    return &reg_info;                      \
-  }
+  {index, {RegisterInfo::Type::type, #name}},
 #include "xenia/gpu/register_table.inc"
 #undef XE_GPU_REGISTER
-    default:
-      return nullptr;
+};
+
+// Index + 1 of the entry in kRegisterTable for every register, or 0 for
+// unknown registers, so lookups don't need to search the table.
+struct RegisterInfoIndex {
+  uint16_t entries[RegisterFile::kRegisterCount];
+};
+
+constexpr RegisterInfoIndex BuildRegisterInfoIndex() {
+  RegisterInfoIndex index = {};
+  for (size_t i = 0; i < sizeof(kRegisterTable) / sizeof(kRegisterTable[0]);
+       ++i) {
+    index.entries[kRegisterTable[i].index] = uint16_t(i + 1);
+  }
+  return index;
+}
+
+constexpr RegisterInfoIndex kRegisterInfoIndex = BuildRegisterInfoIndex();
+
+}  // namespace
+
+RegisterFile::RegisterFile() { std::memset(values, 0, sizeof(values)); }
+
+const RegisterInfo* RegisterFile::GetRegisterInfo(uint32_t index) {
+  if (index >= kRegisterCount) {
+    return nullptr;
+  }
+  uint32_t entry = kRegisterInfoIndex.entries[index];
+  return entry ? &kRegisterTable[entry - 1].info : nullptr;
+}
+
+bool RegisterFile::IsShaderConstantRange(uint32_t start_index,
+                                         uint32_t count) {
+  uint32_t end_index = start_index + count;
+  if (!count || end_index < start_index) {
+    return false;
+  }
+  return (start_index >= XE_GPU_REG_SHADER_CONSTANT_000_X &&
+          end_index <= XE_GPU_REG_SHADER_CONSTANT_FETCH_31_5 + 1) ||
+         (start_index >= XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031 &&
+          end_index <= XE_GPU_REG_SHADER_CONSTANT_LOOP_31 + 1);
+}
+
+bool RegisterFile::WriteShaderConstantsFromMem(uint32_t start_index,
+                                               const uint32_t* source,
+                                               uint32_t count) {
+  if (!IsShaderConstantRange(start_index, count)) {
+    return false;
+  }
+  xe::copy_and_swap_32_unaligned(&values[start_index], source, count);
+  return true;
+}
+
+bool RegisterFile::WriteShaderConstantsFromRing(RingBuffer* reader,
+                                                uint32_t start_index,
+                                                uint32_t count) {
+  if (!IsShaderConstantRange(start_index, count)) {
+    return false;
+  }
+  // The data may wrap around the end of the ring buffer.
+  auto read_range = reader->BeginRead(count * sizeof(uint32_t));
+  size_t first_count = read_range.first_length / sizeof(uint32_t);
+  xe::copy_and_swap_32_unaligned(&values[start_index], read_range.first,
+                                 first_count);
+  if (read_range.second) {
+    xe::copy_and_swap_32_unaligned(&values[start_index + first_count],
+                                   read_range.second,
+                                   read_range.second_length / sizeof(uint32_t));
+  }
+  reader->EndRead(read_range);
+  return true;
+}
+
+bool DirtyShaderConstants::MarkRegister(uint32_t index) {
+  if (index >= XE_GPU_REG_SHADER_CONSTANT_000_X &&
+      index <= XE_GPU_REG_SHADER_CONSTANT_511_W) {
+    uint32_t offset = (index - XE_GPU_REG_SHADER_CONSTANT_000_X) / (4 * 4);
+    float_constants |= 1ull << (offset ^ 0x3F);
+  } else if (index >= XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031 &&
+             index <= XE_GPU_REG_SHADER_CONSTANT_BOOL_224_255) {
+    uint32_t offset = index - XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031;
+    bool_constants |= 1 << (offset ^ 0x7);
+  } else if (index >= XE_GPU_REG_SHADER_CONSTANT_LOOP_00 &&
+             index <= XE_GPU_REG_SHADER_CONSTANT_LOOP_31) {
+    uint32_t offset = index - XE_GPU_REG_SHADER_CONSTANT_LOOP_00;
+    loop_constants |= 1 << (offset ^ 0x1F);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void DirtyShaderConstants::MarkRange(uint32_t start_index, uint32_t count) {
+  // Same bit layouts as in MarkRegister, one float bit per 16 registers.
+  uint32_t end_index = start_index + count;
+  uint32_t float_start =
+      std::max(start_index, uint32_t(XE_GPU_REG_SHADER_CONSTANT_000_X));
+  uint32_t float_end =
+      std::min(end_index, uint32_t(XE_GPU_REG_SHADER_CONSTANT_511_W + 1));
+  for (uint32_t index = float_start; index < float_end;
+       index = (index | 15) + 1) {
+    MarkRegister(index);
+  }
+  uint32_t bool_start = std::max(
+      start_index, uint32_t(XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031));
+  uint32_t bool_end = std::min(
+      end_index, uint32_t(XE_GPU_REG_SHADER_CONSTANT_BOOL_224_255 + 1));
+  for (uint32_t index = bool_start; index < bool_end; ++index) {
+    MarkRegister(index);
+  }
+  uint32_t loop_start =
+      std::max(start_index, uint32_t(XE_GPU_REG_SHADER_CONSTANT_LOOP_00));
+  uint32_t loop_end =
+      std::min(end_index, uint32_t(XE_GPU_REG_SHADER_CONSTANT_LOOP_31 + 1));
+  for (uint32_t index = loop_start; index < loop_end; ++index) {
+    MarkRegister(index);
   }
 }
 
@@ -13,6 +13,7 @@
 #include <cstdint>
 #include <cstdlib>
 
+#include "xenia/base/ring_buffer.h"
 #include "xenia/gpu/registers.h"
 
 namespace xe {
@@ -54,6 +55,31 @@ class RegisterFile {
   T& Get() {
     return *reinterpret_cast<T*>(&values[T::register_index]);
   }
+
+  // Whether all registers in the range are float, fetch, bool or loop shader
+  // constants, which have no side effects when written.
+  static bool IsShaderConstantRange(uint32_t start_index, uint32_t count);
+  // If IsShaderConstantRange, copies count big-endian values from the source
+  // to the registers in one go and returns true. Otherwise writes nothing and
+  // returns false, and the registers need to be written one by one.
+  bool WriteShaderConstantsFromMem(uint32_t start_index, const uint32_t* source,
+                                   uint32_t count);
+  // Same as WriteShaderConstantsFromMem, for values read from the ring buffer.
+  // Nothing is read if false is returned.
+  bool WriteShaderConstantsFromRing(RingBuffer* reader, uint32_t start_index,
+                                    uint32_t count);
+};
+
+// Float (in blocks of 4 constants), bool and loop shader constants written
+// since the backend last consumed them.
+struct DirtyShaderConstants {
+  uint64_t float_constants = 0;
+  uint8_t bool_constants = 0;
+  uint32_t loop_constants = 0;
+
+  // Returns false if the register isn't a float, bool or loop constant.
+  bool MarkRegister(uint32_t index);
+  void MarkRange(uint32_t start_index, uint32_t count);
 };
 
 }  // namespace gpu
@@ -0,0 +1,236 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "third_party/fmt/include/fmt/format.h"
+#include "xenia/base/clock.h"
+#include "xenia/base/cvar.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/main.h"
+#include "xenia/base/math.h"
+#include "xenia/base/threading.h"
+#include "xenia/gpu/texture_conversion.h"
+#include "xenia/gpu/texture_info.h"
+
+DEFINE_int32(bench_texture_size, -1,
+             "Width and height of the benchmarked textures, in blocks, or -1 "
+             "for 256, 512, 1024 and 2048.",
+             "General");
+DEFINE_int32(bench_iterations, 10,
+             "Number of timed conversions of each texture.", "General");
+DEFINE_int32(bench_max_conversion_threads, -1,
+             "Largest number of conversion pool threads to time mip chain "
+             "conversion with, or -1 for the number of logical processors.",
+             "General");
+
+namespace xe {
+namespace gpu {
+
+// Times texture untiling on the CPU, with no host GPU, so that the untiling
+// kernels can be compared against the per-block callback they replace, and
+// the conversion thread pool against converting on one thread.
+class TextureBench {
+ public:
+  int Main(const std::vector<std::string>& args);
+
+ private:
+  void BenchmarkUntile();
+  void BenchmarkConversion();
+  // Returns the median time of an untile of the whole texture, in seconds.
+  double TimeUntile(const texture_conversion::UntileInfo& untile_info);
+  // Returns the median time of untiling the whole mip chain of a 32bpp
+  // texture split into bands like the Vulkan texture cache does, in seconds.
+  double TimeConversion(uint32_t thread_count);
+
+  uint32_t size_ = 0;
+  std::vector<uint8_t> tiled_;
+  std::vector<uint8_t> untiled_;
+};
+
+int TextureBench::Main(const std::vector<std::string>& args) {
+  if (!cvars::bench_texture_size || cvars::bench_iterations <= 0) {
+    XELOGE("Usage: {} [--bench_texture_size=N] [--bench_iterations=N]",
+           xe::path_to_utf8(args[0]));
+    return 1;
+  }
+  std::vector<uint32_t> sizes;
+  if (cvars::bench_texture_size > 0) {
+    // Tiled surfaces are padded to whole 32x32 tiles.
+    sizes.push_back(
+        xe::align(uint32_t(cvars::bench_texture_size), uint32_t(32)));
+  } else {
+    sizes = {256, 512, 1024, 2048};
+  }
+  std::mt19937 random_engine(0);
+  for (uint32_t size : sizes) {
+    size_ = size;
+    tiled_.resize(size_t(size_) * size_ * 16);
+    untiled_.resize(tiled_.size());
+    std::generate(tiled_.begin(), tiled_.end(),
+                  [&random_engine]() { return uint8_t(random_engine()); });
+    BenchmarkUntile();
+    BenchmarkConversion();
+  }
+  return 0;
+}
+
+void TextureBench::BenchmarkUntile() {
+  static const xenos::TextureFormat formats[] = {
+      xenos::TextureFormat::k_8,
+      xenos::TextureFormat::k_8_8,
+      xenos::TextureFormat::k_8_8_8_8,
+      xenos::TextureFormat::k_16_16_16_16,
+      xenos::TextureFormat::k_32_32_32_FLOAT,
+      xenos::TextureFormat::k_32_32_32_32_FLOAT,
+  };
+  static const xenos::Endian endians[] = {
+      xenos::Endian::kNone,
+      xenos::Endian::k8in16,
+      xenos::Endian::k8in32,
+      xenos::Endian::k16in32,
+  };
+
+  fmt::print("untiling {0}x{0} blocks, median of {1} runs\n", size_,
+             cvars::bench_iterations);
+  fmt::print("{:<20} {:>4} {:>7} {:>12} {:>12} {:>12} {:>8}\n", "format", "bpb",
+             "endian", "untile ms", "callback ms", "untile MB/s", "speedup");
+  for (xenos::TextureFormat format : formats) {
+    const FormatInfo* format_info = FormatInfo::Get(format);
+    for (xenos::Endian endian : endians) {
+      texture_conversion::UntileInfo untile_info;
+      untile_info.offset_x = 0;
+      untile_info.offset_y = 0;
+      untile_info.width = size_;
+      untile_info.height = size_;
+      untile_info.input_pitch = size_;
+      untile_info.output_pitch = size_;
+      untile_info.input_format_info = format_info;
+      untile_info.output_format_info = format_info;
+      untile_info.endian = endian;
+      double untile_seconds = TimeUntile(untile_info);
+
+      untile_info.copy_callback = [endian](void* output, const void* input,
+                                           size_t length) {
+        texture_conversion::CopySwapBlock(endian, output, input, length);
+      };
+      double callback_seconds = TimeUntile(untile_info);
+
+      double megabytes =
+          double(size_) * size_ * format_info->bytes_per_block() / 1048576.0;
+      fmt::print(
+          "{:<20} {:>4} {:>7} {:>12.3f} {:>12.3f} {:>12.0f} {:>7.2f}x\n",
+          format_info->name, format_info->bytes_per_block(),
+          uint32_t(endian), untile_seconds * 1000.0, callback_seconds * 1000.0,
+          megabytes / untile_seconds, callback_seconds / untile_seconds);
+    }
+  }
+}
+
+void TextureBench::BenchmarkConversion() {
+  uint32_t max_thread_count = xe::threading::logical_processor_count();
+  if (cvars::bench_max_conversion_threads >= 0) {
+    max_thread_count = uint32_t(cvars::bench_max_conversion_threads);
+  }
+  fmt::print(
+      "\nconverting a {0}x{0} k_8_8_8_8 mip chain, median of {1} runs\n", size_,
+      cvars::bench_iterations);
+  fmt::print("{:>8} {:>12} {:>8}\n", "threads", "ms", "speedup");
+  double single_thread_seconds = 0.0;
+  for (uint32_t thread_count = 0; thread_count <= max_thread_count;
+       thread_count = thread_count ? thread_count * 2 : 1) {
+    double seconds = TimeConversion(thread_count);
+    if (!thread_count) {
+      single_thread_seconds = seconds;
+    }
+    fmt::print("{:>8} {:>12.3f} {:>7.2f}x\n", thread_count, seconds * 1000.0,
+               single_thread_seconds / seconds);
+  }
+  fmt::print("\n");
+}
+
+double TextureBench::TimeUntile(
+    const texture_conversion::UntileInfo& untile_info) {
+  // Warm up the caches and the page mappings of the output.
+  texture_conversion::Untile(untiled_.data(), tiled_.data(), &untile_info);
+  std::vector<double> seconds;
+  for (int32_t i = 0; i < cvars::bench_iterations; ++i) {
+    uint64_t start_ticks = Clock::QueryHostTickCount();
+    texture_conversion::Untile(untiled_.data(), tiled_.data(), &untile_info);
+    uint64_t end_ticks = Clock::QueryHostTickCount();
+    seconds.push_back(double(end_ticks - start_ticks) /
+                      double(Clock::QueryHostTickFrequency()));
+  }
+  std::sort(seconds.begin(), seconds.end());
+  return seconds[seconds.size() / 2];
+}
+
+double TextureBench::TimeConversion(uint32_t thread_count) {
+  // Same band size as the Vulkan texture cache.
+  const uint32_t kBandSize = 256 * 1024;
+  const FormatInfo* format_info =
+      FormatInfo::Get(xenos::TextureFormat::k_8_8_8_8);
+  uint32_t bytes_per_block = format_info->bytes_per_block();
+
+  std::vector<std::function<void()>> jobs;
+  size_t output_offset = 0;
+  for (uint32_t mip_size = size_; mip_size; mip_size >>= 1) {
+    texture_conversion::UntileInfo untile_info;
+    untile_info.offset_x = 0;
+    untile_info.width = mip_size;
+    untile_info.input_pitch = xe::align(mip_size, uint32_t(32));
+    untile_info.output_pitch = mip_size;
+    untile_info.input_format_info = format_info;
+    untile_info.output_format_info = format_info;
+    untile_info.endian = xenos::Endian::k8in32;
+    uint32_t output_pitch = mip_size * bytes_per_block;
+    uint32_t band_rows = std::max(kBandSize / output_pitch, uint32_t(1));
+    for (uint32_t band_y = 0; band_y < mip_size; band_y += band_rows) {
+      untile_info.offset_y = band_y;
+      untile_info.height = std::min(band_rows, mip_size - band_y);
+      uint8_t* band_output =
+          untiled_.data() + output_offset + band_y * output_pitch;
+      // All mips read the same random data.
+      const uint8_t* input = tiled_.data();
+      jobs.push_back([=]() {
+        texture_conversion::Untile(band_output, input, &untile_info);
+      });
+    }
+    output_offset += size_t(output_pitch) * mip_size;
+  }
+
+  texture_conversion::ConversionThreadPool pool(thread_count);
+  auto run_job = [&jobs](uint32_t i) { jobs[i](); };
+  pool.Run(uint32_t(jobs.size()), run_job);
+  std::vector<double> seconds;
+  for (int32_t i = 0; i < cvars::bench_iterations; ++i) {
+    uint64_t start_ticks = Clock::QueryHostTickCount();
+    pool.Run(uint32_t(jobs.size()), run_job);
+    uint64_t end_ticks = Clock::QueryHostTickCount();
+    seconds.push_back(double(end_ticks - start_ticks) /
+                      double(Clock::QueryHostTickFrequency()));
+  }
+  std::sort(seconds.begin(), seconds.end());
+  return seconds[seconds.size() / 2];
+}
+
+int texture_bench_main(const std::vector<std::string>& args) {
+  TextureBench bench;
+  return bench.Main(args);
+}
+
+}  // namespace gpu
+}  // namespace xe
+
+DEFINE_ENTRY_POINT("xenia-gpu-texture-bench", xe::gpu::texture_bench_main,
+                   "[--bench_texture_size=N] [--bench_iterations=N]");
@@ -38,7 +38,7 @@ void CopySwapBlock(xenos::Endian endian, void* output, const void* input,
       break;
     case xenos::Endian::k16in32:  // Swap high and low 16 bits within a 32 bit
                                   // word
-      xe::copy_and_swap_16_in_32_unaligned(output, input, length);
+      xe::copy_and_swap_16_in_32_unaligned(output, input, length / 4);
       break;
     default:
     case xenos::Endian::kNone:
@@ -109,13 +109,12 @@ static uint32_t TiledOffset2DColumn(uint32_t x, uint32_t y, uint32_t log2_bpp,
          ((y & 16) << 7) + (((((y & 8) >> 2) + (x >> 3)) & 3) << 6);
 }
 
-void Untile(uint8_t* output_buffer, const uint8_t* input_buffer,
-            const UntileInfo* untile_info) {
-  SCOPE_profile_cpu_f("gpu");
-  assert_not_null(untile_info);
-  assert_not_null(untile_info->input_format_info);
-  assert_not_null(untile_info->output_format_info);
-
+// Untiles block by block, for converting formats and for block sizes that
+// have no kernel.
+static void UntileWithCallback(uint8_t* output_buffer,
+                               const uint8_t* input_buffer,
+                               const UntileInfo* untile_info,
+                               const UntileCopyBlockCallback& copy_callback) {
   uint32_t input_bytes_per_block =
       untile_info->input_format_info->bytes_per_block();
   uint32_t output_bytes_per_block =
@@ -141,10 +140,9 @@ void Untile(uint8_t* output_buffer, const uint8_t* input_buffer,
                                               log2_bpp, input_row_offset);
       input_offset >>= log2_bpp;
 
-      untile_info->copy_callback(
-          &output_buffer[output_offset],
-          &input_buffer[input_offset * input_bytes_per_block],
-          output_bytes_per_block);
+      copy_callback(&output_buffer[output_offset],
+                    &input_buffer[input_offset * input_bytes_per_block],
+                    output_bytes_per_block);
 
       output_offset += output_bytes_per_block;
     }
@@ -153,6 +151,213 @@ void Untile(uint8_t* output_buffer, const uint8_t* input_buffer,
   }
 }
 
+// Endian swap of 8 bytes held in a register.
+template <Endian kEndian>
+static inline uint64_t SwapRun64(uint64_t value) {
+  if (kEndian == Endian::k8in16 || kEndian == Endian::k8in32) {
+    value = ((value & 0x00FF00FF00FF00FFull) << 8) |
+            ((value >> 8) & 0x00FF00FF00FF00FFull);
+  }
+  if (kEndian == Endian::k8in32 || kEndian == Endian::k16in32) {
+    value = ((value & 0x0000FFFF0000FFFFull) << 16) |
+            ((value >> 16) & 0x0000FFFF0000FFFFull);
+  }
+  return value;
+}
+
+// Copies one contiguous run of tiled memory, swapping as it goes.
+template <Endian kEndian, uint32_t kLength>
+static inline void CopySwapRun(uint8_t* output, const uint8_t* input) {
+  static_assert(kLength == 8 || kLength == 16, "Runs are 8 or 16 bytes");
+#if XE_ARCH_AMD64
+  if (kLength == 16) {
+    __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input));
+    if (kEndian == Endian::k8in16) {
+      data = _mm_shuffle_epi8(data, _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9,
+                                                  8, 11, 10, 13, 12, 15, 14));
+    } else if (kEndian == Endian::k8in32) {
+      data = _mm_shuffle_epi8(data, _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11,
+                                                  10, 9, 8, 15, 14, 13, 12));
+    } else if (kEndian == Endian::k16in32) {
+      data = _mm_or_si128(_mm_slli_epi32(data, 16), _mm_srli_epi32(data, 16));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output), data);
+    return;
+  }
+#endif  // XE_ARCH_AMD64
+  for (uint32_t i = 0; i < kLength; i += 8) {
+    uint64_t value;
+    std::memcpy(&value, input + i, 8);
+    value = SwapRun64<kEndian>(value);
+    std::memcpy(output + i, &value, 8);
+  }
+}
+
+// Untiles a region by copying whole contiguous runs of the tiled layout.
+//
+// Within a row, the column part of the tiled offset is linear over every
+// aligned group of 8 blocks (1bpb) or 16 bytes (larger blocks), so the
+// address only needs to be computed once per run, and each run can be copied
+// and swapped with a single 16-byte (or 8-byte) load and store. Runs only
+// partially inside the region are swapped into a temporary and trimmed -
+// tiled surfaces are padded to whole 32x32 tiles, so the full run is always
+// there to read.
+template <uint32_t kLog2BytesPerBlock, Endian kEndian>
+static void UntileKernel(uint8_t* output_buffer, const uint8_t* input_buffer,
+                         const UntileInfo* untile_info) {
+  constexpr uint32_t kRunBytes = kLog2BytesPerBlock ? 16 : 8;
+  constexpr uint32_t kRunBlocks = kRunBytes >> kLog2BytesPerBlock;
+
+  uint32_t output_pitch = untile_info->output_pitch << kLog2BytesPerBlock;
+  uint32_t x_begin = untile_info->offset_x;
+  uint32_t x_end = x_begin + untile_info->width;
+  uint32_t x_run_begin = x_begin & ~(kRunBlocks - 1);
+
+  for (uint32_t y = 0; y < untile_info->height; y++) {
+    uint32_t tiled_y = untile_info->offset_y + y;
+    uint32_t input_row_offset =
+        TiledOffset2DRow(tiled_y, untile_info->input_pitch, kLog2BytesPerBlock);
+    uint8_t* output = output_buffer + y * output_pitch;
+
+    for (uint32_t x = x_run_begin; x < x_end; x += kRunBlocks) {
+      const uint8_t* input =
+          input_buffer + TiledOffset2DColumn(x, tiled_y, kLog2BytesPerBlock,
+                                             input_row_offset);
+      uint32_t copy_begin = std::max(x, x_begin);
+      uint32_t copy_end = std::min(x + kRunBlocks, x_end);
+      if (copy_end - copy_begin == kRunBlocks) {
+        CopySwapRun<kEndian, kRunBytes>(output, input);
+      } else {
+        uint8_t run[kRunBytes];
+        CopySwapRun<kEndian, kRunBytes>(run, input);
+        std::memcpy(output, run + ((copy_begin - x) << kLog2BytesPerBlock),
+                    (copy_end - copy_begin) << kLog2BytesPerBlock);
+      }
+      output += (copy_end - copy_begin) << kLog2BytesPerBlock;
+    }
+  }
+}
+
+typedef void (*UntileKernelFunction)(uint8_t* output_buffer,
+                                     const uint8_t* input_buffer,
+                                     const UntileInfo* untile_info);
+
+#define XE_UNTILE_KERNELS(log2_bpb)                                   \
+  {                                                                   \
+    UntileKernel<log2_bpb, Endian::kNone>,                            \
+        UntileKernel<log2_bpb, Endian::k8in16>,                       \
+        UntileKernel<log2_bpb, Endian::k8in32>,                       \
+        UntileKernel<log2_bpb, Endian::k16in32>                       \
+  }
+// Indexed by [log2(bytes per block)][endian].
+static const UntileKernelFunction untile_kernels[5][4] = {
+    XE_UNTILE_KERNELS(0), XE_UNTILE_KERNELS(1), XE_UNTILE_KERNELS(2),
+    XE_UNTILE_KERNELS(3), XE_UNTILE_KERNELS(4),
+};
+#undef XE_UNTILE_KERNELS
+
+void Untile(uint8_t* output_buffer, const uint8_t* input_buffer,
+            const UntileInfo* untile_info) {
+  SCOPE_profile_cpu_f("gpu");
+  assert_not_null(untile_info);
+  assert_not_null(untile_info->input_format_info);
+  assert_not_null(untile_info->output_format_info);
+
+  if (untile_info->copy_callback) {
+    UntileWithCallback(output_buffer, input_buffer, untile_info,
+                       untile_info->copy_callback);
+    return;
+  }
+
+  uint32_t bytes_per_block = untile_info->input_format_info->bytes_per_block();
+  assert_true(bytes_per_block ==
+              untile_info->output_format_info->bytes_per_block());
+  if ((bytes_per_block & (bytes_per_block - 1)) || bytes_per_block > 16) {
+    // Runs don't line up with blocks that aren't a power of two in size, like
+    // the 12 bytes of k_32_32_32_FLOAT.
+    xenos::Endian endian = untile_info->endian;
+    UntileWithCallback(output_buffer, input_buffer, untile_info,
+                       [endian](void* output, const void* input,
+                                size_t length) {
+                         CopySwapBlock(endian, output, input, length);
+                       });
+    return;
+  }
+  uint32_t log2_bpb = xe::log2_floor(bytes_per_block);
+  untile_kernels[log2_bpb][uint32_t(untile_info->endian)](
+      output_buffer, input_buffer, untile_info);
+}
+
+ConversionThreadPool::ConversionThreadPool(uint32_t thread_count) {
+  for (uint32_t i = 0; i < thread_count; ++i) {
+    threads_.emplace_back([this]() {
+      xe::threading::set_name("Texture Conversion");
+      WorkerThread();
+    });
+  }
+}
+
+ConversionThreadPool::~ConversionThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    shutdown_ = true;
+  }
+  work_cond_.notify_all();
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+void ConversionThreadPool::Run(uint32_t job_count,
+                               const std::function<void(uint32_t)>& job) {
+  if (threads_.empty() || job_count <= 1) {
+    for (uint32_t i = 0; i < job_count; ++i) {
+      job(i);
+    }
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(lock_);
+  assert_zero(jobs_remaining_);
+  job_ = &job;
+  job_count_ = job_count;
+  next_job_ = 0;
+  jobs_remaining_ = job_count;
+  work_cond_.notify_all();
+
+  // Help out rather than idling until the workers are done.
+  while (next_job_ < job_count_) {
+    uint32_t job_index = next_job_++;
+    lock.unlock();
+    job(job_index);
+    lock.lock();
+    --jobs_remaining_;
+  }
+  done_cond_.wait(lock, [this]() { return !jobs_remaining_; });
+  job_ = nullptr;
+  job_count_ = 0;
+  next_job_ = 0;
+}
+
+void ConversionThreadPool::WorkerThread() {
+  std::unique_lock<std::mutex> lock(lock_);
+  while (true) {
+    work_cond_.wait(lock,
+                    [this]() { return shutdown_ || next_job_ < job_count_; });
+    if (shutdown_) {
+      return;
+    }
+    uint32_t job_index = next_job_++;
+    auto job = job_;
+    lock.unlock();
+    (*job)(job_index);
+    lock.lock();
+    if (!--jobs_remaining_) {
+      done_cond_.notify_all();
+    }
+  }
+}
+
 }  //  namespace texture_conversion
 }  //  namespace gpu
 }  //  namespace xe
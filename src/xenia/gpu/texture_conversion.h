@@ -10,11 +10,16 @@
 #ifndef XENIA_GPU_TEXTURE_CONVERSION_H_
 #define XENIA_GPU_TEXTURE_CONVERSION_H_
 
+#include <condition_variable>
 #include <cstring>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "xenia/base/assert.h"
+#include "xenia/base/threading.h"
 #include "xenia/gpu/texture_info.h"
 #include "xenia/gpu/xenos.h"
 
@@ -35,6 +40,7 @@ void ConvertTexelDXT3AToDXT3(xenos::Endian endian, void* output,
 typedef std::function<void(void*, const void*, size_t)> UntileCopyBlockCallback;
 
 typedef struct UntileInfo {
+  // Offset of the region to untile within the tiled surface, in blocks.
   uint32_t offset_x;
   uint32_t offset_y;
   uint32_t width;
@@ -43,12 +49,49 @@ typedef struct UntileInfo {
   uint32_t output_pitch;
   const FormatInfo* input_format_info;
   const FormatInfo* output_format_info;
+  // Per-block conversion for formats that change in size or layout when
+  // untiled. If not set, the input and output formats must have the same
+  // block size, and blocks are copied with the endian swap below - using a
+  // kernel specialized for the block size if it's a power of two.
   UntileCopyBlockCallback copy_callback;
+  xenos::Endian endian;
 } UntileInfo;
 
 void Untile(uint8_t* output_buffer, const uint8_t* input_buffer,
             const UntileInfo* untile_info);
 
+// Worker threads for splitting the conversion of a texture (mips, faces, row
+// bands) so a large upload doesn't serialize on the command processor thread.
+// Run may only be called from one thread at a time.
+class ConversionThreadPool {
+ public:
+  // With a thread count of 0 all jobs run on the calling thread.
+  explicit ConversionThreadPool(uint32_t thread_count);
+  ~ConversionThreadPool();
+
+  uint32_t thread_count() const { return uint32_t(threads_.size()); }
+
+  // Calls job(i) for every i in [0, job_count), on the workers and the calling
+  // thread, and returns once all of them have completed.
+  void Run(uint32_t job_count, const std::function<void(uint32_t)>& job);
+
+ private:
+  void WorkerThread();
+
+  std::mutex lock_;
+  // Notified when a new batch of jobs is available or on shutdown.
+  std::condition_variable work_cond_;
+  // Notified when the last job of a batch completes.
+  std::condition_variable done_cond_;
+  // The current batch, protected by lock_.
+  const std::function<void(uint32_t)>* job_ = nullptr;
+  uint32_t job_count_ = 0;
+  uint32_t next_job_ = 0;
+  uint32_t jobs_remaining_ = 0;
+  bool shutdown_ = false;
+  std::vector<std::thread> threads_;
+};
+
 }  // namespace texture_conversion
 }  // namespace gpu
 }  // namespace xe
@@ -9,13 +9,20 @@
 
 #include "xenia/gpu/trace_player.h"
 
+#include <cstring>
+
 #include "xenia/gpu/command_processor.h"
+#include "xenia/gpu/gpu_flags.h"
 #include "xenia/gpu/graphics_system.h"
 #include "xenia/memory.h"
 
 namespace xe {
 namespace gpu {
 
+constexpr size_t kEDRAMSize = 10 * 1024 * 1024;
+constexpr uint32_t kCheckpointPageSizeLog2 = 12;
+constexpr uint32_t kCheckpointPageSize = 1 << kCheckpointPageSizeLog2;
+
 TracePlayer::TracePlayer(xe::ui::Loop* loop, GraphicsSystem* graphics_system)
     : loop_(loop),
       graphics_system_(graphics_system),
@@ -35,7 +42,7 @@ TracePlayer::TracePlayer(xe::ui::Loop* loop, GraphicsSystem* graphics_system)
 TracePlayer::~TracePlayer() { delete[] edram_snapshot_; }
 
 const TraceReader::Frame* TracePlayer::current_frame() const {
-  if (current_frame_index_ >= frame_count()) {
+  if (current_frame_index_ < 0 || current_frame_index_ >= frame_count()) {
     return nullptr;
   }
   return frame(current_frame_index_);
@@ -48,10 +55,12 @@ void TracePlayer::SeekFrame(int target_frame) {
   current_frame_index_ = target_frame;
   auto frame = current_frame();
   current_command_index_ = int(frame->commands.size()) - 1;
+  // Stepping through frames in order is the common case.
+  PrefetchFrame(target_frame + 1);
 
   assert_true(frame->start_ptr <= frame->end_ptr);
   PlayTrace(frame->start_ptr, frame->end_ptr - frame->start_ptr,
-            TracePlaybackMode::kBreakOnSwap, false);
+            TracePlaybackMode::kBreakOnSwap, false, frame, 0);
 }
 
 void TracePlayer::SeekCommand(int target_command) {
@@ -71,12 +80,43 @@ void TracePlayer::SeekCommand(int target_command) {
     const auto& previous_command = frame->commands[previous_command_index];
     PlayTrace(previous_command.end_ptr,
               command.end_ptr - previous_command.end_ptr,
-              TracePlaybackMode::kBreakOnSwap, false);
+              TracePlaybackMode::kBreakOnSwap, false, frame,
+              previous_command_index + 1);
   } else {
-    // Full playback from frame start.
-    PlayTrace(frame->start_ptr, command.end_ptr - frame->start_ptr,
-              TracePlaybackMode::kBreakOnSwap, true);
+    // Playback from the nearest checkpoint, or from frame start if there's
+    // none. Checkpoints are owned by the command processor thread, so the
+    // choice is made there.
+    playing_trace_ = true;
+    graphics_system_->command_processor()->CallInThread(
+        [this, frame, target_command]() {
+          const uint8_t* end_ptr = frame->commands[target_command].end_ptr;
+          const Checkpoint* checkpoint =
+              RestoreCheckpoint(frame, target_command);
+          if (checkpoint) {
+            const uint8_t* start_ptr =
+                frame->commands[checkpoint->command_index].end_ptr;
+            PlayTraceOnThread(start_ptr, end_ptr - start_ptr,
+                              TracePlaybackMode::kBreakOnSwap, false, frame,
+                              checkpoint->command_index + 1);
+          } else {
+            PlayTraceOnThread(frame->start_ptr, end_ptr - frame->start_ptr,
+                              TracePlaybackMode::kBreakOnSwap, true, frame, 0);
+          }
+        });
+  }
+}
+
+void TracePlayer::PlayAll(bool clear_caches) {
+  if (!frame_count()) {
+    return;
   }
+  const uint8_t* start_ptr = frame(0)->start_ptr;
+  const uint8_t* end_ptr = frame(frame_count() - 1)->end_ptr;
+  // Not positioned within any single frame afterwards.
+  current_frame_index_ = -1;
+  current_command_index_ = -1;
+  PlayTrace(start_ptr, end_ptr - start_ptr, TracePlaybackMode::kUntilEnd,
+            clear_caches, nullptr, -1);
 }
 
 void TracePlayer::WaitOnPlayback() {
@@ -84,18 +124,20 @@ void TracePlayer::WaitOnPlayback() {
 }
 
 void TracePlayer::PlayTrace(const uint8_t* trace_data, size_t trace_size,
-                            TracePlaybackMode playback_mode,
-                            bool clear_caches) {
+                            TracePlaybackMode playback_mode, bool clear_caches,
+                            const Frame* frame, int first_command_index) {
   playing_trace_ = true;
   graphics_system_->command_processor()->CallInThread([=]() {
-    PlayTraceOnThread(trace_data, trace_size, playback_mode, clear_caches);
+    PlayTraceOnThread(trace_data, trace_size, playback_mode, clear_caches,
+                      frame, first_command_index);
   });
 }
 
 void TracePlayer::PlayTraceOnThread(const uint8_t* trace_data,
                                     size_t trace_size,
                                     TracePlaybackMode playback_mode,
-                                    bool clear_caches) {
+                                    bool clear_caches, const Frame* frame,
+                                    int first_command_index) {
   auto memory = graphics_system_->memory();
   auto command_processor = graphics_system_->command_processor();
 
@@ -103,8 +145,17 @@ void TracePlayer::PlayTraceOnThread(const uint8_t* trace_data,
     command_processor->ClearCaches();
   }
 
+  // Checkpoints are only valid for continuous playback of a single frame.
+  if (first_command_index <= 0 || frame != checkpoint_frame_) {
+    checkpoints_.clear();
+  }
+  checkpoint_frame_ = first_command_index >= 0 ? frame : nullptr;
+  int next_command_index = first_command_index;
+  int checkpoint_interval = cvars::trace_playback_checkpoint_interval;
+
   command_processor->set_swap_mode(SwapMode::kIgnored);
   playback_percent_ = 0;
+  playback_stats_ = PlaybackStats();
   auto trace_end = trace_data + trace_size;
 
   playing_trace_ = true;
@@ -147,6 +198,7 @@ void TracePlayer::PlayTraceOnThread(const uint8_t* trace_data,
       case TraceCommandType::kPacketStart: {
         auto cmd = reinterpret_cast<const PacketStartCommand*>(trace_ptr);
         trace_ptr += sizeof(*cmd);
+        SaveCheckpointPages(cmd->base_ptr, cmd->count * 4);
         std::memcpy(memory->TranslatePhysical(cmd->base_ptr), trace_ptr,
                     cmd->count * 4);
         trace_ptr += cmd->count * 4;
@@ -160,9 +212,11 @@ void TracePlayer::PlayTraceOnThread(const uint8_t* trace_data,
           command_processor->ExecutePacket(pending_packet->base_ptr,
                                            pending_packet->count);
           pending_packet = nullptr;
+          ++playback_stats_.packet_count;
         }
         if (pending_break) {
           playing_trace_ = false;
+          playback_event_->Set();
           return;
         }
         break;
@@ -170,12 +224,30 @@ void TracePlayer::PlayTraceOnThread(const uint8_t* trace_data,
       case TraceCommandType::kMemoryRead: {
         auto cmd = reinterpret_cast<const MemoryCommand*>(trace_ptr);
         trace_ptr += sizeof(*cmd);
-        DecompressMemory(cmd->encoding_format, trace_ptr, cmd->encoded_length,
-                         memory->TranslatePhysical(cmd->base_ptr),
-                         cmd->decoded_length);
+        SaveCheckpointPages(cmd->base_ptr, cmd->decoded_length);
+        DecompressMemoryCommand(cmd, memory->TranslatePhysical(cmd->base_ptr));
         trace_ptr += cmd->encoded_length;
         command_processor->TracePlaybackWroteMemory(cmd->base_ptr,
                                                     cmd->decoded_length);
+        ++playback_stats_.memory_read_count;
+        playback_stats_.memory_read_bytes += cmd->decoded_length;
+        break;
+      }
+      case TraceCommandType::kMemoryReadReference: {
+        auto cmd =
+            reinterpret_cast<const MemoryReadReferenceCommand*>(trace_ptr);
+        trace_ptr += sizeof(*cmd);
+        auto source_cmd = GetMemoryReadSource(cmd);
+        if (!source_cmd) {
+          break;
+        }
+        SaveCheckpointPages(cmd->base_ptr, cmd->decoded_length);
+        DecompressMemoryCommand(source_cmd,
+                                memory->TranslatePhysical(cmd->base_ptr));
+        command_processor->TracePlaybackWroteMemory(cmd->base_ptr,
+                                                    cmd->decoded_length);
+        ++playback_stats_.memory_read_count;
+        playback_stats_.memory_read_bytes += cmd->decoded_length;
         break;
       }
       case TraceCommandType::kMemoryWrite: {
@@ -189,7 +261,6 @@ void TracePlayer::PlayTraceOnThread(const uint8_t* trace_data,
       case TraceCommandType::kEDRAMSnapshot: {
         auto cmd = reinterpret_cast<const EDRAMSnapshotCommand*>(trace_ptr);
         trace_ptr += sizeof(*cmd);
-        const size_t kEDRAMSize = 10 * 1024 * 1024;
         if (!edram_snapshot_) {
           edram_snapshot_ = new uint8_t[kEDRAMSize];
         }
@@ -213,6 +284,16 @@ void TracePlayer::PlayTraceOnThread(const uint8_t* trace_data,
         break;
       }
     }
+
+    if (next_command_index >= 0 &&
+        next_command_index < int(frame->commands.size()) &&
+        trace_ptr == frame->commands[next_command_index].end_ptr) {
+      if (checkpoint_interval > 0 &&
+          (next_command_index + 1) % checkpoint_interval == 0) {
+        CaptureCheckpoint(next_command_index);
+      }
+      ++next_command_index;
+    }
   }
 
   playing_trace_ = false;
@@ -222,5 +303,90 @@ void TracePlayer::PlayTraceOnThread(const uint8_t* trace_data,
   playback_event_->Set();
 }
 
+void TracePlayer::CaptureCheckpoint(int command_index) {
+  auto command_processor = graphics_system_->command_processor();
+  auto register_file = graphics_system_->register_file();
+
+  auto checkpoint = std::make_unique<Checkpoint>();
+  checkpoint->command_index = command_index;
+  checkpoint->registers = std::make_unique<RegisterFile::RegisterValue[]>(
+      RegisterFile::kRegisterCount);
+  std::memcpy(checkpoint->registers.get(), register_file->values,
+              sizeof(register_file->values));
+  command_processor->SavePlaybackCheckpoint(
+      &checkpoint->command_processor_state);
+  if (edram_capture_supported_) {
+    auto edram_snapshot = std::make_unique<uint8_t[]>(kEDRAMSize);
+    if (command_processor->CaptureEDRAMSnapshot(edram_snapshot.get())) {
+      checkpoint->edram_snapshot = std::move(edram_snapshot);
+    } else {
+      edram_capture_supported_ = false;
+    }
+  }
+  checkpoints_.push_back(std::move(checkpoint));
+}
+
+const TracePlayer::Checkpoint* TracePlayer::RestoreCheckpoint(
+    const Frame* frame, int command_index) {
+  if (frame != checkpoint_frame_) {
+    return nullptr;
+  }
+  size_t checkpoint_count = checkpoints_.size();
+  while (checkpoint_count &&
+         checkpoints_[checkpoint_count - 1]->command_index > command_index) {
+    --checkpoint_count;
+  }
+  if (!checkpoint_count) {
+    return nullptr;
+  }
+
+  auto memory = graphics_system_->memory();
+  auto command_processor = graphics_system_->command_processor();
+
+  // Undo the memory writes from the newest checkpoint backwards, so that pages
+  // written in multiple intervals end up with their oldest saved contents.
+  for (size_t i = checkpoints_.size(); i >= checkpoint_count; --i) {
+    for (auto& saved_page : checkpoints_[i - 1]->saved_pages) {
+      uint32_t page_address = saved_page.first << kCheckpointPageSizeLog2;
+      std::memcpy(memory->TranslatePhysical(page_address),
+                  saved_page.second.get(), kCheckpointPageSize);
+      command_processor->TracePlaybackWroteMemory(page_address,
+                                                  kCheckpointPageSize);
+    }
+  }
+  checkpoints_.resize(checkpoint_count);
+
+  Checkpoint* checkpoint = checkpoints_.back().get();
+  checkpoint->saved_pages.clear();
+  auto register_file = graphics_system_->register_file();
+  std::memcpy(register_file->values, checkpoint->registers.get(),
+              sizeof(register_file->values));
+  command_processor->RestorePlaybackCheckpoint(
+      checkpoint->command_processor_state);
+  if (checkpoint->edram_snapshot) {
+    command_processor->RestoreEDRAMSnapshot(checkpoint->edram_snapshot.get());
+  }
+  return checkpoint;
+}
+
+void TracePlayer::SaveCheckpointPages(uint32_t base_ptr, uint32_t length) {
+  if (checkpoints_.empty() || !length) {
+    return;
+  }
+  auto memory = graphics_system_->memory();
+  auto& saved_pages = checkpoints_.back()->saved_pages;
+  uint32_t first_page = base_ptr >> kCheckpointPageSizeLog2;
+  uint32_t last_page = (base_ptr + length - 1) >> kCheckpointPageSizeLog2;
+  for (uint32_t page = first_page; page <= last_page; ++page) {
+    auto& saved_page = saved_pages[page];
+    if (!saved_page) {
+      saved_page = std::make_unique<uint8_t[]>(kCheckpointPageSize);
+      std::memcpy(saved_page.get(),
+                  memory->TranslatePhysical(page << kCheckpointPageSizeLog2),
+                  kCheckpointPageSize);
+    }
+  }
+}
+
 }  // namespace gpu
 }  // namespace xe
@@ -11,9 +11,14 @@
 #define XENIA_GPU_TRACE_PLAYER_H_
 
 #include <atomic>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "xenia/base/threading.h"
+#include "xenia/gpu/command_processor.h"
+#include "xenia/gpu/register_file.h"
 #include "xenia/gpu/trace_protocol.h"
 #include "xenia/gpu/trace_reader.h"
 #include "xenia/ui/loop.h"
@@ -43,16 +48,53 @@ class TracePlayer : public TraceReader {
   // Scalar from 0-10000
   uint32_t playback_percent() const { return playback_percent_; }
 
+  // Counts of the trace commands replayed by the last playback. Only valid
+  // once it has finished.
+  struct PlaybackStats {
+    uint64_t packet_count = 0;
+    uint64_t memory_read_count = 0;
+    uint64_t memory_read_bytes = 0;
+  };
+  const PlaybackStats& playback_stats() const { return playback_stats_; }
+
   void SeekFrame(int target_frame);
   void SeekCommand(int target_command);
+  // Plays all frames of the trace without breaking on swaps.
+  void PlayAll(bool clear_caches);
 
   void WaitOnPlayback();
 
  private:
+  // Playback state right after a command of the current frame, recorded every
+  // --trace_playback_checkpoint_interval draws so that seeking backwards only
+  // needs to replay the commands after the nearest checkpoint.
+  struct Checkpoint {
+    int command_index;
+    std::unique_ptr<RegisterFile::RegisterValue[]> registers;
+    CommandProcessor::PlaybackCheckpointState command_processor_state;
+    // Null if the backend can't capture the EDRAM.
+    std::unique_ptr<uint8_t[]> edram_snapshot;
+    // Contents at this checkpoint of the guest memory pages overwritten by
+    // playback until the next checkpoint, by page index.
+    std::unordered_map<uint32_t, std::unique_ptr<uint8_t[]>> saved_pages;
+  };
+
+  // first_command_index is the index in frame of the first command played, or
+  // -1 if the playback isn't within a single frame.
   void PlayTrace(const uint8_t* trace_data, size_t trace_size,
-                 TracePlaybackMode playback_mode, bool clear_caches);
+                 TracePlaybackMode playback_mode, bool clear_caches,
+                 const Frame* frame, int first_command_index);
   void PlayTraceOnThread(const uint8_t* trace_data, size_t trace_size,
-                         TracePlaybackMode playback_mode, bool clear_caches);
+                         TracePlaybackMode playback_mode, bool clear_caches,
+                         const Frame* frame, int first_command_index);
+
+  // Checkpoints are only accessed on the command processor thread.
+  void CaptureCheckpoint(int command_index);
+  // Restores the last checkpoint at or before the command of the frame and
+  // discards the ones after it. Returns nullptr if there's no such checkpoint.
+  const Checkpoint* RestoreCheckpoint(const Frame* frame, int command_index);
+  // Saves the current contents of the pages about to be written by playback.
+  void SaveCheckpointPages(uint32_t base_ptr, uint32_t length);
 
   xe::ui::Loop* loop_;
   GraphicsSystem* graphics_system_;
@@ -60,8 +102,13 @@ class TracePlayer : public TraceReader {
   int current_command_index_;
   bool playing_trace_ = false;
   std::atomic<uint32_t> playback_percent_ = {0};
+  PlaybackStats playback_stats_;
   std::unique_ptr<xe::threading::Event> playback_event_;
   uint8_t* edram_snapshot_ = nullptr;
+
+  const Frame* checkpoint_frame_ = nullptr;
+  std::vector<std::unique_ptr<Checkpoint>> checkpoints_;
+  bool edram_capture_supported_ = true;
 };
 
 }  // namespace gpu
@@ -23,7 +23,11 @@ static const char kTraceExtension[] = "xtr";
 // Other changes besides the file format may require bumps, such as
 // anything that changes what is recorded into the files (new GPU
 // command processor commands, etc).
-constexpr uint32_t kTraceFormatVersion = 1;
+constexpr uint32_t kTraceFormatVersion = 3;
+// Older versions that can still be read. Version 1 has no frame index, and
+// versions before 3 have no memory read references.
+constexpr uint32_t kTraceFormatMinVersion = 1;
+constexpr uint32_t kTraceFormatIndexVersion = 2;
 
 // Trace file header identifying information about the trace.
 // This must be positioned at the start of the file and must only occur once.
@@ -53,6 +57,7 @@ enum class TraceCommandType : uint32_t {
   kMemoryWrite,
   kEDRAMSnapshot,
   kEvent,
+  kMemoryReadReference,
 };
 
 struct PrimaryBufferStartCommand {
@@ -111,6 +116,23 @@ struct MemoryCommand {
   uint32_t decoded_length;
 };
 
+// Represents the GPU reading data from memory that has the same contents as an
+// earlier kMemoryRead in the trace, which is referenced instead of storing the
+// data again. Matched by a hash of the contents anywhere in the trace, not by
+// the address.
+struct MemoryReadReferenceCommand {
+  TraceCommandType type;
+
+  // Base physical memory pointer this read starts at.
+  uint32_t base_ptr;
+  // Number of bytes read, equal to decoded_length of the source command.
+  uint32_t decoded_length;
+  uint32_t reserved;
+  // File offset of the kMemoryRead MemoryCommand holding the data.
+  uint64_t source_offset;
+};
+static_assert(sizeof(MemoryReadReferenceCommand) == 24, "Must be fixed size");
+
 // Represents a full 10 MB snapshot of EDRAM contents, for trace initialization
 // (since replaying the trace will reconstruct its state at any point later) as
 // a sequence of tiles with row-major samples (2x multisampling as 1x2 samples,
@@ -134,6 +156,24 @@ struct EventCommand {
   Type event_type;
 };
 
+// Frame index written at the end of the file when the trace is closed, so that
+// readers don't need to walk the whole file to find the frames. The index is
+// TraceFooter::frame_count uint64_t file offsets of the end of each frame (the
+// first frame starts right after the TraceHeader), followed by the footer,
+// which is always the last bytes of the file. Traces that weren't closed
+// properly (such as interrupted streaming traces) have no index and are
+// scanned instead.
+constexpr uint32_t kTraceFooterMagic = 'XTRI';
+
+struct TraceFooter {
+  // Set to kTraceFooterMagic.
+  uint32_t magic;
+  uint32_t frame_count;
+  // File offset of the index, which is also the end of the last frame.
+  uint64_t index_offset;
+};
+static_assert(sizeof(TraceFooter) == 16, "Must be fixed size");
+
 }  // namespace gpu
 }  // namespace xe
 
@@ -10,19 +10,44 @@
 #include "xenia/gpu/trace_reader.h"
 
 #include <cinttypes>
+#include <cstring>
+#include <unordered_set>
 
 #include "third_party/snappy/snappy.h"
 #include "xenia/base/filesystem.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/mapped_memory.h"
 #include "xenia/base/math.h"
+#include "xenia/base/threading.h"
 #include "xenia/gpu/packet_disassembler.h"
+#include "xenia/gpu/texture_conversion.h"
 #include "xenia/gpu/trace_protocol.h"
 #include "xenia/memory.h"
 
 namespace xe {
 namespace gpu {
 
+namespace {
+
+// Only snappy-encoded memory commands are decompressed ahead of time, and only
+// up to this many decoded bytes per frame.
+constexpr size_t kMaxPrefetchBytesPerFrame = 256 * 1024 * 1024;
+// The frame being played and the next one.
+constexpr size_t kMaxPrefetchedFrames = 2;
+
+}  // namespace
+
+TraceReader::~TraceReader() { StopPrefetch(); }
+
+const TraceReader::Frame* TraceReader::frame(int n) const {
+  std::lock_guard<std::mutex> lock(frames_mutex_);
+  Frame* frame = &frames_[n];
+  if (!frame->parsed) {
+    ParseFrame(frame);
+  }
+  return frame;
+}
+
 bool TraceReader::Open(const std::filesystem::path& path) {
   Close();
 
@@ -33,15 +58,22 @@ bool TraceReader::Open(const std::filesystem::path& path) {
 
   trace_data_ = reinterpret_cast<const uint8_t*>(mmap_->data());
   trace_size_ = mmap_->size();
+  if (trace_size_ < sizeof(TraceHeader)) {
+    XELOGE("Trace file {} is too small", xe::path_to_utf8(path));
+    Close();
+    return false;
+  }
 
   // Verify version.
   auto header = reinterpret_cast<const TraceHeader*>(trace_data_);
-  if (header->version != kTraceFormatVersion) {
+  if (header->version < kTraceFormatMinVersion ||
+      header->version > kTraceFormatVersion) {
     XELOGE("Trace format version mismatch, code has {}, file has {}",
            kTraceFormatVersion, header->version);
-    if (header->version < kTraceFormatVersion) {
+    if (header->version < kTraceFormatMinVersion) {
       XELOGE("You need to regenerate your trace for the latest version");
     }
+    Close();
     return false;
   }
 
@@ -52,51 +84,169 @@ bool TraceReader::Open(const std::filesystem::path& path) {
   XELOGI("    Commit: {}", commit_str);
   XELOGI("  Title ID: {}", header->title_id);
 
-  ParseTrace();
+  if (header->version < kTraceFormatIndexVersion) {
+    ScanFrames();
+  } else if (!ReadFrameIndex()) {
+    XELOGW("Trace has no frame index, scanning the whole file");
+    ScanFrames();
+  }
+  XELOGI("    Frames: {}", frames_.size());
 
   return true;
 }
 
 void TraceReader::Close() {
+  StopPrefetch();
+  frames_.clear();
   mmap_.reset();
   trace_data_ = nullptr;
   trace_size_ = 0;
+  trace_end_ = nullptr;
+}
+
+bool TraceReader::ReadFrameIndex() {
+  if (trace_size_ < sizeof(TraceHeader) + sizeof(TraceFooter)) {
+    return false;
+  }
+  TraceFooter footer;
+  std::memcpy(&footer, trace_data_ + trace_size_ - sizeof(footer),
+              sizeof(footer));
+  if (footer.magic != kTraceFooterMagic ||
+      footer.index_offset < sizeof(TraceHeader) ||
+      footer.index_offset + uint64_t(footer.frame_count) * sizeof(uint64_t) +
+              sizeof(footer) !=
+          trace_size_) {
+    return false;
+  }
+
+  std::vector<Frame> frames(footer.frame_count);
+  uint64_t frame_start = sizeof(TraceHeader);
+  const uint8_t* index_ptr = trace_data_ + footer.index_offset;
+  for (uint32_t i = 0; i < footer.frame_count; ++i) {
+    uint64_t frame_end;
+    std::memcpy(&frame_end, index_ptr + i * sizeof(uint64_t),
+                sizeof(frame_end));
+    if (frame_end < frame_start || frame_end > footer.index_offset) {
+      XELOGW("Trace frame index is corrupted");
+      return false;
+    }
+    frames[i].start_ptr = trace_data_ + frame_start;
+    frames[i].end_ptr = trace_data_ + frame_end;
+    frame_start = frame_end;
+  }
+
+  frames_ = std::move(frames);
+  trace_end_ = trace_data_ + footer.index_offset;
+  return true;
 }
 
-void TraceReader::ParseTrace() {
-  // Skip file header.
-  auto trace_ptr = trace_data_;
-  trace_ptr += sizeof(TraceHeader);
+size_t TraceReader::GetCommandSize(const uint8_t* trace_ptr) {
+  auto type = static_cast<TraceCommandType>(xe::load<uint32_t>(trace_ptr));
+  switch (type) {
+    case TraceCommandType::kPrimaryBufferStart: {
+      auto cmd = reinterpret_cast<const PrimaryBufferStartCommand*>(trace_ptr);
+      return sizeof(*cmd) + cmd->count * 4;
+    }
+    case TraceCommandType::kPrimaryBufferEnd:
+      return sizeof(PrimaryBufferEndCommand);
+    case TraceCommandType::kIndirectBufferStart: {
+      auto cmd = reinterpret_cast<const IndirectBufferStartCommand*>(trace_ptr);
+      return sizeof(*cmd) + cmd->count * 4;
+    }
+    case TraceCommandType::kIndirectBufferEnd:
+      return sizeof(IndirectBufferEndCommand);
+    case TraceCommandType::kPacketStart: {
+      auto cmd = reinterpret_cast<const PacketStartCommand*>(trace_ptr);
+      return sizeof(*cmd) + cmd->count * 4;
+    }
+    case TraceCommandType::kPacketEnd:
+      return sizeof(PacketEndCommand);
+    case TraceCommandType::kMemoryRead:
+    case TraceCommandType::kMemoryWrite: {
+      auto cmd = reinterpret_cast<const MemoryCommand*>(trace_ptr);
+      return sizeof(*cmd) + cmd->encoded_length;
+    }
+    case TraceCommandType::kEDRAMSnapshot: {
+      auto cmd = reinterpret_cast<const EDRAMSnapshotCommand*>(trace_ptr);
+      return sizeof(*cmd) + cmd->encoded_length;
+    }
+    case TraceCommandType::kEvent:
+      return sizeof(EventCommand);
+    case TraceCommandType::kMemoryReadReference:
+      return sizeof(MemoryReadReferenceCommand);
+    default:
+      // Broken trace file?
+      assert_unhandled_case(type);
+      return 0;
+  }
+}
+
+void TraceReader::ScanFrames() {
+  // Only finds the frame bounds, the commands are parsed by ParseFrame.
+  auto trace_ptr = trace_data_ + sizeof(TraceHeader);
+  trace_end_ = trace_data_ + trace_size_;
 
   Frame current_frame;
   current_frame.start_ptr = trace_ptr;
+  bool frame_empty = true;
+  bool pending_break = false;
+  while (trace_ptr < trace_end_) {
+    frame_empty = false;
+    auto type = static_cast<TraceCommandType>(xe::load<uint32_t>(trace_ptr));
+    size_t command_size = GetCommandSize(trace_ptr);
+    if (!command_size) {
+      break;
+    }
+    trace_ptr += command_size;
+    switch (type) {
+      case TraceCommandType::kIndirectBufferEnd:
+        // IB packet is wrapped in a kPacketStart/kPacketEnd. Skip the end.
+        trace_ptr += sizeof(PacketEndCommand);
+        break;
+      case TraceCommandType::kPacketEnd:
+        if (pending_break) {
+          current_frame.end_ptr = trace_ptr;
+          frames_.push_back(std::move(current_frame));
+          current_frame = Frame();
+          current_frame.start_ptr = trace_ptr;
+          frame_empty = true;
+          pending_break = false;
+        }
+        break;
+      case TraceCommandType::kEvent: {
+        auto cmd = reinterpret_cast<const EventCommand*>(
+            trace_ptr - sizeof(EventCommand));
+        if (cmd->event_type == EventCommand::Type::kSwap) {
+          pending_break = true;
+        }
+        break;
+      }
+      default:
+        break;
+    }
+  }
+  if (pending_break || !frame_empty) {
+    current_frame.end_ptr = trace_ptr;
+    frames_.push_back(std::move(current_frame));
+  }
+}
+
+void TraceReader::ParseFrame(Frame* frame) const {
+  auto trace_ptr = frame->start_ptr;
   const PacketStartCommand* packet_start = nullptr;
   const uint8_t* packet_start_ptr = nullptr;
   const uint8_t* last_ptr = trace_ptr;
-  bool pending_break = false;
   auto current_command_buffer = new CommandBuffer();
-  current_frame.command_tree =
-      std::unique_ptr<CommandBuffer>(current_command_buffer);
+  frame->command_tree = std::unique_ptr<CommandBuffer>(current_command_buffer);
+  frame->command_count = 0;
+  frame->parsed = true;
 
-  while (trace_ptr < trace_data_ + trace_size_) {
-    ++current_frame.command_count;
+  while (trace_ptr < frame->end_ptr) {
+    ++frame->command_count;
     auto type = static_cast<TraceCommandType>(xe::load<uint32_t>(trace_ptr));
     switch (type) {
-      case TraceCommandType::kPrimaryBufferStart: {
-        auto cmd =
-            reinterpret_cast<const PrimaryBufferStartCommand*>(trace_ptr);
-        trace_ptr += sizeof(*cmd) + cmd->count * 4;
-        break;
-      }
-      case TraceCommandType::kPrimaryBufferEnd: {
-        auto cmd = reinterpret_cast<const PrimaryBufferEndCommand*>(trace_ptr);
-        trace_ptr += sizeof(*cmd);
-        break;
-      }
       case TraceCommandType::kIndirectBufferStart: {
-        auto cmd =
-            reinterpret_cast<const IndirectBufferStartCommand*>(trace_ptr);
-        trace_ptr += sizeof(*cmd) + cmd->count * 4;
+        trace_ptr += GetCommandSize(trace_ptr);
 
         // Traverse down a level.
         auto sub_command_buffer = new CommandBuffer();
@@ -113,7 +263,7 @@ void TraceReader::ParseTrace() {
         // IB packet is wrapped in a kPacketStart/kPacketEnd. Skip the end.
         auto end_cmd = reinterpret_cast<const PacketEndCommand*>(trace_ptr);
         assert_true(end_cmd->type == TraceCommandType::kPacketEnd);
-        trace_ptr += sizeof(*cmd);
+        trace_ptr += sizeof(*end_cmd);
 
         // Go back up a level. If parent is null, this frame started in an
         // indirect buffer.
@@ -135,86 +285,196 @@ void TraceReader::ParseTrace() {
         if (!packet_start_ptr) {
           continue;
         }
+        Frame::Command command;
         auto packet_category = PacketDisassembler::GetPacketCategory(
             packet_start_ptr + sizeof(*packet_start));
         switch (packet_category) {
-          case PacketCategory::kDraw: {
-            Frame::Command command;
+          case PacketCategory::kDraw:
             command.type = Frame::Command::Type::kDraw;
-            command.head_ptr = packet_start_ptr;
-            command.start_ptr = last_ptr;
-            command.end_ptr = trace_ptr;
-            current_frame.commands.push_back(std::move(command));
-            last_ptr = trace_ptr;
-            current_command_buffer->commands.push_back(CommandBuffer::Command(
-                uint32_t(current_frame.commands.size() - 1)));
             break;
-          }
-          case PacketCategory::kSwap: {
-            Frame::Command command;
+          case PacketCategory::kSwap:
             command.type = Frame::Command::Type::kSwap;
-            command.head_ptr = packet_start_ptr;
-            command.start_ptr = last_ptr;
-            command.end_ptr = trace_ptr;
-            current_frame.commands.push_back(std::move(command));
-            last_ptr = trace_ptr;
-            current_command_buffer->commands.push_back(CommandBuffer::Command(
-                uint32_t(current_frame.commands.size() - 1)));
-          } break;
-          case PacketCategory::kGeneric: {
-            // Ignored.
             break;
-          }
-        }
-        if (pending_break) {
-          current_frame.end_ptr = trace_ptr;
-          frames_.push_back(std::move(current_frame));
-          current_command_buffer = new CommandBuffer();
-          current_frame.command_tree =
-              std::unique_ptr<CommandBuffer>(current_command_buffer);
-          current_frame.start_ptr = trace_ptr;
-          current_frame.end_ptr = nullptr;
-          current_frame.command_count = 0;
-          pending_break = false;
+          case PacketCategory::kGeneric:
+            // Ignored.
+            continue;
         }
+        command.head_ptr = packet_start_ptr;
+        command.start_ptr = last_ptr;
+        command.end_ptr = trace_ptr;
+        frame->commands.push_back(std::move(command));
+        last_ptr = trace_ptr;
+        current_command_buffer->commands.push_back(
+            CommandBuffer::Command(uint32_t(frame->commands.size() - 1)));
         break;
       }
-      case TraceCommandType::kMemoryRead: {
-        auto cmd = reinterpret_cast<const MemoryCommand*>(trace_ptr);
-        trace_ptr += sizeof(*cmd) + cmd->encoded_length;
+      default: {
+        size_t command_size = GetCommandSize(trace_ptr);
+        if (!command_size) {
+          return;
+        }
+        trace_ptr += command_size;
         break;
       }
-      case TraceCommandType::kMemoryWrite: {
-        auto cmd = reinterpret_cast<const MemoryCommand*>(trace_ptr);
-        trace_ptr += sizeof(*cmd) + cmd->encoded_length;
+    }
+  }
+}
+
+void TraceReader::PrefetchFrame(int n) {
+  if (n < 0 || n >= frame_count()) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(prefetch_mutex_);
+  if (!prefetch_thread_.joinable()) {
+    prefetch_shutdown_ = false;
+    prefetch_thread_ = std::thread([this]() {
+      xe::threading::set_name("Trace Prefetch");
+      PrefetchThread();
+    });
+  }
+  prefetch_requested_frame_ = n;
+  prefetch_cond_.notify_one();
+}
+
+void TraceReader::StopPrefetch() {
+  {
+    std::lock_guard<std::mutex> lock(prefetch_mutex_);
+    if (!prefetch_thread_.joinable()) {
+      return;
+    }
+    prefetch_shutdown_ = true;
+    prefetch_cond_.notify_one();
+  }
+  // Also shuts down the conversion thread pool owned by the prefetch thread.
+  prefetch_thread_.join();
+  prefetched_frames_.clear();
+  prefetch_requested_frame_ = -1;
+}
+
+void TraceReader::PrefetchThread() {
+  // Leave the other half of the cores to the command processor and the host
+  // GPU driver.
+  texture_conversion::ConversionThreadPool thread_pool(
+      xe::threading::logical_processor_count() / 2);
+
+  while (true) {
+    int frame_index;
+    {
+      std::unique_lock<std::mutex> lock(prefetch_mutex_);
+      prefetch_cond_.wait(lock, [this]() {
+        return prefetch_shutdown_ || prefetch_requested_frame_ >= 0;
+      });
+      if (prefetch_shutdown_) {
         break;
       }
-      case TraceCommandType::kEDRAMSnapshot: {
-        auto cmd = reinterpret_cast<const EDRAMSnapshotCommand*>(trace_ptr);
-        trace_ptr += sizeof(*cmd) + cmd->encoded_length;
+      frame_index = prefetch_requested_frame_;
+      prefetch_requested_frame_ = -1;
+      bool already_prefetched = false;
+      for (const PrefetchedFrame& prefetched_frame : prefetched_frames_) {
+        if (prefetched_frame.index == frame_index) {
+          already_prefetched = true;
+          break;
+        }
+      }
+      if (already_prefetched) {
+        continue;
+      }
+    }
+
+    // Frame bounds don't change while the trace is open, only the commands are
+    // parsed lazily.
+    const uint8_t* trace_ptr = frames_[frame_index].start_ptr;
+    const uint8_t* end_ptr = frames_[frame_index].end_ptr;
+    std::vector<const MemoryCommand*> commands;
+    std::unordered_set<const MemoryCommand*> command_set;
+    size_t total_size = 0;
+    while (trace_ptr < end_ptr) {
+      auto type = static_cast<TraceCommandType>(xe::load<uint32_t>(trace_ptr));
+      size_t command_size = GetCommandSize(trace_ptr);
+      if (!command_size) {
         break;
       }
-      case TraceCommandType::kEvent: {
-        auto cmd = reinterpret_cast<const EventCommand*>(trace_ptr);
-        trace_ptr += sizeof(*cmd);
-        switch (cmd->event_type) {
-          case EventCommand::Type::kSwap: {
-            pending_break = true;
-            break;
-          }
+      const MemoryCommand* cmd = nullptr;
+      if (type == TraceCommandType::kMemoryRead) {
+        cmd = reinterpret_cast<const MemoryCommand*>(trace_ptr);
+      } else if (type == TraceCommandType::kMemoryReadReference) {
+        // The same data may be referenced many times in a frame.
+        cmd = GetMemoryReadSource(
+            reinterpret_cast<const MemoryReadReferenceCommand*>(trace_ptr));
+        if (cmd && !command_set.insert(cmd).second) {
+          cmd = nullptr;
         }
-        break;
       }
-      default:
-        // Broken trace file?
-        assert_unhandled_case(type);
-        break;
+      if (cmd && cmd->encoding_format == MemoryEncodingFormat::kSnappy) {
+        if (total_size + cmd->decoded_length > kMaxPrefetchBytesPerFrame) {
+          break;
+        }
+        commands.push_back(cmd);
+        total_size += cmd->decoded_length;
+      }
+      trace_ptr += command_size;
     }
+
+    PrefetchedFrame prefetched_frame;
+    prefetched_frame.index = frame_index;
+    std::vector<std::unique_ptr<uint8_t[]>> buffers(commands.size());
+    thread_pool.Run(uint32_t(commands.size()), [&](uint32_t i) {
+      const MemoryCommand* cmd = commands[i];
+      auto buffer = std::make_unique<uint8_t[]>(cmd->decoded_length);
+      if (DecompressMemory(cmd->encoding_format,
+                           reinterpret_cast<const uint8_t*>(cmd + 1),
+                           cmd->encoded_length, buffer.get(),
+                           cmd->decoded_length)) {
+        buffers[i] = std::move(buffer);
+      }
+    });
+    for (size_t i = 0; i < commands.size(); ++i) {
+      if (buffers[i]) {
+        prefetched_frame.memory.emplace(commands[i], std::move(buffers[i]));
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(prefetch_mutex_);
+    if (prefetched_frames_.size() >= kMaxPrefetchedFrames) {
+      prefetched_frames_.erase(prefetched_frames_.begin());
+    }
+    prefetched_frames_.push_back(std::move(prefetched_frame));
   }
-  if (pending_break || current_frame.command_count) {
-    current_frame.end_ptr = trace_ptr;
-    frames_.push_back(std::move(current_frame));
+}
+
+const MemoryCommand* TraceReader::GetMemoryReadSource(
+    const MemoryReadReferenceCommand* cmd) const {
+  if (cmd->source_offset < sizeof(TraceHeader) ||
+      cmd->source_offset + sizeof(MemoryCommand) >
+          uint64_t(trace_end_ - trace_data_)) {
+    assert_always("Invalid memory read reference");
+    return nullptr;
+  }
+  auto source_cmd =
+      reinterpret_cast<const MemoryCommand*>(trace_data_ + cmd->source_offset);
+  if (source_cmd->type != TraceCommandType::kMemoryRead ||
+      source_cmd->decoded_length != cmd->decoded_length) {
+    assert_always("Invalid memory read reference");
+    return nullptr;
+  }
+  return source_cmd;
+}
+
+bool TraceReader::DecompressMemoryCommand(const MemoryCommand* cmd,
+                                          uint8_t* dest) {
+  {
+    std::lock_guard<std::mutex> lock(prefetch_mutex_);
+    for (const PrefetchedFrame& prefetched_frame : prefetched_frames_) {
+      auto it = prefetched_frame.memory.find(cmd);
+      if (it != prefetched_frame.memory.end()) {
+        std::memcpy(dest, it->second.get(), cmd->decoded_length);
+        return true;
+      }
+    }
   }
+  return DecompressMemory(cmd->encoding_format,
+                          reinterpret_cast<const uint8_t*>(cmd + 1),
+                          cmd->encoded_length, dest, cmd->decoded_length);
 }
 
 bool TraceReader::DecompressMemory(MemoryEncodingFormat encoding_format,
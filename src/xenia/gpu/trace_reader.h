@@ -10,7 +10,12 @@
 #ifndef XENIA_GPU_TRACE_READER_H_
 #define XENIA_GPU_TRACE_READER_H_
 
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include "xenia/base/mapped_memory.h"
@@ -112,6 +117,9 @@ class TraceReader {
     const uint8_t* end_ptr = nullptr;
     int command_count = 0;
 
+    // Commands are parsed on the first access to the frame.
+    bool parsed = false;
+
     // Flat list of all commands in this frame.
     std::vector<Command> commands;
 
@@ -120,29 +128,70 @@ class TraceReader {
   };
 
   TraceReader() = default;
-  virtual ~TraceReader() = default;
+  virtual ~TraceReader();
 
   const TraceHeader* header() const {
     return reinterpret_cast<const TraceHeader*>(trace_data_);
   }
 
-  const Frame* frame(int n) const { return &frames_[n]; }
+  // Parses the commands of the frame if this is the first access to it.
+  const Frame* frame(int n) const;
   int frame_count() const { return int(frames_.size()); }
 
   bool Open(const std::filesystem::path& path);
 
   void Close();
 
+  // Starts decompressing the memory commands of the frame on worker threads,
+  // so that they're ready by the time the frame is played. Replaces any
+  // previously prefetched frame.
+  void PrefetchFrame(int n);
+
  protected:
-  void ParseTrace();
+  // Loads the frame bounds from the index at the end of the file, if the trace
+  // has one.
+  bool ReadFrameIndex();
+  // Finds the frame bounds by walking the whole trace.
+  void ScanFrames();
+  void ParseFrame(Frame* frame) const;
+  // Returns the size of the trace command at trace_ptr including its data.
+  static size_t GetCommandSize(const uint8_t* trace_ptr);
+
   bool DecompressMemory(MemoryEncodingFormat encoding_format,
                         const uint8_t* src, size_t src_size, uint8_t* dest,
                         size_t dest_size);
+  // Decompresses the data of a kMemoryRead or kMemoryWrite command, using the
+  // prefetched copy if there is one.
+  bool DecompressMemoryCommand(const MemoryCommand* cmd, uint8_t* dest);
+  // Returns the kMemoryRead command holding the data of the reference, or
+  // nullptr if the reference is invalid.
+  const MemoryCommand* GetMemoryReadSource(
+      const MemoryReadReferenceCommand* cmd) const;
+
+  void PrefetchThread();
+  void StopPrefetch();
 
   std::unique_ptr<MappedMemory> mmap_;
   const uint8_t* trace_data_ = nullptr;
   size_t trace_size_ = 0;
-  std::vector<Frame> frames_;
+  // End of the commands, before the frame index if there is one.
+  const uint8_t* trace_end_ = nullptr;
+  mutable std::mutex frames_mutex_;
+  mutable std::vector<Frame> frames_;
+
+  struct PrefetchedFrame {
+    int index;
+    // Decompressed data of the memory commands of the frame.
+    std::unordered_map<const MemoryCommand*, std::unique_ptr<uint8_t[]>>
+        memory;
+  };
+  std::mutex prefetch_mutex_;
+  std::condition_variable prefetch_cond_;
+  int prefetch_requested_frame_ = -1;
+  bool prefetch_shutdown_ = false;
+  // Oldest first.
+  std::vector<PrefetchedFrame> prefetched_frames_;
+  std::thread prefetch_thread_;
 };
 
 }  // namespace gpu
@@ -368,6 +368,11 @@ void TraceViewer::DrawPacketDisassemblerUI() {
         // ImGui::BulletText("MemoryRead");
         break;
       }
+      case TraceCommandType::kMemoryReadReference: {
+        trace_ptr += sizeof(MemoryReadReferenceCommand);
+        // ImGui::BulletText("MemoryReadReference");
+        break;
+      }
       case TraceCommandType::kMemoryWrite: {
         auto cmd = reinterpret_cast<const MemoryCommand*>(trace_ptr);
         trace_ptr += sizeof(*cmd) + cmd->encoded_length;
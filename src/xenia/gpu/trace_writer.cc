@@ -13,20 +13,36 @@
 
 #include "third_party/snappy/snappy-sinksource.h"
 #include "third_party/snappy/snappy.h"
+#include "third_party/xxhash/xxhash.h"
 
 #include "build/version.h"
 #include "xenia/base/assert.h"
+#include "xenia/base/clock.h"
 #include "xenia/base/filesystem.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/string.h"
+#include "xenia/base/threading.h"
+#include "xenia/gpu/gpu_flags.h"
 
 namespace xe {
 namespace gpu {
 
+namespace {
+
+// Buffers are submitted to the writer thread when they reach this size, but
+// may be bigger if a single memory command doesn't fit.
+constexpr size_t kBufferSize = 4 * 1024 * 1024;
+// The calling thread waits for the writer thread when this much data is
+// queued.
+constexpr size_t kMaxQueuedBytes = 256 * 1024 * 1024;
+constexpr uint32_t kEDRAMSize = 10 * 1024 * 1024;
+
+}  // namespace
+
 TraceWriter::TraceWriter(uint8_t* membase)
     : membase_(membase), file_(nullptr) {}
 
-TraceWriter::~TraceWriter() = default;
+TraceWriter::~TraceWriter() { Close(); }
 
 bool TraceWriter::Open(const std::filesystem::path& path, uint32_t title_id) {
   Close();
@@ -37,7 +53,9 @@ bool TraceWriter::Open(const std::filesystem::path& path, uint32_t title_id) {
     std::filesystem::create_directories(base_path);
   }
 
-  file_ = xe::filesystem::OpenFile(canonical_path, "wb");
+  // Opened for reading too, to check deduplicated memory reads against the
+  // data already written.
+  file_ = xe::filesystem::OpenFile(canonical_path, "w+b");
   if (!file_) {
     return false;
   }
@@ -51,18 +69,70 @@ bool TraceWriter::Open(const std::filesystem::path& path, uint32_t title_id) {
   fwrite(&header, sizeof(header), 1, file_);
 
   cached_memory_reads_.clear();
+  pending_frame_end_ = false;
+  indirect_buffer_ended_ = false;
+  frame_memory_ticks_ = 0;
+
+  memory_read_sources_.clear();
+  frame_end_offsets_.clear();
+  frame_start_offset_ = sizeof(header);
+  frame_memory_read_bytes_ = 0;
+  frame_deduplicated_bytes_ = 0;
+  frame_encode_ticks_ = 0;
+
+  current_buffer_ = std::make_unique<Buffer>();
+  current_buffer_->data.reserve(kBufferSize);
+  writer_shutdown_ = false;
+  writer_thread_ = std::thread([this]() {
+    xe::threading::set_name("GPU Trace Writer");
+    WriterThread();
+  });
   return true;
 }
 
 void TraceWriter::Flush() {
-  if (file_) {
-    fflush(file_);
+  if (file_ && !current_buffer_->data.empty()) {
+    SubmitBuffer(true);
   }
 }
 
 void TraceWriter::Close() {
   if (file_) {
+    // Let the writer thread finish everything queued.
+    SubmitBuffer(true);
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex_);
+      writer_shutdown_ = true;
+      queue_cond_.notify_one();
+    }
+    // The index and footer below must not race the last queued writes.
+    writer_thread_.join();
+    current_buffer_.reset();
+    free_buffers_.clear();
+
     cached_memory_reads_.clear();
+    memory_read_sources_.clear();
+
+    // Write the frame index, including the last frame if it wasn't ended with
+    // a swap.
+    int64_t index_offset = xe::filesystem::Tell(file_);
+    if (index_offset > 0) {
+      uint64_t last_frame_end = frame_end_offsets_.empty()
+                                    ? sizeof(TraceHeader)
+                                    : frame_end_offsets_.back();
+      if (uint64_t(index_offset) > last_frame_end) {
+        frame_end_offsets_.push_back(uint64_t(index_offset));
+      }
+      fwrite(frame_end_offsets_.data(), sizeof(uint64_t),
+             frame_end_offsets_.size(), file_);
+      TraceFooter footer;
+      footer.magic = kTraceFooterMagic;
+      footer.frame_count = uint32_t(frame_end_offsets_.size());
+      footer.index_offset = uint64_t(index_offset);
+      fwrite(&footer, sizeof(footer), 1, file_);
+    }
+    frame_end_offsets_.clear();
+    pending_frame_end_ = false;
 
     fflush(file_);
     fclose(file_);
@@ -70,6 +140,122 @@ void TraceWriter::Close() {
   }
 }
 
+uint8_t* TraceWriter::AppendRecord(RecordType type, size_t size) {
+  auto& data = current_buffer_->data;
+  if (!data.empty() &&
+      data.size() + sizeof(RecordHeader) + size > kBufferSize) {
+    SubmitBuffer(false);
+  }
+  auto& buffer = *current_buffer_;
+  size_t offset = buffer.data.size();
+  buffer.data.resize(offset + sizeof(RecordHeader) + size);
+  RecordHeader header = {type, uint32_t(size)};
+  std::memcpy(buffer.data.data() + offset, &header, sizeof(header));
+  buffer.data_record_offset = type == RecordType::kData ? offset : SIZE_MAX;
+  return buffer.data.data() + offset + sizeof(header);
+}
+
+void TraceWriter::AppendData(const void* data, size_t size) {
+  auto& buffer = *current_buffer_;
+  if (buffer.data_record_offset != SIZE_MAX &&
+      buffer.data.size() + size <= kBufferSize) {
+    // Extend the last record.
+    size_t offset = buffer.data.size();
+    buffer.data.resize(offset + size);
+    std::memcpy(buffer.data.data() + offset, data, size);
+    auto header = reinterpret_cast<RecordHeader*>(buffer.data.data() +
+                                                  buffer.data_record_offset);
+    header->size += uint32_t(size);
+    return;
+  }
+  std::memcpy(AppendRecord(RecordType::kData, size), data, size);
+}
+
+void TraceWriter::SubmitBuffer(bool flush) {
+  current_buffer_->flush = flush;
+  size_t size = current_buffer_->data.size();
+  std::unique_lock<std::mutex> lock(queue_mutex_);
+  // Back-pressure if the writer thread can't keep up.
+  queue_space_cond_.wait(lock, [this]() {
+    return queued_bytes_ < kMaxQueuedBytes || queue_.empty();
+  });
+  queue_.push_back(std::move(current_buffer_));
+  queued_bytes_ += size;
+  queue_cond_.notify_one();
+  if (!free_buffers_.empty()) {
+    current_buffer_ = std::move(free_buffers_.back());
+    free_buffers_.pop_back();
+  } else {
+    current_buffer_ = std::make_unique<Buffer>();
+    current_buffer_->data.reserve(kBufferSize);
+  }
+}
+
+void TraceWriter::WriterThread() {
+  while (true) {
+    std::unique_ptr<Buffer> buffer;
+    {
+      std::unique_lock<std::mutex> lock(queue_mutex_);
+      queue_cond_.wait(
+          lock, [this]() { return writer_shutdown_ || !queue_.empty(); });
+      if (queue_.empty()) {
+        break;
+      }
+      buffer = std::move(queue_.front());
+      queue_.pop_front();
+    }
+
+    WriteBuffer(*buffer);
+
+    size_t size = buffer->data.size();
+    buffer->data.clear();
+    buffer->data_record_offset = SIZE_MAX;
+    buffer->flush = false;
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    queued_bytes_ -= size;
+    // Don't keep buffers that grew for big memory commands around.
+    if (buffer->data.capacity() <= kBufferSize) {
+      free_buffers_.push_back(std::move(buffer));
+    }
+    queue_space_cond_.notify_one();
+  }
+}
+
+void TraceWriter::WriteBuffer(const Buffer& buffer) {
+  const uint8_t* data = buffer.data.data();
+  size_t offset = 0;
+  while (offset < buffer.data.size()) {
+    RecordHeader header;
+    std::memcpy(&header, data + offset, sizeof(header));
+    const uint8_t* payload = data + offset + sizeof(header);
+    switch (header.type) {
+      case RecordType::kData:
+        fwrite(payload, 1, header.size, file_);
+        break;
+      case RecordType::kMemory: {
+        MemoryCommand cmd;
+        std::memcpy(&cmd, payload, sizeof(cmd));
+        WriteMemoryCommand(cmd.type, cmd.base_ptr, cmd.decoded_length,
+                           payload + sizeof(cmd));
+        break;
+      }
+      case RecordType::kEDRAMSnapshot:
+        WriteEDRAMSnapshotData(payload);
+        break;
+      case RecordType::kFrameEnd: {
+        uint64_t memory_ticks;
+        std::memcpy(&memory_ticks, payload, sizeof(memory_ticks));
+        WriteFrameEnd(memory_ticks);
+        break;
+      }
+    }
+    offset += sizeof(header) + header.size;
+  }
+  if (buffer.flush) {
+    fflush(file_);
+  }
+}
+
 void TraceWriter::WritePrimaryBufferStart(uint32_t base_ptr, uint32_t count) {
   if (!file_) {
     return;
@@ -79,7 +265,7 @@ void TraceWriter::WritePrimaryBufferStart(uint32_t base_ptr, uint32_t count) {
       base_ptr,
       0,
   };
-  fwrite(&cmd, 1, sizeof(cmd), file_);
+  AppendData(&cmd, sizeof(cmd));
 }
 
 void TraceWriter::WritePrimaryBufferEnd() {
@@ -89,7 +275,7 @@ void TraceWriter::WritePrimaryBufferEnd() {
   PrimaryBufferEndCommand cmd = {
       TraceCommandType::kPrimaryBufferEnd,
   };
-  fwrite(&cmd, 1, sizeof(cmd), file_);
+  AppendData(&cmd, sizeof(cmd));
 }
 
 void TraceWriter::WriteIndirectBufferStart(uint32_t base_ptr, uint32_t count) {
@@ -101,7 +287,7 @@ void TraceWriter::WriteIndirectBufferStart(uint32_t base_ptr, uint32_t count) {
       base_ptr,
       0,
   };
-  fwrite(&cmd, 1, sizeof(cmd), file_);
+  AppendData(&cmd, sizeof(cmd));
 }
 
 void TraceWriter::WriteIndirectBufferEnd() {
@@ -111,7 +297,8 @@ void TraceWriter::WriteIndirectBufferEnd() {
   IndirectBufferEndCommand cmd = {
       TraceCommandType::kIndirectBufferEnd,
   };
-  fwrite(&cmd, 1, sizeof(cmd), file_);
+  AppendData(&cmd, sizeof(cmd));
+  indirect_buffer_ended_ = true;
 }
 
 void TraceWriter::WritePacketStart(uint32_t base_ptr, uint32_t count) {
@@ -123,8 +310,8 @@ void TraceWriter::WritePacketStart(uint32_t base_ptr, uint32_t count) {
       base_ptr,
       count,
   };
-  fwrite(&cmd, 1, sizeof(cmd), file_);
-  fwrite(membase_ + base_ptr, 4, count, file_);
+  AppendData(&cmd, sizeof(cmd));
+  AppendData(membase_ + base_ptr, count * 4);
 }
 
 void TraceWriter::WritePacketEnd() {
@@ -134,7 +321,15 @@ void TraceWriter::WritePacketEnd() {
   PacketEndCommand cmd = {
       TraceCommandType::kPacketEnd,
   };
-  fwrite(&cmd, 1, sizeof(cmd), file_);
+  AppendData(&cmd, sizeof(cmd));
+  if (indirect_buffer_ended_) {
+    indirect_buffer_ended_ = false;
+  } else if (pending_frame_end_) {
+    pending_frame_end_ = false;
+    std::memcpy(AppendRecord(RecordType::kFrameEnd, sizeof(uint64_t)),
+                &frame_memory_ticks_, sizeof(uint64_t));
+    frame_memory_ticks_ = 0;
+  }
 }
 
 void TraceWriter::WriteMemoryRead(uint32_t base_ptr, size_t length,
@@ -142,7 +337,7 @@ void TraceWriter::WriteMemoryRead(uint32_t base_ptr, size_t length,
   if (!file_) {
     return;
   }
-  WriteMemoryCommand(TraceCommandType::kMemoryRead, base_ptr, length, host_ptr);
+  QueueMemoryCommand(TraceCommandType::kMemoryRead, base_ptr, length, host_ptr);
 }
 
 void TraceWriter::WriteMemoryReadCached(uint32_t base_ptr, size_t length) {
@@ -153,7 +348,8 @@ void TraceWriter::WriteMemoryReadCached(uint32_t base_ptr, size_t length) {
   // HACK: length is guaranteed to be within 32-bits (guest memory)
   uint64_t key = uint64_t(base_ptr) << 32 | uint64_t(length);
   if (cached_memory_reads_.find(key) == cached_memory_reads_.end()) {
-    WriteMemoryCommand(TraceCommandType::kMemoryRead, base_ptr, length);
+    QueueMemoryCommand(TraceCommandType::kMemoryRead, base_ptr, length,
+                       nullptr);
     cached_memory_reads_.insert(key);
   }
 }
@@ -175,10 +371,29 @@ void TraceWriter::WriteMemoryWrite(uint32_t base_ptr, size_t length,
   if (!file_) {
     return;
   }
-  WriteMemoryCommand(TraceCommandType::kMemoryWrite, base_ptr, length,
+  QueueMemoryCommand(TraceCommandType::kMemoryWrite, base_ptr, length,
                      host_ptr);
 }
 
+void TraceWriter::QueueMemoryCommand(TraceCommandType type, uint32_t base_ptr,
+                                     size_t length, const void* host_ptr) {
+  uint64_t start_ticks = Clock::QueryHostTickCount();
+  if (!host_ptr) {
+    host_ptr = membase_ + base_ptr;
+  }
+  // The memory may be modified by the guest before the writer thread gets to
+  // it, so it's copied now.
+  MemoryCommand cmd;
+  cmd.type = type;
+  cmd.base_ptr = base_ptr;
+  cmd.encoding_format = MemoryEncodingFormat::kNone;
+  cmd.encoded_length = cmd.decoded_length = static_cast<uint32_t>(length);
+  uint8_t* payload = AppendRecord(RecordType::kMemory, sizeof(cmd) + length);
+  std::memcpy(payload, &cmd, sizeof(cmd));
+  std::memcpy(payload + sizeof(cmd), host_ptr, length);
+  frame_memory_ticks_ += Clock::QueryHostTickCount() - start_ticks;
+}
+
 class SnappySink : public snappy::Sink {
  public:
   SnappySink(FILE* file) : file_(file) {}
@@ -191,18 +406,53 @@ class SnappySink : public snappy::Sink {
   FILE* file_ = nullptr;
 };
 
+bool TraceWriter::WriteMemoryReadReference(uint32_t base_ptr, size_t length,
+                                          const void* host_ptr) {
+  // A reference is bigger than the header of a small read with its data.
+  if (length < sizeof(MemoryReadReferenceCommand)) {
+    return false;
+  }
+  MemoryReadKey key;
+  key.hash[0] = XXH64(host_ptr, length, 0);
+  key.hash[1] = XXH64(host_ptr, length, 0x9E3779B97F4A7C15ull);
+  key.length = uint32_t(length);
+  auto it = memory_read_sources_.find(key);
+  if (it != memory_read_sources_.end()) {
+    MemoryReadReferenceCommand cmd;
+    cmd.type = TraceCommandType::kMemoryReadReference;
+    cmd.base_ptr = base_ptr;
+    cmd.decoded_length = static_cast<uint32_t>(length);
+    cmd.reserved = 0;
+    cmd.source_offset = it->second;
+    fwrite(&cmd, 1, sizeof(cmd), file_);
+    frame_deduplicated_bytes_ += length;
+    return true;
+  }
+  int64_t offset = xe::filesystem::Tell(file_);
+  if (offset > 0) {
+    memory_read_sources_[key] = uint64_t(offset);
+  }
+  return false;
+}
+
 void TraceWriter::WriteMemoryCommand(TraceCommandType type, uint32_t base_ptr,
                                      size_t length, const void* host_ptr) {
+  uint64_t start_ticks = Clock::QueryHostTickCount();
+  if (type == TraceCommandType::kMemoryRead) {
+    frame_memory_read_bytes_ += length;
+    if (cvars::trace_gpu_deduplicate_memory &&
+        WriteMemoryReadReference(base_ptr, length, host_ptr)) {
+      frame_encode_ticks_ += Clock::QueryHostTickCount() - start_ticks;
+      return;
+    }
+  }
+
   MemoryCommand cmd;
   cmd.type = type;
   cmd.base_ptr = base_ptr;
   cmd.encoding_format = MemoryEncodingFormat::kNone;
   cmd.encoded_length = cmd.decoded_length = static_cast<uint32_t>(length);
 
-  if (!host_ptr) {
-    host_ptr = membase_ + cmd.base_ptr;
-  }
-
   bool compress = compress_output_ && length > compression_threshold_;
   if (compress) {
     // Write the header now so we reserve space in the buffer.
@@ -228,10 +478,18 @@ void TraceWriter::WriteMemoryCommand(TraceCommandType type, uint32_t base_ptr,
     fwrite(&cmd, 1, sizeof(cmd), file_);
     fwrite(host_ptr, 1, cmd.decoded_length, file_);
   }
+  frame_encode_ticks_ += Clock::QueryHostTickCount() - start_ticks;
 }
 
 void TraceWriter::WriteEDRAMSnapshot(const void* snapshot) {
-  const uint32_t kEDRAMSize = 10 * 1024 * 1024;
+  if (!file_) {
+    return;
+  }
+  std::memcpy(AppendRecord(RecordType::kEDRAMSnapshot, kEDRAMSize), snapshot,
+              kEDRAMSize);
+}
+
+void TraceWriter::WriteEDRAMSnapshotData(const void* snapshot) {
   EDRAMSnapshotCommand cmd;
   cmd.type = TraceCommandType::kEDRAMSnapshot;
   if (compress_output_) {
@@ -269,7 +527,30 @@ void TraceWriter::WriteEvent(EventCommand::Type event_type) {
       TraceCommandType::kEvent,
       event_type,
   };
-  fwrite(&cmd, 1, sizeof(cmd), file_);
+  AppendData(&cmd, sizeof(cmd));
+  if (event_type == EventCommand::Type::kSwap) {
+    pending_frame_end_ = true;
+  }
+}
+
+void TraceWriter::WriteFrameEnd(uint64_t memory_ticks) {
+  int64_t offset = xe::filesystem::Tell(file_);
+  if (offset <= 0) {
+    return;
+  }
+  double ms_per_tick = 1000.0 / double(Clock::QueryHostTickFrequency());
+  XELOGD(
+      "GPU trace frame {}: {} bytes written, {} of {} bytes of memory reads "
+      "deduplicated, {:.3f} ms copying memory on the command processor "
+      "thread, {:.3f} ms encoding it on the writer thread",
+      frame_end_offsets_.size(), uint64_t(offset) - frame_start_offset_,
+      frame_deduplicated_bytes_, frame_memory_read_bytes_,
+      memory_ticks * ms_per_tick, frame_encode_ticks_ * ms_per_tick);
+  frame_end_offsets_.push_back(uint64_t(offset));
+  frame_start_offset_ = uint64_t(offset);
+  frame_memory_read_bytes_ = 0;
+  frame_deduplicated_bytes_ = 0;
+  frame_encode_ticks_ = 0;
 }
 
 }  //  namespace gpu
@@ -10,9 +10,16 @@
 #ifndef XENIA_GPU_TRACE_WRITER_H_
 #define XENIA_GPU_TRACE_WRITER_H_
 
+#include <condition_variable>
+#include <deque>
 #include <filesystem>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "xenia/gpu/trace_protocol.h"
 
@@ -46,13 +53,106 @@ class TraceWriter {
   void WriteEvent(EventCommand::Type event_type);
 
  private:
+  // Commands are serialized into buffers on the calling (command processor)
+  // thread, while deduplication, compression and file I/O are done on the
+  // writer thread. Each buffer is a sequence of records, each starting with a
+  // RecordHeader.
+  enum class RecordType : uint32_t {
+    // Trace commands to write as they are.
+    kData,
+    // A MemoryCommand followed by decoded_length bytes of raw data, to encode.
+    kMemory,
+    // A full EDRAM snapshot to encode.
+    kEDRAMSnapshot,
+    // The end of a frame, with the host ticks the calling thread spent on
+    // memory commands during the frame as a uint64_t.
+    kFrameEnd,
+  };
+  struct RecordHeader {
+    RecordType type;
+    // Size of the data after the header.
+    uint32_t size;
+  };
+  struct Buffer {
+    std::vector<uint8_t> data;
+    // Offset of the last record if it's kData, to append to it.
+    size_t data_record_offset = SIZE_MAX;
+    // Whether to flush the file after writing the buffer.
+    bool flush = false;
+  };
+
+  // Calling thread.
+  uint8_t* AppendRecord(RecordType type, size_t size);
+  void AppendData(const void* data, size_t size);
+  void SubmitBuffer(bool flush);
+  void QueueMemoryCommand(TraceCommandType type, uint32_t base_ptr,
+                          size_t length, const void* host_ptr);
+
+  // Writer thread.
+  void WriterThread();
+  void WriteBuffer(const Buffer& buffer);
   void WriteMemoryCommand(TraceCommandType type, uint32_t base_ptr,
-                          size_t length, const void* host_ptr = nullptr);
+                          size_t length, const void* host_ptr);
+  // Contents of a memory read, identified by two independently seeded 64-bit
+  // hashes and the length. A collision of all of them is unlikely enough that
+  // sources aren't read back from the file to compare them.
+  struct MemoryReadKey {
+    uint64_t hash[2];
+    uint32_t length;
+    bool operator==(const MemoryReadKey& other) const {
+      return hash[0] == other.hash[0] && hash[1] == other.hash[1] &&
+             length == other.length;
+    }
+    struct Hasher {
+      size_t operator()(const MemoryReadKey& key) const {
+        return size_t(key.hash[0]);
+      }
+    };
+  };
+  // Writes a reference to an earlier memory read with the same contents if
+  // there is one, or remembers where this one will be written otherwise.
+  bool WriteMemoryReadReference(uint32_t base_ptr, size_t length,
+                                const void* host_ptr);
+  void WriteEDRAMSnapshotData(const void* snapshot);
+  void WriteFrameEnd(uint64_t memory_ticks);
 
-  std::set<uint64_t> cached_memory_reads_;
   uint8_t* membase_;
+  // Only accessed by the writer thread while it's running.
   FILE* file_;
 
+  // Calling thread state.
+  std::set<uint64_t> cached_memory_reads_;
+  std::unique_ptr<Buffer> current_buffer_;
+  bool pending_frame_end_ = false;
+  bool indirect_buffer_ended_ = false;
+  uint64_t frame_memory_ticks_ = 0;
+
+  std::mutex queue_mutex_;
+  // Notified when a buffer is queued or on shutdown.
+  std::condition_variable queue_cond_;
+  // Notified when a buffer has been written.
+  std::condition_variable queue_space_cond_;
+  std::deque<std::unique_ptr<Buffer>> queue_;
+  size_t queued_bytes_ = 0;
+  std::vector<std::unique_ptr<Buffer>> free_buffers_;
+  bool writer_shutdown_ = false;
+  std::thread writer_thread_;
+
+  // Writer thread state.
+  // File offsets of the memory reads written so far, by their contents.
+  std::unordered_map<MemoryReadKey, uint64_t, MemoryReadKey::Hasher>
+      memory_read_sources_;
+  // File offsets of the ends of the frames written so far, for the index
+  // written on Close. Like in TraceReader, a frame ends with the first packet
+  // ended after the swap event, not counting the packet wrapping an indirect
+  // buffer that has just ended.
+  std::vector<uint64_t> frame_end_offsets_;
+  // Statistics of the current frame, logged when it ends.
+  uint64_t frame_start_offset_ = 0;
+  uint64_t frame_memory_read_bytes_ = 0;
+  uint64_t frame_deduplicated_bytes_ = 0;
+  uint64_t frame_encode_ticks_ = 0;
+
   bool compress_output_ = true;
   size_t compression_threshold_ = 1024;  // Min. number of bytes to compress.
 };
@@ -9,6 +9,8 @@
 
 #include "xenia/gpu/vulkan/buffer_cache.h"
 
+#include <algorithm>
+
 #include "xenia/base/logging.h"
 #include "xenia/base/math.h"
 #include "xenia/base/memory.h"
@@ -141,6 +143,10 @@ VkResult BufferCache::Initialize() {
     return status;
   }
 
+  memory_invalidation_callback_handle_ =
+      memory_->RegisterPhysicalMemoryInvalidationCallback(
+          MemoryInvalidationCallbackThunk, this);
+
   return VK_SUCCESS;
 }
 
@@ -305,6 +311,20 @@ void BufferCache::FreeConstantDescriptorSet() {
 }
 
 void BufferCache::Shutdown() {
+  if (memory_invalidation_callback_handle_ != nullptr) {
+    memory_->UnregisterPhysicalMemoryInvalidationCallback(
+        memory_invalidation_callback_handle_);
+    memory_invalidation_callback_handle_ = nullptr;
+  }
+
+  // The GPU is idle by now, so everything can be freed right away.
+  ClearCache();
+  for (CachedBuffer* cached_buffer : pending_delete_buffers_) {
+    cached_buffer->in_flight_fence = nullptr;
+    FreeCachedBuffer(cached_buffer);
+  }
+  pending_delete_buffers_.clear();
+
   if (mem_allocator_) {
     vmaDestroyAllocator(mem_allocator_);
     mem_allocator_ = nullptr;
@@ -421,15 +441,6 @@ std::pair<VkDeviceSize, VkDeviceSize> BufferCache::UploadConstantRegisters(
 std::pair<VkBuffer, VkDeviceSize> BufferCache::UploadIndexBuffer(
     VkCommandBuffer command_buffer, uint32_t source_addr,
     uint32_t source_length, xenos::IndexFormat format, VkFence fence) {
-  // Allocate space in the buffer for our data.
-  auto offset = AllocateTransientData(source_length, fence);
-  if (offset == VK_WHOLE_SIZE) {
-    // OOM.
-    return {nullptr, VK_WHOLE_SIZE};
-  }
-
-  const void* source_ptr = memory_->TranslatePhysical(source_addr);
-
   uint32_t prim_reset_index =
       register_file_->values[XE_GPU_REG_VGT_MULTI_PRIM_IB_RESET_INDX].u32;
   bool prim_reset_enabled =
@@ -438,30 +449,54 @@ std::pair<VkBuffer, VkDeviceSize> BufferCache::UploadIndexBuffer(
   // Copy data into the buffer. If primitive reset is enabled, translate any
   // primitive reset indices to something Vulkan understands.
   // TODO(benvanik): memcpy then use compute shaders to swap?
-  if (prim_reset_enabled) {
-    if (format == xenos::IndexFormat::kInt16) {
-      // Endian::k8in16, swap half-words.
-      copy_cmp_swap_16_unaligned(
-          transient_buffer_->host_base() + offset, source_ptr,
-          static_cast<uint16_t>(prim_reset_index), source_length / 2);
-    } else if (format == xenos::IndexFormat::kInt32) {
-      // Endian::k8in32, swap words.
-      copy_cmp_swap_32_unaligned(transient_buffer_->host_base() + offset,
-                                 source_ptr, prim_reset_index,
-                                 source_length / 4);
+  auto copy_swap = [=](void* dest, const void* source_ptr) {
+    if (prim_reset_enabled) {
+      if (format == xenos::IndexFormat::kInt16) {
+        // Endian::k8in16, swap half-words.
+        copy_cmp_swap_16_unaligned(dest, source_ptr,
+                                   static_cast<uint16_t>(prim_reset_index),
+                                   source_length / 2);
+      } else if (format == xenos::IndexFormat::kInt32) {
+        // Endian::k8in32, swap words.
+        copy_cmp_swap_32_unaligned(dest, source_ptr, prim_reset_index,
+                                   source_length / 4);
+      }
+    } else {
+      if (format == xenos::IndexFormat::kInt16) {
+        // Endian::k8in16, swap half-words.
+        xe::copy_and_swap_16_unaligned(dest, source_ptr, source_length / 2);
+      } else if (format == xenos::IndexFormat::kInt32) {
+        // Endian::k8in32, swap words.
+        xe::copy_and_swap_32_unaligned(dest, source_ptr, source_length / 4);
+      }
     }
-  } else {
-    if (format == xenos::IndexFormat::kInt16) {
-      // Endian::k8in16, swap half-words.
-      xe::copy_and_swap_16_unaligned(transient_buffer_->host_base() + offset,
-                                     source_ptr, source_length / 2);
-    } else if (format == xenos::IndexFormat::kInt32) {
-      // Endian::k8in32, swap words.
-      xe::copy_and_swap_32_unaligned(transient_buffer_->host_base() + offset,
-                                     source_ptr, source_length / 4);
+  };
+
+  if (cvars::vulkan_persistent_buffer_cache) {
+    uint32_t swap_mode = kSwapModeIndexBuffer | uint32_t(format);
+    if (prim_reset_enabled) {
+      swap_mode |= kSwapModePrimitiveReset;
+    }
+    CachedBuffer* cached_buffer = FindOrCreateCachedBuffer(
+        command_buffer, fence, source_addr, source_length, swap_mode,
+        prim_reset_enabled ? prim_reset_index : 0, VK_ACCESS_INDEX_READ_BIT,
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, copy_swap);
+    if (cached_buffer) {
+      return {cached_buffer->buffer, 0};
     }
   }
 
+  // Allocate space in the buffer for our data.
+  auto offset = AllocateTransientData(source_length, fence);
+  if (offset == VK_WHOLE_SIZE) {
+    // OOM.
+    return {nullptr, VK_WHOLE_SIZE};
+  }
+
+  copy_swap(transient_buffer_->host_base() + offset,
+            memory_->TranslatePhysical(source_addr));
+  frame_upload_bytes_ += source_length;
+
   transient_buffer_->Flush(offset, source_length);
 
   // Append a barrier to the command buffer.
@@ -486,6 +521,30 @@ std::pair<VkBuffer, VkDeviceSize> BufferCache::UploadIndexBuffer(
 std::pair<VkBuffer, VkDeviceSize> BufferCache::UploadVertexBuffer(
     VkCommandBuffer command_buffer, uint32_t source_addr,
     uint32_t source_length, xenos::Endian endian, VkFence fence) {
+  // Copy data into the buffer.
+  // TODO(benvanik): memcpy then use compute shaders to swap?
+  auto copy_swap = [=](void* dest, const void* upload_ptr) {
+    if (endian == xenos::Endian::k8in32) {
+      // Endian::k8in32, swap words.
+      xe::copy_and_swap_32_unaligned(dest, upload_ptr, source_length / 4);
+    } else if (endian == xenos::Endian::k16in32) {
+      xe::copy_and_swap_16_in_32_unaligned(dest, upload_ptr,
+                                           source_length / 4);
+    } else {
+      assert_always();
+    }
+  };
+
+  if (cvars::vulkan_persistent_buffer_cache) {
+    CachedBuffer* cached_buffer = FindOrCreateCachedBuffer(
+        command_buffer, fence, source_addr, source_length, uint32_t(endian), 0,
+        VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+        copy_swap);
+    if (cached_buffer) {
+      return {cached_buffer->buffer, 0};
+    }
+  }
+
   auto offset = FindCachedTransientData(source_addr, source_length);
   if (offset != VK_WHOLE_SIZE) {
     return {transient_buffer_->gpu_buffer(), offset};
@@ -514,20 +573,9 @@ std::pair<VkBuffer, VkDeviceSize> BufferCache::UploadVertexBuffer(
     return {nullptr, VK_WHOLE_SIZE};
   }
 
-  const void* upload_ptr = memory_->TranslatePhysical(upload_base);
-
-  // Copy data into the buffer.
-  // TODO(benvanik): memcpy then use compute shaders to swap?
-  if (endian == xenos::Endian::k8in32) {
-    // Endian::k8in32, swap words.
-    xe::copy_and_swap_32_unaligned(transient_buffer_->host_base() + offset,
-                                   upload_ptr, source_length / 4);
-  } else if (endian == xenos::Endian::k16in32) {
-    xe::copy_and_swap_16_in_32_unaligned(
-        transient_buffer_->host_base() + offset, upload_ptr, source_length / 4);
-  } else {
-    assert_always();
-  }
+  copy_swap(transient_buffer_->host_base() + offset,
+            memory_->TranslatePhysical(upload_base));
+  frame_upload_bytes_ += upload_size;
 
   transient_buffer_->Flush(offset, upload_size);
 
@@ -759,6 +807,233 @@ void BufferCache::CacheTransientData(uint32_t guest_address,
   }
 }
 
+BufferCache::CachedBuffer* BufferCache::FindOrCreateCachedBuffer(
+    VkCommandBuffer command_buffer, VkFence fence, uint32_t guest_address,
+    uint32_t guest_length, uint32_t swap_mode, uint32_t primitive_reset_index,
+    VkAccessFlags dst_access_mask, VkPipelineStageFlags dst_stage_mask,
+    const std::function<void(void* dest, const void* src)>& copy_swap) {
+  if (!guest_length) {
+    return nullptr;
+  }
+  uint64_t key = GetCachedBufferKey(guest_address, guest_length, swap_mode,
+                                    primitive_reset_index);
+
+  auto it = cached_buffers_.find(key);
+  if (it != cached_buffers_.end()) {
+    CachedBuffer* cached_buffer = it->second;
+    if (cached_buffer->guest_address != guest_address ||
+        cached_buffer->guest_length != guest_length ||
+        cached_buffer->swap_mode != swap_mode ||
+        cached_buffer->primitive_reset_index != primitive_reset_index) {
+      // Hash collision - leave the existing buffer alone.
+      return nullptr;
+    }
+    if (!cached_buffer->pending_invalidation) {
+      cached_buffer->in_flight_fence = fence;
+      lru_buffers_.splice(lru_buffers_.end(), lru_buffers_,
+                          cached_buffer->lru_iterator);
+      frame_cached_bytes_ += guest_length;
+      return cached_buffer;
+    }
+    RemoveInvalidatedBuffers();
+  }
+  if (dynamic_buffers_.count(key)) {
+    return nullptr;
+  }
+  uint64_t budget =
+      uint64_t(std::max(cvars::vulkan_persistent_buffer_cache_size, 0)) << 20;
+  if (guest_length > budget) {
+    return nullptr;
+  }
+  EvictCachedBuffers(budget - guest_length);
+
+  VkBufferCreateInfo buffer_info;
+  buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  buffer_info.pNext = nullptr;
+  buffer_info.flags = 0;
+  buffer_info.size = guest_length;
+  buffer_info.usage =
+      VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+  buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  buffer_info.queueFamilyIndexCount = 0;
+  buffer_info.pQueueFamilyIndices = nullptr;
+  VmaAllocationCreateInfo vma_create_info = {
+      VMA_ALLOCATION_CREATE_MAPPED_BIT,
+      VMA_MEMORY_USAGE_CPU_TO_GPU,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      0,
+      0,
+      nullptr,
+      nullptr,
+  };
+  auto cached_buffer = new CachedBuffer();
+  if (vmaCreateBuffer(mem_allocator_, &buffer_info, &vma_create_info,
+                      &cached_buffer->buffer, &cached_buffer->alloc,
+                      &cached_buffer->alloc_info) != VK_SUCCESS) {
+    delete cached_buffer;
+    return nullptr;
+  }
+  cached_buffer->guest_address = guest_address;
+  cached_buffer->guest_length = guest_length;
+  cached_buffer->swap_mode = swap_mode;
+  cached_buffer->primitive_reset_index = primitive_reset_index;
+  cached_buffer->in_flight_fence = fence;
+  cached_buffer->pending_invalidation = false;
+  cached_buffer->lru_iterator =
+      lru_buffers_.insert(lru_buffers_.end(), cached_buffer);
+  cached_buffer_bytes_ += guest_length;
+
+  // Start watching before reading so writes made during the copy aren't lost.
+  {
+    auto global_lock = global_critical_region_.Acquire();
+    cached_buffers_[key] = cached_buffer;
+  }
+  memory_->EnablePhysicalMemoryAccessCallbacks(guest_address, guest_length,
+                                               true, false);
+  copy_swap(cached_buffer->alloc_info.pMappedData,
+            memory_->TranslatePhysical(guest_address));
+  frame_upload_bytes_ += guest_length;
+
+  VkBufferMemoryBarrier barrier = {
+      VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+      nullptr,
+      VK_ACCESS_HOST_WRITE_BIT,
+      dst_access_mask,
+      VK_QUEUE_FAMILY_IGNORED,
+      VK_QUEUE_FAMILY_IGNORED,
+      cached_buffer->buffer,
+      0,
+      VK_WHOLE_SIZE,
+  };
+  vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_HOST_BIT,
+                       dst_stage_mask, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+  COUNT_profile_set("gpu/buffer_cache/cached_buffers", cached_buffers_.size());
+  return cached_buffer;
+}
+
+uint64_t BufferCache::GetCachedBufferKey(uint32_t guest_address,
+                                        uint32_t guest_length,
+                                        uint32_t swap_mode,
+                                        uint32_t primitive_reset_index) {
+  uint32_t key_data[] = {guest_address, guest_length, swap_mode,
+                         primitive_reset_index};
+  return XXH64(key_data, sizeof(key_data), 0);
+}
+
+void BufferCache::RemoveInvalidatedBuffers() {
+  std::vector<CachedBuffer*> invalidated_buffers;
+  {
+    auto global_lock = global_critical_region_.Acquire();
+    invalidated_buffers.swap(invalidated_buffers_);
+    for (CachedBuffer* cached_buffer : invalidated_buffers) {
+      uint64_t key = GetCachedBufferKey(
+          cached_buffer->guest_address, cached_buffer->guest_length,
+          cached_buffer->swap_mode, cached_buffer->primitive_reset_index);
+      cached_buffers_.erase(key);
+      // Don't cache data that's being changed by the guest again.
+      if (dynamic_buffers_.size() >= kMaxDynamicBuffers) {
+        dynamic_buffers_.clear();
+      }
+      dynamic_buffers_.insert(key);
+    }
+  }
+  for (CachedBuffer* cached_buffer : invalidated_buffers) {
+    UnlinkCachedBuffer(cached_buffer);
+  }
+  pending_delete_buffers_.insert(pending_delete_buffers_.end(),
+                                 invalidated_buffers.begin(),
+                                 invalidated_buffers.end());
+}
+
+void BufferCache::EvictCachedBuffers(uint64_t max_bytes) {
+  if (cached_buffer_bytes_ <= max_bytes) {
+    return;
+  }
+  auto global_lock = global_critical_region_.Acquire();
+  while (cached_buffer_bytes_ > max_bytes && !lru_buffers_.empty()) {
+    CachedBuffer* cached_buffer = lru_buffers_.front();
+    UnlinkCachedBuffer(cached_buffer);
+    if (cached_buffer->pending_invalidation) {
+      // Already queued in invalidated_buffers_, which will delete it.
+      continue;
+    }
+    // The range stays watched, but the callback won't find the buffer anymore.
+    cached_buffers_.erase(GetCachedBufferKey(
+        cached_buffer->guest_address, cached_buffer->guest_length,
+        cached_buffer->swap_mode, cached_buffer->primitive_reset_index));
+    pending_delete_buffers_.push_back(cached_buffer);
+  }
+}
+
+void BufferCache::UnlinkCachedBuffer(CachedBuffer* cached_buffer) {
+  if (cached_buffer->lru_iterator == lru_buffers_.end()) {
+    return;
+  }
+  lru_buffers_.erase(cached_buffer->lru_iterator);
+  cached_buffer->lru_iterator = lru_buffers_.end();
+  cached_buffer_bytes_ -= cached_buffer->guest_length;
+}
+
+bool BufferCache::FreeCachedBuffer(CachedBuffer* cached_buffer) {
+  if (cached_buffer->in_flight_fence) {
+    VkResult status =
+        vkGetFenceStatus(*device_, cached_buffer->in_flight_fence);
+    if (status != VK_SUCCESS && status != VK_ERROR_DEVICE_LOST) {
+      // Still in flight.
+      return false;
+    }
+  }
+  vmaDestroyBuffer(mem_allocator_, cached_buffer->buffer,
+                   cached_buffer->alloc);
+  delete cached_buffer;
+  return true;
+}
+
+std::pair<uint32_t, uint32_t> BufferCache::MemoryInvalidationCallback(
+    uint32_t physical_address_start, uint32_t length, bool exact_range) {
+  auto global_lock = global_critical_region_.Acquire();
+  // Everything on the written pages loses its watch, so invalidate whole pages
+  // rather than just the written range.
+  uint32_t page_size = uint32_t(xe::memory::page_size());
+  uint32_t written_start = physical_address_start & ~(page_size - 1);
+  uint32_t written_end = uint32_t(std::min(
+      (uint64_t(physical_address_start) + length + page_size - 1) &
+          ~uint64_t(page_size - 1),
+      uint64_t(UINT32_MAX)));
+  uint32_t previous_end = 0, next_start = UINT32_MAX;
+  bool hit = false;
+  for (auto& it : cached_buffers_) {
+    CachedBuffer* cached_buffer = it.second;
+    if (cached_buffer->pending_invalidation) {
+      continue;
+    }
+    uint32_t buffer_start = cached_buffer->guest_address;
+    uint32_t buffer_end = buffer_start + cached_buffer->guest_length;
+    if (buffer_start >= written_end) {
+      next_start = std::min(next_start, buffer_start);
+    } else if (buffer_end <= written_start) {
+      previous_end = std::max(previous_end, buffer_end);
+    } else {
+      cached_buffer->pending_invalidation = true;
+      invalidated_buffers_.push_back(cached_buffer);
+      hit = true;
+    }
+  }
+  if (hit) {
+    return std::make_pair(written_start, written_end - written_start);
+  }
+  return std::make_pair(previous_end, next_start - previous_end);
+}
+
+std::pair<uint32_t, uint32_t> BufferCache::MemoryInvalidationCallbackThunk(
+    void* context_ptr, uint32_t physical_address_start, uint32_t length,
+    bool exact_range) {
+  return reinterpret_cast<BufferCache*>(context_ptr)
+      ->MemoryInvalidationCallback(physical_address_start, length, exact_range);
+}
+
 void BufferCache::Flush(VkCommandBuffer command_buffer) {
   // If we are flushing a big enough chunk queue up an event.
   // We don't want to do this for everything but often enough so that we won't
@@ -786,7 +1061,23 @@ void BufferCache::InvalidateCache() {
   transient_cache_.clear();
 }
 
-void BufferCache::ClearCache() { transient_cache_.clear(); }
+void BufferCache::ClearCache() {
+  transient_cache_.clear();
+
+  RemoveInvalidatedBuffers();
+  {
+    auto global_lock = global_critical_region_.Acquire();
+    for (auto& it : cached_buffers_) {
+      UnlinkCachedBuffer(it.second);
+      // Buffers invalidated since are already queued in invalidated_buffers_.
+      if (!it.second->pending_invalidation) {
+        pending_delete_buffers_.push_back(it.second);
+      }
+    }
+    cached_buffers_.clear();
+  }
+  dynamic_buffers_.clear();
+}
 
 void BufferCache::Scavenge() {
   SCOPE_profile_cpu_f("gpu");
@@ -794,6 +1085,24 @@ void BufferCache::Scavenge() {
   transient_cache_.clear();
   transient_buffer_->Scavenge();
 
+  RemoveInvalidatedBuffers();
+  for (auto it = pending_delete_buffers_.begin();
+       it != pending_delete_buffers_.end();) {
+    if (FreeCachedBuffer(*it)) {
+      it = pending_delete_buffers_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  COUNT_profile_set("gpu/buffer_cache/upload_bytes", frame_upload_bytes_);
+  COUNT_profile_set("gpu/buffer_cache/cached_bytes", frame_cached_bytes_);
+  COUNT_profile_set("gpu/buffer_cache/cached_buffers", cached_buffers_.size());
+  COUNT_profile_set("gpu/buffer_cache/cached_buffer_bytes",
+                    cached_buffer_bytes_);
+  frame_upload_bytes_ = 0;
+  frame_cached_bytes_ = 0;
+
   // TODO(DrChat): These could persist across frames, we just need a smart way
   // to delete unused ones.
   vertex_sets_.clear();
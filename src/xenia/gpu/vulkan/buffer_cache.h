@@ -10,6 +10,7 @@
 #ifndef XENIA_GPU_VULKAN_BUFFER_CACHE_H_
 #define XENIA_GPU_VULKAN_BUFFER_CACHE_H_
 
+#include "xenia/base/mutex.h"
 #include "xenia/gpu/register_file.h"
 #include "xenia/gpu/shader.h"
 #include "xenia/gpu/xenos.h"
@@ -22,8 +23,12 @@
 #include "third_party/vulkan/vk_mem_alloc.h"
 #include "third_party/xxhash/xxhash.h"
 
+#include <functional>
+#include <list>
 #include <map>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace xe {
 namespace gpu {
@@ -111,14 +116,28 @@ class BufferCache {
   void Scavenge();
 
  private:
-  // This represents an uploaded vertex buffer.
-  struct VertexBuffer {
+  // A copy of guest vertex or index data that is swapped once and then reused
+  // for as long as the guest memory it was read from isn't written to.
+  struct CachedBuffer {
     uint32_t guest_address;
-    uint32_t size;
+    uint32_t guest_length;
+    // Endian of vertex data, or index format (with kSwapModePrimitiveReset).
+    uint32_t swap_mode;
+    uint32_t primitive_reset_index;
 
+    VkBuffer buffer;
     VmaAllocation alloc;
     VmaAllocationInfo alloc_info;
+
+    // Fence of the last batch that used this buffer.
+    VkFence in_flight_fence;
+    // Set by the memory invalidation callback, under global_critical_region_.
+    bool pending_invalidation;
+    // Position in lru_buffers_, or its end() once evicted or invalidated.
+    std::list<CachedBuffer*>::iterator lru_iterator;
   };
+  static constexpr uint32_t kSwapModeIndexBuffer = 1u << 8;
+  static constexpr uint32_t kSwapModePrimitiveReset = 1u << 9;
 
   VkResult CreateVertexDescriptorPool();
   void FreeVertexDescriptorPool();
@@ -145,6 +164,35 @@ class BufferCache {
   void CacheTransientData(uint32_t guest_address, uint32_t guest_length,
                           VkDeviceSize offset);
 
+  // Returns the persistent copy of the guest data for the swap mode, creating
+  // it with copy_swap if needed. Returns nullptr if the data has changed after
+  // being cached before (it's then treated as dynamic and always goes through
+  // the transient buffer) or if the copy couldn't be allocated.
+  CachedBuffer* FindOrCreateCachedBuffer(
+      VkCommandBuffer command_buffer, VkFence fence, uint32_t guest_address,
+      uint32_t guest_length, uint32_t swap_mode,
+      uint32_t primitive_reset_index, VkAccessFlags dst_access_mask,
+      VkPipelineStageFlags dst_stage_mask,
+      const std::function<void(void* dest, const void* src)>& copy_swap);
+  static uint64_t GetCachedBufferKey(uint32_t guest_address,
+                                     uint32_t guest_length, uint32_t swap_mode,
+                                     uint32_t primitive_reset_index);
+  // Moves buffers invalidated by guest writes to the deletion queue.
+  void RemoveInvalidatedBuffers();
+  // Moves the least recently used buffers to the deletion queue until the
+  // cached buffers take no more than max_bytes.
+  void EvictCachedBuffers(uint64_t max_bytes);
+  // Removes the buffer from the LRU list if it's still there.
+  void UnlinkCachedBuffer(CachedBuffer* cached_buffer);
+  // Returns false if the buffer is still in use by the GPU.
+  bool FreeCachedBuffer(CachedBuffer* cached_buffer);
+
+  std::pair<uint32_t, uint32_t> MemoryInvalidationCallback(
+      uint32_t physical_address_start, uint32_t length, bool exact_range);
+  static std::pair<uint32_t, uint32_t> MemoryInvalidationCallbackThunk(
+      void* context_ptr, uint32_t physical_address_start, uint32_t length,
+      bool exact_range);
+
   RegisterFile* register_file_ = nullptr;
   Memory* memory_ = nullptr;
   ui::vulkan::VulkanDevice* device_ = nullptr;
@@ -157,6 +205,30 @@ class BufferCache {
   std::unique_ptr<ui::vulkan::CircularBuffer> transient_buffer_ = nullptr;
   std::map<uint32_t, std::pair<uint32_t, VkDeviceSize>> transient_cache_;
 
+  // Persistent copies of vertex and index data, by hash of the guest range and
+  // swap mode. Modified on the GPU thread under global_critical_region_, and
+  // read by the memory invalidation callback.
+  xe::global_critical_region global_critical_region_;
+  void* memory_invalidation_callback_handle_ = nullptr;
+  std::unordered_map<uint64_t, CachedBuffer*> cached_buffers_;
+  // Protected by global_critical_region_.
+  std::vector<CachedBuffer*> invalidated_buffers_;
+  std::vector<CachedBuffer*> pending_delete_buffers_;
+  // Hashes of ranges that have been written to after being cached. Cleared
+  // when it grows past kMaxDynamicBuffers, which only costs caching each of
+  // them once more.
+  std::unordered_set<uint64_t> dynamic_buffers_;
+  static constexpr size_t kMaxDynamicBuffers = 65536;
+  // Cached buffers from least to most recently used, and the total size of
+  // them. Only accessed on the GPU thread.
+  std::list<CachedBuffer*> lru_buffers_;
+  uint64_t cached_buffer_bytes_ = 0;
+
+  // Bytes swapped and uploaded, and bytes served from cached buffers, this
+  // frame.
+  uint64_t frame_upload_bytes_ = 0;
+  uint64_t frame_cached_bytes_ = 0;
+
   // Vertex buffer descriptors
   std::unique_ptr<ui::vulkan::DescriptorPool> vertex_descriptor_pool_ = nullptr;
   VkDescriptorSetLayout vertex_descriptor_set_layout_ = nullptr;
@@ -10,12 +10,14 @@
 #include "xenia/gpu/vulkan/texture_cache.h"
 
 #include <algorithm>
+#include <functional>
 
 #include "third_party/fmt/include/fmt/format.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/math.h"
 #include "xenia/base/memory.h"
 #include "xenia/base/profiling.h"
+#include "xenia/base/threading.h"
 #include "xenia/gpu/gpu_flags.h"
 #include "xenia/gpu/sampler_info.h"
 #include "xenia/gpu/texture_conversion.h"
@@ -37,6 +39,8 @@ using xe::ui::vulkan::CheckResult;
 
 constexpr uint32_t kMaxTextureSamplers = 32;
 constexpr VkDeviceSize kStagingBufferSize = 64 * 1024 * 1024;
+// Approximate amount of converted data per texture conversion job.
+constexpr uint32_t kConversionBandSize = 256 * 1024;
 
 const char* get_dimension_name(xenos::DataDimension dimension) {
   static const char* names[] = {
@@ -151,6 +155,19 @@ VkResult TextureCache::Initialize() {
 
   device_queue_ = device_->AcquireQueue(device_->queue_family_index());
 
+  uint32_t logical_processor_count = xe::threading::logical_processor_count();
+  uint32_t conversion_thread_count;
+  if (cvars::vulkan_texture_conversion_threads < 0) {
+    conversion_thread_count = logical_processor_count / 2;
+  } else {
+    conversion_thread_count =
+        std::min(uint32_t(cvars::vulkan_texture_conversion_threads),
+                 logical_processor_count);
+  }
+  conversion_thread_pool_ =
+      std::make_unique<texture_conversion::ConversionThreadPool>(
+          conversion_thread_count);
+
   memory_invalidation_callback_handle_ =
       memory_->RegisterPhysicalMemoryInvalidationCallback(
           MemoryInvalidationCallbackThunk, this);
@@ -169,6 +186,8 @@ void TextureCache::Shutdown() {
     device_->ReleaseQueue(device_queue_, device_->queue_family_index());
   }
 
+  conversion_thread_pool_.reset();
+
   // Free all textures allocated.
   ClearCache();
   Scavenge();
@@ -989,7 +1008,8 @@ void TextureCache::FlushPendingCommands(VkCommandBuffer command_buffer,
 }
 
 bool TextureCache::ConvertTexture(uint8_t* dest, VkBufferImageCopy* copy_region,
-                                  uint32_t mip, const TextureInfo& src) {
+                                  uint32_t mip, const TextureInfo& src,
+                                  std::vector<std::function<void()>>* jobs) {
 #if FINE_GRAINED_DRAW_SCOPES
   SCOPE_profile_cpu_f("gpu");
 #endif  // FINE_GRAINED_DRAW_SCOPES
@@ -1012,37 +1032,61 @@ bool TextureCache::ConvertTexture(uint8_t* dest, VkBufferImageCopy* copy_region,
       dst_extent.block_pitch_h * GetFormatInfo(src.format)->bytes_per_block();
 
   auto copy_block = GetFormatCopyBlock(src.format);
+  xenos::Endian endian = src.endianness;
+
+  // Every face is split into bands of rows that can be converted in parallel.
+  uint32_t band_rows =
+      std::max(kConversionBandSize / std::max(dst_pitch, uint32_t(1)), 1u);
 
   const uint8_t* src_mem = reinterpret_cast<const uint8_t*>(host_address);
   if (!src.is_tiled) {
     for (uint32_t face = 0; face < dst_extent.depth; face++) {
       src_mem += offset_y * src_pitch;
       src_mem += offset_x * src.format_info()->bytes_per_block();
-      for (uint32_t y = 0; y < dst_extent.block_height; y++) {
-        copy_block(src.endianness, dest + y * dst_pitch,
-                   src_mem + y * src_pitch, dst_pitch);
+      for (uint32_t band_y = 0; band_y < dst_extent.block_height;
+           band_y += band_rows) {
+        uint32_t band_height =
+            std::min(band_rows, dst_extent.block_height - band_y);
+        jobs->push_back([=]() {
+          for (uint32_t y = band_y; y < band_y + band_height; y++) {
+            copy_block(endian, dest + y * dst_pitch, src_mem + y * src_pitch,
+                       dst_pitch);
+          }
+        });
       }
       src_mem += src_pitch * src_extent.block_pitch_v;
       dest += dst_pitch * dst_extent.block_pitch_v;
     }
   } else {
     // Untile image.
-    // We could do this in a shader to speed things up, as this is pretty slow.
     for (uint32_t face = 0; face < dst_extent.depth; face++) {
       texture_conversion::UntileInfo untile_info;
       std::memset(&untile_info, 0, sizeof(untile_info));
       untile_info.offset_x = offset_x;
-      untile_info.offset_y = offset_y;
       untile_info.width = src_extent.block_width;
-      untile_info.height = src_extent.block_height;
       untile_info.input_pitch = src_extent.block_pitch_h;
       untile_info.output_pitch = dst_extent.block_pitch_h;
       untile_info.input_format_info = src.format_info();
       untile_info.output_format_info = GetFormatInfo(src.format);
-      untile_info.copy_callback = [=](auto o, auto i, auto l) {
-        copy_block(src.endianness, o, i, l);
-      };
-      texture_conversion::Untile(dest, src_mem, &untile_info);
+      untile_info.endian = endian;
+      if (untile_info.input_format_info->bytes_per_block() !=
+          untile_info.output_format_info->bytes_per_block()) {
+        // Converted block by block (CTX1, DXT3A) - everything else is copied
+        // and swapped by Untile itself.
+        untile_info.copy_callback = [=](auto o, auto i, auto l) {
+          copy_block(endian, o, i, l);
+        };
+      }
+      for (uint32_t band_y = 0; band_y < src_extent.block_height;
+           band_y += band_rows) {
+        untile_info.offset_y = offset_y + band_y;
+        untile_info.height =
+            std::min(band_rows, src_extent.block_height - band_y);
+        uint8_t* band_dest = dest + band_y * dst_pitch;
+        jobs->push_back([=]() {
+          texture_conversion::Untile(band_dest, src_mem, &untile_info);
+        });
+      }
       src_mem += src_pitch * src_extent.block_pitch_v;
       dest += dst_pitch * dst_extent.block_pitch_v;
     }
@@ -1135,13 +1179,16 @@ bool TextureCache::UploadTexture(VkCommandBuffer command_buffer,
   uint32_t copy_region_count = src.mip_levels();
   std::vector<VkBufferImageCopy> copy_regions(copy_region_count);
 
-  // Upload all mips.
+  // Upload all mips. Conversion is split into jobs that write to disjoint
+  // parts of the staging buffer, and all of them are done before the copy is
+  // recorded.
   auto unpack_buffer = reinterpret_cast<uint8_t*>(alloc->host_ptr);
   VkDeviceSize unpack_offset = 0;
+  std::vector<std::function<void()>> conversion_jobs;
   for (uint32_t mip = src.mip_min_level, region = 0; mip <= src.mip_max_level;
        mip++, region++) {
     if (!ConvertTexture(&unpack_buffer[unpack_offset], &copy_regions[region],
-                        mip, src)) {
+                        mip, src, &conversion_jobs)) {
       XELOGW("Failed to convert texture mip {}!", mip);
       return false;
     }
@@ -1157,6 +1204,9 @@ bool TextureCache::UploadTexture(VkCommandBuffer command_buffer,
 
     unpack_offset += ComputeMipStorage(src, mip);
   }
+  conversion_thread_pool_->Run(
+      uint32_t(conversion_jobs.size()),
+      [&conversion_jobs](uint32_t i) { conversion_jobs[i](); });
 
   if (cvars::texture_dump) {
     TextureDump(src, unpack_buffer, unpack_length);
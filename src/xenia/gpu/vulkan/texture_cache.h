@@ -11,9 +11,11 @@
 #define XENIA_GPU_VULKAN_TEXTURE_CACHE_H_
 
 #include <algorithm>
+#include <functional>
 #include <list>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "xenia/base/mutex.h"
 #include "xenia/gpu/register_file.h"
@@ -163,8 +165,11 @@ class TextureCache {
   void FlushPendingCommands(VkCommandBuffer command_buffer,
                             VkFence completion_fence);
 
+  // Fills in the copy region for the mip and appends the jobs that convert it
+  // into dest, which must stay valid until the jobs have run.
   bool ConvertTexture(uint8_t* dest, VkBufferImageCopy* copy_region,
-                      uint32_t mip, const TextureInfo& src);
+                      uint32_t mip, const TextureInfo& src,
+                      std::vector<std::function<void()>>* jobs);
 
   static const FormatInfo* GetFormatInfo(xenos::TextureFormat format);
   static texture_conversion::CopyBlockCallback GetFormatCopyBlock(
@@ -207,6 +212,9 @@ class TextureCache {
   ui::vulkan::VulkanDevice* device_ = nullptr;
   VkQueue device_queue_ = nullptr;
 
+  std::unique_ptr<texture_conversion::ConversionThreadPool>
+      conversion_thread_pool_;
+
   std::unique_ptr<xe::ui::vulkan::CommandBufferPool> wb_command_pool_ = nullptr;
   std::unique_ptr<xe::ui::vulkan::DescriptorPool> descriptor_pool_ = nullptr;
   std::unordered_map<uint64_t, VkDescriptorSet> texture_sets_;
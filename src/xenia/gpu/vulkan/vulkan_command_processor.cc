@@ -199,26 +199,10 @@ void VulkanCommandProcessor::ReturnFromWait() {
 void VulkanCommandProcessor::WriteRegister(uint32_t index, uint32_t value) {
   CommandProcessor::WriteRegister(index, value);
 
-  if (index >= XE_GPU_REG_SHADER_CONSTANT_000_X &&
-      index <= XE_GPU_REG_SHADER_CONSTANT_511_W) {
-    uint32_t offset = index - XE_GPU_REG_SHADER_CONSTANT_000_X;
-    offset /= 4 * 4;
-    offset ^= 0x3F;
-
-    dirty_float_constants_ |= (1ull << offset);
-  } else if (index >= XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031 &&
-             index <= XE_GPU_REG_SHADER_CONSTANT_BOOL_224_255) {
-    uint32_t offset = index - XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031;
-    offset ^= 0x7;
-
-    dirty_bool_constants_ |= (1 << offset);
-  } else if (index >= XE_GPU_REG_SHADER_CONSTANT_LOOP_00 &&
-             index <= XE_GPU_REG_SHADER_CONSTANT_LOOP_31) {
-    uint32_t offset = index - XE_GPU_REG_SHADER_CONSTANT_LOOP_00;
-    offset ^= 0x1F;
-
-    dirty_loop_constants_ |= (1 << offset);
-  } else if (index == XE_GPU_REG_DC_LUT_PWL_DATA) {
+  if (dirty_shader_constants_.MarkRegister(index)) {
+    return;
+  }
+  if (index == XE_GPU_REG_DC_LUT_PWL_DATA) {
     UpdateGammaRampValue(GammaRampType::kPWL, value);
   } else if (index == XE_GPU_REG_DC_LUT_30_COLOR) {
     UpdateGammaRampValue(GammaRampType::kNormal, value);
@@ -235,6 +219,11 @@ void VulkanCommandProcessor::WriteRegister(uint32_t index, uint32_t value) {
   }
 }
 
+void VulkanCommandProcessor::OnShaderConstantsWritten(uint32_t start_index,
+                                                      uint32_t count) {
+  dirty_shader_constants_.MarkRange(start_index, count);
+}
+
 void VulkanCommandProcessor::CreateSwapImage(VkCommandBuffer setup_buffer,
                                              VkExtent2D extents) {
   VkImageCreateInfo image_info;
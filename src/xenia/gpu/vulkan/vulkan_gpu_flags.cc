@@ -14,3 +14,20 @@ DEFINE_bool(vulkan_renderdoc_capture_all, false,
 DEFINE_bool(vulkan_native_msaa, false, "Use native MSAA", "Vulkan");
 DEFINE_bool(vulkan_dump_disasm, false,
             "Dump shader disassembly. NVIDIA only supported.", "Vulkan");
+DEFINE_bool(vulkan_persistent_buffer_cache, true,
+            "Keep swapped copies of vertex and index buffers across frames "
+            "until the guest writes to them, instead of re-uploading them for "
+            "every frame.",
+            "Vulkan");
+DEFINE_int32(vulkan_persistent_buffer_cache_size, 256,
+             "Maximum total size of the persistent vertex and index buffer "
+             "copies, in megabytes. The least recently used ones are dropped "
+             "to stay under it.",
+             "Vulkan");
+DEFINE_int32(
+    vulkan_texture_conversion_threads, -1,
+    "Number of additional threads used for converting textures on the CPU. "
+    "-1 to calculate automatically (50% of logical CPU cores), a positive "
+    "number to specify the number of threads explicitly (up to the number of "
+    "logical CPU cores), 0 to convert on the GPU thread only.",
+    "Vulkan");
@@ -14,3 +14,22 @@ DEFINE_bool(headless, false,
             "UI");
 DEFINE_bool(log_high_frequency_kernel_calls, false,
             "Log kernel calls with the kHighFrequency tag.", "Kernel");
+DEFINE_path(kernel_call_trace_path, "",
+            "Write a binary trace of all kernel calls to this file, for "
+            "decoding with xenia-kernel-call-trace-dump.",
+            "Kernel");
+DEFINE_path(kernel_export_stats_path, "",
+            "Write per-export kernel call counts (and latency histograms, if "
+            "enabled) to this file on exit. Written as JSON if the extension "
+            "is .json, otherwise CSV.",
+            "Kernel");
+DEFINE_bool(kernel_export_latency_histograms, false,
+            "Time every kernel call and record per-export latency histograms.",
+            "Kernel");
+DEFINE_bool(async_file_io, true,
+            "Complete overlapped file reads on host I/O threads instead of "
+            "blocking the guest thread that issued them.",
+            "Kernel");
+DEFINE_int32(async_file_io_threads, 4,
+             "Number of host threads performing overlapped file reads.",
+             "Kernel");
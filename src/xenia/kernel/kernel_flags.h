@@ -13,5 +13,10 @@
 
 DECLARE_bool(headless);
 DECLARE_bool(log_high_frequency_kernel_calls);
+DECLARE_path(kernel_call_trace_path);
+DECLARE_path(kernel_export_stats_path);
+DECLARE_bool(kernel_export_latency_histograms);
+DECLARE_bool(async_file_io);
+DECLARE_int32(async_file_io_threads);
 
 #endif  // XENIA_KERNEL_KERNEL_FLAGS_H_
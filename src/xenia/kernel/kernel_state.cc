@@ -9,6 +9,7 @@
 
 #include "xenia/kernel/kernel_state.h"
 
+#include <algorithm>
 #include <string>
 
 #include "third_party/fmt/include/fmt/format.h"
@@ -18,7 +19,10 @@
 #include "xenia/base/string.h"
 #include "xenia/cpu/processor.h"
 #include "xenia/emulator.h"
+#include "xenia/kernel/kernel_flags.h"
 #include "xenia/kernel/user_module.h"
+#include "xenia/kernel/util/kernel_call_trace.h"
+#include "xenia/kernel/util/kernel_export_stats.h"
 #include "xenia/kernel/util/shim_utils.h"
 #include "xenia/kernel/xam/xam_module.h"
 #include "xenia/kernel/xboxkrnl/xboxkrnl_module.h"
@@ -62,6 +66,17 @@ KernelState::KernelState(Emulator* emulator)
   tls_bitmap_.Resize(2048);
 
   xam::AppManager::RegisterApps(this, app_manager_.get());
+
+  util::KernelExportStats::Initialize(
+      cvars::kernel_export_latency_histograms);
+  if (!cvars::kernel_call_trace_path.empty()) {
+    util::KernelCallTracer::Initialize(cvars::kernel_call_trace_path);
+  }
+
+  if (cvars::async_file_io) {
+    file_io_pool_ = std::make_unique<util::FileIOPool>(
+        uint32_t(std::max(cvars::async_file_io_threads, 1)));
+  }
 }
 
 KernelState::~KernelState() {
@@ -73,6 +88,9 @@ KernelState::~KernelState() {
     dispatch_thread_->Wait(0, 0, 0, nullptr);
   }
 
+  // Finish the pending reads while the objects they reference still exist.
+  file_io_pool_.reset();
+
   executable_module_.reset();
   user_modules_.clear();
   kernel_modules_.clear();
@@ -83,6 +101,12 @@ KernelState::~KernelState() {
   // Shutdown apps.
   app_manager_.reset();
 
+  util::KernelCallTracer::Shutdown();
+  if (!cvars::kernel_export_stats_path.empty()) {
+    util::KernelExportStats::DumpReport(cvars::kernel_export_stats_path);
+  }
+  util::KernelExportStats::Shutdown();
+
   assert_true(shared_kernel_state_ == this);
   shared_kernel_state_ = nullptr;
 }
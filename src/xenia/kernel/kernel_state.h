@@ -21,6 +21,7 @@
 #include "xenia/base/cvar.h"
 #include "xenia/base/mutex.h"
 #include "xenia/cpu/export_resolver.h"
+#include "xenia/kernel/util/file_io_pool.h"
 #include "xenia/kernel/util/native_list.h"
 #include "xenia/kernel/util/object_table.h"
 #include "xenia/kernel/xam/app_manager.h"
@@ -176,6 +177,9 @@ class KernelState {
                                     uint32_t overlapped_ptr, X_RESULT result,
                                     uint32_t extended_error, uint32_t length);
 
+  // Null if overlapped file I/O is disabled.
+  util::FileIOPool* file_io_pool() const { return file_io_pool_.get(); }
+
   bool Save(ByteStream* stream);
   bool Restore(ByteStream* stream);
 
@@ -214,6 +218,8 @@ class KernelState {
   std::condition_variable_any dispatch_cond_;
   std::list<std::function<void()>> dispatch_queue_;
 
+  std::unique_ptr<util::FileIOPool> file_io_pool_;
+
   BitMap tls_bitmap_;
 
   friend class XObject;
@@ -21,3 +21,91 @@ project("xenia-kernel")
   files({
     "debug_visualizers.natvis",
   })
+
+project("xenia-kernel-call-trace-dump")
+  uuid("6b1d8f0a-3c52-4f8e-9a6e-2d7c41b5e903")
+  kind("ConsoleApp")
+  language("C++")
+  links({
+    "fmt",
+    "xenia-base",
+  })
+  defines({})
+
+  files({
+    "util/kernel_call_trace_dump_main.cc",
+    project_root.."/src/xenia/base/main_"..platform_suffix..".cc",
+  })
+  resincludedirs({
+    project_root,
+  })
+
+project("xenia-kernel-file-io-bench")
+  uuid("3f8c2a71-9d4e-4b6a-a1f5-7e0b52c9d8e4")
+  kind("ConsoleApp")
+  language("C++")
+  links({
+    "fmt",
+    "xenia-base",
+    "xenia-kernel",
+  })
+  defines({})
+
+  files({
+    "util/file_io_bench_main.cc",
+    project_root.."/src/xenia/base/main_"..platform_suffix..".cc",
+  })
+  resincludedirs({
+    project_root,
+  })
+
+project("xenia-kernel-event-bench")
+  uuid("c7e2a95d-41b8-4f3a-8d6c-0b93f5e1a274")
+  kind("ConsoleApp")
+  language("C++")
+  links({
+    "aes_128",
+    "capstone",
+    "fmt",
+    "glslang-spirv",
+    "imgui",
+    "libavcodec",
+    "libavutil",
+    "mspack",
+    "snappy",
+    "spirv-tools",
+    "volk",
+    "xenia-apu",
+    "xenia-apu-nop",
+    "xenia-base",
+    "xenia-core",
+    "xenia-cpu",
+    "xenia-cpu-backend-x64",
+    "xenia-gpu",
+    "xenia-gpu-null",
+    "xenia-hid",
+    "xenia-hid-nop",
+    "xenia-kernel",
+    "xenia-ui",
+    "xenia-ui-spirv",
+    "xenia-ui-vulkan",
+    "xenia-vfs",
+    "xxhash",
+  })
+  defines({})
+
+  files({
+    "xboxkrnl/xboxkrnl_event_bench_main.cc",
+    project_root.."/src/xenia/base/main_"..platform_suffix..".cc",
+  })
+  resincludedirs({
+    project_root,
+  })
+
+  filter("platforms:Linux")
+    links({
+      "X11",
+      "xcb",
+      "X11-xcb",
+      "vulkan",
+    })
@@ -0,0 +1,198 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "third_party/fmt/include/fmt/format.h"
+#include "xenia/base/clock.h"
+#include "xenia/base/cvar.h"
+#include "xenia/base/filesystem.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/main.h"
+#include "xenia/kernel/util/file_io_pool.h"
+
+DEFINE_path(bench_file, "",
+            "File to stream. If empty, a temporary file of "
+            "bench_file_megabytes is created and deleted afterwards.",
+            "General");
+DEFINE_int32(bench_file_megabytes, 256,
+             "Size of the temporary file to stream, in megabytes.", "General");
+DEFINE_int32(bench_read_kilobytes, 64, "Size of each read, in kilobytes.",
+             "General");
+DEFINE_int32(bench_queue_depth, 8,
+             "Number of overlapped reads kept in flight.", "General");
+DEFINE_int32(bench_work_us, 0,
+             "CPU time spent consuming each read chunk on the issuing thread, "
+             "like a title decoding streamed data, in microseconds.",
+             "General");
+DEFINE_int32(bench_io_threads, -1,
+             "Number of FileIOPool threads to stream with, 0 for synchronous "
+             "reads on the issuing thread, or -1 to run 0, 1, 2 and 4.",
+             "General");
+
+namespace xe {
+namespace kernel {
+namespace util {
+
+// Streams a file in fixed size chunks the way a title streaming assets with
+// NtReadFile does: either with synchronous reads on the issuing thread, or
+// with overlapped reads completed by a FileIOPool, keeping a number of them in
+// flight while the issuing thread consumes finished chunks in order.
+class FileIOBench {
+ public:
+  int Main(const std::vector<std::string>& args);
+
+ private:
+  // Returns the time taken to stream the whole file, in seconds.
+  double Stream(uint32_t thread_count);
+  void Consume();
+
+  std::unique_ptr<xe::filesystem::FileHandle> file_;
+  size_t file_size_ = 0;
+  size_t read_size_ = 0;
+};
+
+int FileIOBench::Main(const std::vector<std::string>& args) {
+  read_size_ = size_t(std::max(cvars::bench_read_kilobytes, 1)) * 1024;
+  std::filesystem::path path = cvars::bench_file;
+  bool temporary = path.empty();
+  if (temporary) {
+    path = std::filesystem::temp_directory_path() / "xenia-file-io-bench.bin";
+    FILE* file = xe::filesystem::OpenFile(path, "wb");
+    if (!file) {
+      XELOGE("Unable to create {}", xe::path_to_utf8(path));
+      return 1;
+    }
+    std::vector<uint8_t> chunk(1024 * 1024);
+    for (size_t i = 0; i < chunk.size(); ++i) {
+      chunk[i] = uint8_t(i * 7);
+    }
+    for (int32_t i = 0; i < cvars::bench_file_megabytes; ++i) {
+      fwrite(chunk.data(), 1, chunk.size(), file);
+    }
+    fclose(file);
+  }
+  file_ = xe::filesystem::FileHandle::OpenExisting(
+      path, xe::filesystem::FileAccess::kGenericRead);
+  if (!file_) {
+    XELOGE("Unable to open {}", xe::path_to_utf8(path));
+    return 1;
+  }
+  file_size_ = size_t(std::filesystem::file_size(path));
+
+  fmt::print("streaming {:.1f} MB in {} KB reads, {} in flight, {} us work\n",
+             file_size_ / (1024.0 * 1024.0), read_size_ / 1024,
+             cvars::bench_queue_depth, cvars::bench_work_us);
+  fmt::print("{:>8} {:>10} {:>10}\n", "threads", "ms", "MB/s");
+  std::vector<uint32_t> thread_counts;
+  if (cvars::bench_io_threads >= 0) {
+    thread_counts.push_back(uint32_t(cvars::bench_io_threads));
+  } else {
+    thread_counts = {0, 1, 2, 4};
+  }
+  for (uint32_t thread_count : thread_counts) {
+    double seconds = Stream(thread_count);
+    fmt::print("{:>8} {:>10.1f} {:>10.1f}\n", thread_count, seconds * 1000.0,
+               file_size_ / (1024.0 * 1024.0) / seconds);
+  }
+
+  file_.reset();
+  if (temporary) {
+    std::filesystem::remove(path);
+  }
+  return 0;
+}
+
+double FileIOBench::Stream(uint32_t thread_count) {
+  uint32_t queue_depth = uint32_t(std::max(cvars::bench_queue_depth, 1));
+  size_t chunk_count = (file_size_ + read_size_ - 1) / read_size_;
+  std::vector<std::vector<uint8_t>> buffers(queue_depth);
+  for (auto& buffer : buffers) {
+    buffer.resize(read_size_);
+  }
+
+  uint64_t start_ticks = Clock::QueryHostTickCount();
+  if (!thread_count) {
+    for (size_t i = 0; i < chunk_count; ++i) {
+      size_t offset = i * read_size_;
+      size_t bytes_read;
+      file_->Read(offset, buffers[0].data(),
+                  std::min(read_size_, file_size_ - offset), &bytes_read);
+      Consume();
+    }
+  } else {
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::vector<bool> completed(chunk_count, false);
+    {
+      FileIOPool pool(thread_count);
+      auto queue_read = [&](size_t i) {
+        pool.Queue([&, i]() -> uint32_t {
+          size_t offset = i * read_size_;
+          size_t bytes_read = 0;
+          file_->Read(offset, buffers[i % queue_depth].data(),
+                      std::min(read_size_, file_size_ - offset), &bytes_read);
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            completed[i] = true;
+          }
+          cond.notify_one();
+          return uint32_t(bytes_read);
+        });
+      };
+      size_t next_queued = 0;
+      for (; next_queued < std::min(size_t(queue_depth), chunk_count);
+           ++next_queued) {
+        queue_read(next_queued);
+      }
+      for (size_t i = 0; i < chunk_count; ++i) {
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          cond.wait(lock, [&]() { return bool(completed[i]); });
+        }
+        Consume();
+        // The buffer of this chunk is free again.
+        if (next_queued < chunk_count) {
+          queue_read(next_queued++);
+        }
+      }
+    }
+  }
+  return double(Clock::QueryHostTickCount() - start_ticks) /
+         double(Clock::QueryHostTickFrequency());
+}
+
+void FileIOBench::Consume() {
+  if (cvars::bench_work_us <= 0) {
+    return;
+  }
+  uint64_t end_ticks = Clock::QueryHostTickCount() +
+                       Clock::QueryHostTickFrequency() *
+                           uint64_t(cvars::bench_work_us) / 1000000;
+  while (Clock::QueryHostTickCount() < end_ticks) {
+  }
+}
+
+int file_io_bench_main(const std::vector<std::string>& args) {
+  FileIOBench bench;
+  return bench.Main(args);
+}
+
+}  // namespace util
+}  // namespace kernel
+}  // namespace xe
+
+DEFINE_ENTRY_POINT("xenia-kernel-file-io-bench",
+                   xe::kernel::util::file_io_bench_main,
+                   "[--bench_file=path] [--bench_io_threads=N]");
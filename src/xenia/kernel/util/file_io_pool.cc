@@ -0,0 +1,101 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/kernel/util/file_io_pool.h"
+
+#include <algorithm>
+
+#include "xenia/base/clock.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/threading.h"
+
+namespace xe {
+namespace kernel {
+namespace util {
+
+FileIOPool::FileIOPool(uint32_t thread_count) {
+  thread_count = std::max(thread_count, uint32_t(1));
+  for (uint32_t i = 0; i < thread_count; ++i) {
+    threads_.emplace_back([this]() {
+      xe::threading::set_name("Kernel File I/O");
+      WorkerThread();
+    });
+  }
+}
+
+FileIOPool::~FileIOPool() {
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    shutdown_ = true;
+  }
+  work_cond_.notify_all();
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+  threads_.clear();
+
+  if (completed_count_) {
+    double ms_per_tick = 1000.0 / double(Clock::QueryHostTickFrequency());
+    double active_seconds =
+        (last_completion_ticks_ - first_queue_ticks_) * ms_per_tick / 1000.0;
+    XELOGI(
+        "Overlapped file I/O: {} requests, {:.2f} MB, {:.2f} MB/s while "
+        "active, latency mean {:.3f} ms, max {:.3f} ms",
+        completed_count_, completed_bytes_ / (1024.0 * 1024.0),
+        active_seconds > 0.0
+            ? completed_bytes_ / (1024.0 * 1024.0) / active_seconds
+            : 0.0,
+        total_latency_ticks_ * ms_per_tick / completed_count_,
+        max_latency_ticks_ * ms_per_tick);
+  }
+}
+
+void FileIOPool::Queue(std::function<uint32_t()> request) {
+  uint64_t queue_ticks = Clock::QueryHostTickCount();
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    if (!first_queue_ticks_) {
+      first_queue_ticks_ = queue_ticks;
+    }
+    queue_.push_back({std::move(request), queue_ticks});
+  }
+  work_cond_.notify_one();
+}
+
+void FileIOPool::WorkerThread() {
+  while (true) {
+    Request request;
+    {
+      std::unique_lock<std::mutex> lock(lock_);
+      work_cond_.wait(lock, [this]() { return shutdown_ || !queue_.empty(); });
+      // Requests still queued on shutdown are completed, as the guest may be
+      // waiting for them.
+      if (queue_.empty()) {
+        break;
+      }
+      request = std::move(queue_.front());
+      queue_.pop_front();
+    }
+
+    uint32_t bytes = request.function();
+
+    uint64_t completion_ticks = Clock::QueryHostTickCount();
+    uint64_t latency_ticks = completion_ticks - request.queue_ticks;
+    std::lock_guard<std::mutex> lock(lock_);
+    ++completed_count_;
+    completed_bytes_ += bytes;
+    total_latency_ticks_ += latency_ticks;
+    max_latency_ticks_ = std::max(max_latency_ticks_, latency_ticks);
+    last_completion_ticks_ = std::max(last_completion_ticks_, completion_ticks);
+  }
+}
+
+}  // namespace util
+}  // namespace kernel
+}  // namespace xe
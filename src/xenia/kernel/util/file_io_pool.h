@@ -0,0 +1,65 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_KERNEL_UTIL_FILE_IO_POOL_H_
+#define XENIA_KERNEL_UTIL_FILE_IO_POOL_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace xe {
+namespace kernel {
+namespace util {
+
+// Host threads performing overlapped file I/O requested by guest threads, so
+// that the guest keeps running while the data is read. Requests may complete
+// in any order.
+class FileIOPool {
+ public:
+  explicit FileIOPool(uint32_t thread_count);
+  // Completes all queued requests before returning.
+  ~FileIOPool();
+
+  // The request returns the number of bytes transferred.
+  void Queue(std::function<uint32_t()> request);
+
+ private:
+  struct Request {
+    std::function<uint32_t()> function;
+    uint64_t queue_ticks;
+  };
+
+  void WorkerThread();
+
+  std::mutex lock_;
+  std::condition_variable work_cond_;
+  std::deque<Request> queue_;
+  bool shutdown_ = false;
+  std::vector<std::thread> threads_;
+
+  // Statistics logged on shutdown, guarded by lock_.
+  uint64_t completed_count_ = 0;
+  uint64_t completed_bytes_ = 0;
+  uint64_t total_latency_ticks_ = 0;
+  uint64_t max_latency_ticks_ = 0;
+  uint64_t first_queue_ticks_ = 0;
+  uint64_t last_completion_ticks_ = 0;
+};
+
+}  // namespace util
+}  // namespace kernel
+}  // namespace xe
+
+#endif  // XENIA_KERNEL_UTIL_FILE_IO_POOL_H_
@@ -0,0 +1,219 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/kernel/util/kernel_call_trace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "xenia/base/assert.h"
+#include "xenia/base/clock.h"
+#include "xenia/base/filesystem.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/threading.h"
+
+namespace xe {
+namespace kernel {
+namespace util {
+
+namespace {
+
+// Must be a power of two.
+constexpr uint64_t kRingRecordCount = 4096;
+constexpr uint64_t kRingIndexMask = kRingRecordCount - 1;
+// Rings of exited threads kept for new threads, the rest are freed.
+constexpr size_t kMaxFreeRingCount = 16;
+
+// Single-producer (the owning thread), single-consumer (the writer thread).
+struct ThreadRing {
+  std::atomic<uint64_t> write_index = {0};
+  std::atomic<uint64_t> read_index = {0};
+  // Set when the owning thread exits, after its last record.
+  std::atomic<bool> released = {false};
+  KernelCallTraceRecord records[kRingRecordCount];
+};
+
+// Releases the thread's ring when the thread exits. The writer thread drains
+// released rings one last time and then recycles or frees them.
+struct ThreadRingOwner {
+  ThreadRing* ring = nullptr;
+  ~ThreadRingOwner() {
+    if (ring) {
+      ring->released.store(true, std::memory_order_release);
+    }
+  }
+};
+
+std::mutex rings_mutex_;
+std::vector<std::unique_ptr<ThreadRing>> rings_;
+std::vector<std::unique_ptr<ThreadRing>> free_rings_;
+thread_local ThreadRingOwner thread_ring_;
+
+FILE* file_ = nullptr;
+std::thread writer_thread_;
+std::atomic<bool> running_ = {false};
+std::atomic<uint64_t> dropped_count_ = {0};
+
+ThreadRing* GetThreadRing() {
+  if (!thread_ring_.ring) {
+    std::unique_ptr<ThreadRing> ring;
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    if (!free_rings_.empty()) {
+      ring = std::move(free_rings_.back());
+      free_rings_.pop_back();
+      ring->write_index = 0;
+      ring->read_index = 0;
+      ring->released = false;
+    } else {
+      ring = std::make_unique<ThreadRing>();
+    }
+    thread_ring_.ring = ring.get();
+    rings_.push_back(std::move(ring));
+  }
+  return thread_ring_.ring;
+}
+
+// Writes all pending records to the file. Returns the number written.
+size_t DrainRings() {
+  size_t total_count = 0;
+  std::lock_guard<std::mutex> lock(rings_mutex_);
+  for (size_t i = 0; i < rings_.size();) {
+    auto& ring = rings_[i];
+    // Checked first so that the thread's last records are seen below.
+    bool released = ring->released.load(std::memory_order_acquire);
+    uint64_t read_index = ring->read_index.load(std::memory_order_relaxed);
+    uint64_t write_index = ring->write_index.load(std::memory_order_acquire);
+    while (read_index < write_index) {
+      // Write in at most two contiguous runs around the wrap point.
+      uint64_t offset = read_index & kRingIndexMask;
+      uint64_t count =
+          std::min(write_index - read_index, kRingRecordCount - offset);
+      fwrite(&ring->records[offset], sizeof(KernelCallTraceRecord),
+             size_t(count), file_);
+      read_index += count;
+      total_count += size_t(count);
+    }
+    ring->read_index.store(read_index, std::memory_order_release);
+    if (released) {
+      if (free_rings_.size() < kMaxFreeRingCount) {
+        free_rings_.push_back(std::move(ring));
+      }
+      std::swap(ring, rings_.back());
+      rings_.pop_back();
+      continue;
+    }
+    ++i;
+  }
+  return total_count;
+}
+
+void WriterThread() {
+  while (running_) {
+    if (!DrainRings()) {
+      xe::threading::Sleep(std::chrono::milliseconds(10));
+    }
+  }
+}
+
+}  // namespace
+
+std::atomic<bool> KernelCallTracer::enabled_ = {false};
+
+bool KernelCallTracer::Initialize(const std::filesystem::path& path) {
+  assert_false(is_enabled());
+
+  xe::filesystem::CreateParentFolder(path);
+  file_ = xe::filesystem::OpenFile(path, "wb");
+  if (!file_) {
+    XELOGE("Failed to open kernel call trace file {}", xe::path_to_utf8(path));
+    return false;
+  }
+
+  KernelCallTraceHeader header;
+  header.magic = kKernelCallTraceMagic;
+  header.version = kKernelCallTraceVersion;
+  header.tick_frequency = Clock::QueryHostTickFrequency();
+  fwrite(&header, sizeof(header), 1, file_);
+
+  {
+    // Discard anything left over from a previous session.
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    for (auto& ring : rings_) {
+      ring->read_index = ring->write_index.load();
+    }
+  }
+  dropped_count_ = 0;
+
+  running_ = true;
+  writer_thread_ = std::thread([]() {
+    xe::threading::set_name("Kernel Call Trace Writer");
+    WriterThread();
+  });
+
+  enabled_ = true;
+  XELOGI("Tracing kernel calls to {}", xe::path_to_utf8(path));
+  return true;
+}
+
+void KernelCallTracer::Shutdown() {
+  if (!file_) {
+    return;
+  }
+  enabled_ = false;
+
+  running_ = false;
+  writer_thread_.join();
+
+  DrainRings();
+  fclose(file_);
+  file_ = nullptr;
+
+  if (dropped_count_) {
+    XELOGW("Kernel call trace dropped {} records", dropped_count_.load());
+  }
+}
+
+void KernelCallTracer::BeginRecord(KernelCallTraceRecord* record,
+                                   uint16_t module_id, uint16_t ordinal,
+                                   cpu::ppc::PPCContext* ppc_context,
+                                   size_t arg_count) {
+  record->thread_id = xe::threading::current_thread_id();
+  record->module_id = module_id;
+  record->ordinal = ordinal;
+  record->arg_count = uint32_t(arg_count);
+  record->reserved = 0;
+  for (uint32_t i = 0; i < kKernelCallTraceMaxArgs; ++i) {
+    record->args[i] = i < arg_count ? ppc_context->r[3 + i] : 0;
+  }
+  record->start_ticks = Clock::QueryHostTickCount();
+}
+
+void KernelCallTracer::EndRecord(KernelCallTraceRecord* record,
+                                 uint64_t result) {
+  record->end_ticks = Clock::QueryHostTickCount();
+  record->result = result;
+
+  auto ring = GetThreadRing();
+  uint64_t write_index = ring->write_index.load(std::memory_order_relaxed);
+  uint64_t read_index = ring->read_index.load(std::memory_order_acquire);
+  if (write_index - read_index >= kRingRecordCount) {
+    ++dropped_count_;
+    return;
+  }
+  ring->records[write_index & kRingIndexMask] = *record;
+  ring->write_index.store(write_index + 1, std::memory_order_release);
+}
+
+}  // namespace util
+}  // namespace kernel
+}  // namespace xe
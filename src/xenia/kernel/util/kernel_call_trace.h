@@ -0,0 +1,86 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_KERNEL_UTIL_KERNEL_CALL_TRACE_H_
+#define XENIA_KERNEL_UTIL_KERNEL_CALL_TRACE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+
+#include "xenia/cpu/ppc/ppc_context.h"
+
+namespace xe {
+namespace kernel {
+namespace util {
+
+// Binary kernel call traces, written when --kernel_call_trace_path is set and
+// decoded offline with xenia-kernel-call-trace-dump.
+//
+// File layout: a KernelCallTraceHeader followed by KernelCallTraceRecords in
+// the order they were flushed. Records from one thread are in call order, but
+// records from different threads are interleaved in batches; sort by
+// start_ticks to get a global order.
+constexpr uint32_t kKernelCallTraceMagic = 'XKCT';
+constexpr uint32_t kKernelCallTraceVersion = 1;
+constexpr uint32_t kKernelCallTraceMaxArgs = 8;
+
+struct KernelCallTraceHeader {
+  uint32_t magic;
+  uint32_t version;
+  // Frequency of the host tick counter used for the record timestamps.
+  uint64_t tick_frequency;
+};
+static_assert(sizeof(KernelCallTraceHeader) == 16, "Must be fixed size");
+
+struct KernelCallTraceRecord {
+  uint64_t start_ticks;
+  uint64_t end_ticks;
+  uint32_t thread_id;
+  // shim::KernelModuleId of the export.
+  uint16_t module_id;
+  uint16_t ordinal;
+  // Raw register values of the first arguments (r3-r10).
+  uint64_t args[kKernelCallTraceMaxArgs];
+  // r3 after the call, or 0 for exports returning void.
+  uint64_t result;
+  uint32_t arg_count;
+  uint32_t reserved;
+};
+static_assert(sizeof(KernelCallTraceRecord) == 104, "Must be fixed size");
+
+// Collects kernel call records from the shim trampolines.
+// Each thread appends to its own single-producer ring buffer without locking;
+// a writer thread drains all of the rings to the trace file in the background.
+// Records are dropped (and counted) if a ring fills up before it's drained.
+class KernelCallTracer {
+ public:
+  static bool Initialize(const std::filesystem::path& path);
+  static void Shutdown();
+
+  static bool is_enabled() {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  // Fills in the call information known before the export runs.
+  static void BeginRecord(KernelCallTraceRecord* record, uint16_t module_id,
+                          uint16_t ordinal, cpu::ppc::PPCContext* ppc_context,
+                          size_t arg_count);
+  // Timestamps the end of the call and queues the record for writing.
+  static void EndRecord(KernelCallTraceRecord* record, uint64_t result);
+
+ private:
+  static std::atomic<bool> enabled_;
+};
+
+}  // namespace util
+}  // namespace kernel
+}  // namespace xe
+
+#endif  // XENIA_KERNEL_UTIL_KERNEL_CALL_TRACE_H_
@@ -0,0 +1,218 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "third_party/fmt/include/fmt/format.h"
+#include "xenia/base/filesystem.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/main.h"
+#include "xenia/base/math.h"
+#include "xenia/kernel/util/kernel_call_trace.h"
+
+DEFINE_transient_path(
+    trace_file, "", "Kernel call trace written with --kernel_call_trace_path.",
+    "General");
+DEFINE_bool(histogram, false,
+            "Print per-export call counts and latency histograms instead of "
+            "the individual calls.",
+            "General");
+
+namespace xe {
+namespace kernel {
+namespace util {
+
+struct ExportName {
+  uint16_t ordinal;
+  const char* name;
+};
+
+#define XE_EXPORT(module, ordinal, name, type) {ordinal, #name}
+static const ExportName xboxkrnl_export_names[] = {
+#include "xenia/kernel/xboxkrnl/xboxkrnl_table.inc"
+};
+static const ExportName xam_export_names[] = {
+#include "xenia/kernel/xam/xam_table.inc"
+};
+static const ExportName xbdm_export_names[] = {
+#include "xenia/kernel/xbdm/xbdm_table.inc"
+};
+#undef XE_EXPORT
+
+// Indexed by shim::KernelModuleId.
+static const char* const module_names[] = {"xboxkrnl", "xam", "xbdm"};
+
+class ExportNameTable {
+ public:
+  ExportNameTable() {
+    Add(0, xboxkrnl_export_names, xe::countof(xboxkrnl_export_names));
+    Add(1, xam_export_names, xe::countof(xam_export_names));
+    Add(2, xbdm_export_names, xe::countof(xbdm_export_names));
+  }
+
+  std::string Lookup(uint16_t module_id, uint16_t ordinal) const {
+    const char* module_name =
+        module_id < xe::countof(module_names) ? module_names[module_id] : "?";
+    auto it = names_.find(Key(module_id, ordinal));
+    if (it == names_.end()) {
+      return fmt::format("{}!ordinal_{:04X}", module_name, ordinal);
+    }
+    return fmt::format("{}!{}", module_name, it->second);
+  }
+
+ private:
+  static uint32_t Key(uint16_t module_id, uint16_t ordinal) {
+    return (uint32_t(module_id) << 16) | ordinal;
+  }
+  void Add(uint16_t module_id, const ExportName* names, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      names_.emplace(Key(module_id, names[i].ordinal), names[i].name);
+    }
+  }
+
+  std::unordered_map<uint32_t, const char*> names_;
+};
+
+static void PrintCalls(const ExportNameTable& export_names,
+                       const std::vector<KernelCallTraceRecord>& records,
+                       double ticks_to_us) {
+  uint64_t base_ticks = records.empty() ? 0 : records.front().start_ticks;
+  for (auto& record : records) {
+    std::string args;
+    for (uint32_t i = 0;
+         i < std::min(record.arg_count, kKernelCallTraceMaxArgs); ++i) {
+      args += fmt::format(i ? ", {:08X}" : "{:08X}", record.args[i]);
+    }
+    fmt::print("{:14.3f} {:08X} {}({}) = {:08X} [{:.3f}us]\n",
+               (record.start_ticks - base_ticks) * ticks_to_us,
+               record.thread_id,
+               export_names.Lookup(record.module_id, record.ordinal), args,
+               uint32_t(record.result),
+               (record.end_ticks - record.start_ticks) * ticks_to_us);
+  }
+}
+
+static void PrintHistograms(const ExportNameTable& export_names,
+                            const std::vector<KernelCallTraceRecord>& records,
+                            double ticks_to_us) {
+  // Power-of-two microsecond buckets: <1us, <2us, <4us, ... , >=2^14us.
+  constexpr size_t kBucketCount = 16;
+  struct ExportStats {
+    std::string name;
+    std::vector<double> durations_us;
+    double total_us = 0.0;
+    uint64_t buckets[kBucketCount] = {};
+  };
+  std::unordered_map<uint32_t, ExportStats> stats_map;
+  for (auto& record : records) {
+    auto& stats =
+        stats_map[(uint32_t(record.module_id) << 16) | record.ordinal];
+    if (stats.name.empty()) {
+      stats.name = export_names.Lookup(record.module_id, record.ordinal);
+    }
+    double duration_us = (record.end_ticks - record.start_ticks) * ticks_to_us;
+    stats.durations_us.push_back(duration_us);
+    stats.total_us += duration_us;
+    size_t bucket = 0;
+    while (bucket < kBucketCount - 1 && duration_us >= double(1ull << bucket)) {
+      ++bucket;
+    }
+    ++stats.buckets[bucket];
+  }
+
+  std::vector<ExportStats*> sorted_stats;
+  for (auto& it : stats_map) {
+    sorted_stats.push_back(&it.second);
+  }
+  std::sort(sorted_stats.begin(), sorted_stats.end(),
+            [](const ExportStats* a, const ExportStats* b) {
+              return a->total_us > b->total_us;
+            });
+
+  fmt::print("{:<48} {:>10} {:>12} {:>10} {:>10} {:>10} {:>10} {:>10}\n",
+             "export", "calls", "total ms", "mean us", "p50 us", "p90 us",
+             "p99 us", "max us");
+  for (auto stats : sorted_stats) {
+    auto& durations = stats->durations_us;
+    std::sort(durations.begin(), durations.end());
+    auto percentile = [&durations](double p) {
+      return durations[std::min(durations.size() - 1,
+                                size_t(p * durations.size()))];
+    };
+    fmt::print(
+        "{:<48} {:>10} {:>12.3f} {:>10.3f} {:>10.3f} {:>10.3f} {:>10.3f} "
+        "{:>10.3f}\n",
+        stats->name, durations.size(), stats->total_us / 1000.0,
+        stats->total_us / durations.size(), percentile(0.5), percentile(0.9),
+        percentile(0.99), durations.back());
+    std::string histogram;
+    for (size_t i = 0; i < kBucketCount; ++i) {
+      histogram += fmt::format(" {}", stats->buckets[i]);
+    }
+    fmt::print("{:<48} log2(us) buckets:{}\n", "", histogram);
+  }
+}
+
+int kernel_call_trace_dump_main(const std::vector<std::string>& args) {
+  if (cvars::trace_file.empty()) {
+    XELOGE("Usage: {} [--histogram] [trace_file]", xe::path_to_utf8(args[0]));
+    return 1;
+  }
+
+  auto file = xe::filesystem::OpenFile(cvars::trace_file, "rb");
+  if (!file) {
+    XELOGE("Failed to open {}", xe::path_to_utf8(cvars::trace_file));
+    return 1;
+  }
+
+  KernelCallTraceHeader header;
+  if (fread(&header, sizeof(header), 1, file) != 1 ||
+      header.magic != kKernelCallTraceMagic ||
+      header.version != kKernelCallTraceVersion) {
+    XELOGE("{} is not a supported kernel call trace",
+           xe::path_to_utf8(cvars::trace_file));
+    fclose(file);
+    return 1;
+  }
+
+  std::vector<KernelCallTraceRecord> records;
+  KernelCallTraceRecord record;
+  while (fread(&record, sizeof(record), 1, file) == 1) {
+    records.push_back(record);
+  }
+  fclose(file);
+
+  // Records are flushed per thread in batches; restore the global order.
+  std::stable_sort(records.begin(), records.end(),
+                   [](const KernelCallTraceRecord& a,
+                      const KernelCallTraceRecord& b) {
+                     return a.start_ticks < b.start_ticks;
+                   });
+
+  ExportNameTable export_names;
+  double ticks_to_us = 1000000.0 / double(header.tick_frequency);
+  if (cvars::histogram) {
+    PrintHistograms(export_names, records, ticks_to_us);
+  } else {
+    PrintCalls(export_names, records, ticks_to_us);
+  }
+  return 0;
+}
+
+}  // namespace util
+}  // namespace kernel
+}  // namespace xe
+
+DEFINE_ENTRY_POINT("xenia-kernel-call-trace-dump",
+                   xe::kernel::util::kernel_call_trace_dump_main,
+                   "[--histogram] [trace_file]", "trace_file");
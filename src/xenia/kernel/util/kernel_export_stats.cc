@@ -0,0 +1,216 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/kernel/util/kernel_export_stats.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include "third_party/fmt/include/fmt/format.h"
+#include "xenia/base/assert.h"
+#include "xenia/base/clock.h"
+#include "xenia/base/filesystem.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/math.h"
+#include "xenia/base/string.h"
+#include "xenia/base/utf8.h"
+
+namespace xe {
+namespace kernel {
+namespace util {
+
+namespace {
+
+struct ExportSlot {
+  cpu::Export* export_entry;
+  uint16_t module_id;
+};
+
+struct alignas(64) Shard {
+  std::atomic<uint64_t> call_counts[KernelExportStats::kMaxExports];
+  std::atomic<uint64_t> total_ticks[KernelExportStats::kMaxExports];
+};
+
+// Indexed by shim::KernelModuleId.
+const char* const module_names_[] = {"xboxkrnl", "xam", "xbdm"};
+
+// Plain zero-initialized globals, so slots can be registered at any point
+// relative to Initialize.
+ExportSlot export_slots_[KernelExportStats::kMaxExports];
+std::atomic<uint32_t> export_slot_count_;
+Shard shards_[KernelExportStats::kShardCount];
+std::atomic<uint32_t> next_shard_index_;
+thread_local uint32_t shard_index_ = UINT32_MAX;
+
+// [shard][slot][bucket], allocated on first Initialize with histograms on and
+// kept for the life of the process as trampolines may still be using it.
+std::unique_ptr<std::atomic<uint64_t>[]> histograms_;
+double ns_per_tick_ = 0.0;
+
+Shard& GetShard() {
+  if (shard_index_ == UINT32_MAX) {
+    shard_index_ = next_shard_index_++ % KernelExportStats::kShardCount;
+  }
+  return shards_[shard_index_];
+}
+
+std::atomic<uint64_t>* GetHistogram(uint32_t shard_index, uint32_t slot) {
+  return &histograms_[(size_t(shard_index) * KernelExportStats::kMaxExports +
+                       slot) *
+                      KernelExportStats::kHistogramBucketCount];
+}
+
+}  // namespace
+
+std::atomic<bool> KernelExportStats::timing_enabled_;
+
+uint32_t KernelExportStats::RegisterExport(cpu::Export* export_entry,
+                                           uint16_t module_id) {
+  uint32_t slot = export_slot_count_++;
+  if (slot >= kMaxExports) {
+    assert_always("Increase KernelExportStats::kMaxExports");
+    return kInvalidSlot;
+  }
+  export_slots_[slot].export_entry = export_entry;
+  export_slots_[slot].module_id = module_id;
+  return slot;
+}
+
+void KernelExportStats::Initialize(bool latency_histograms) {
+  ns_per_tick_ = 1000000000.0 / double(Clock::QueryHostTickFrequency());
+  if (latency_histograms && !histograms_) {
+    size_t histogram_size =
+        size_t(kShardCount) * kMaxExports * kHistogramBucketCount;
+    histograms_ = std::make_unique<std::atomic<uint64_t>[]>(histogram_size);
+    for (size_t i = 0; i < histogram_size; ++i) {
+      histograms_[i].store(0, std::memory_order_relaxed);
+    }
+  }
+  timing_enabled_ = latency_histograms;
+}
+
+void KernelExportStats::Shutdown() { timing_enabled_ = false; }
+
+void KernelExportStats::RecordCall(uint32_t slot) {
+  if (slot == kInvalidSlot) {
+    return;
+  }
+  GetShard().call_counts[slot].fetch_add(1, std::memory_order_relaxed);
+}
+
+void KernelExportStats::RecordLatency(uint32_t slot, uint64_t host_ticks) {
+  if (slot == kInvalidSlot) {
+    return;
+  }
+  auto& shard = GetShard();
+  shard.total_ticks[slot].fetch_add(host_ticks, std::memory_order_relaxed);
+  uint64_t ns = uint64_t(host_ticks * ns_per_tick_);
+  uint32_t bucket = ns ? 64 - xe::lzcnt(ns) : 0;
+  bucket = std::min(bucket, kHistogramBucketCount - 1);
+  GetHistogram(shard_index_, slot)[bucket].fetch_add(
+      1, std::memory_order_relaxed);
+}
+
+bool KernelExportStats::DumpReport(const std::filesystem::path& path) {
+  bool json = xe::utf8::lower_ascii(xe::path_to_utf8(path.extension())) ==
+              ".json";
+  bool has_timing = histograms_ != nullptr;
+
+  auto file = xe::filesystem::OpenFile(path, "wt");
+  if (!file) {
+    XELOGE("Failed to open kernel export stats file {}",
+           xe::path_to_utf8(path));
+    return false;
+  }
+
+  std::string out;
+  out += json ? "[\n" : "module,export,ordinal,calls,total_us,mean_us";
+  if (!json && has_timing) {
+    for (uint32_t i = 0; i < kHistogramBucketCount; ++i) {
+      out += fmt::format(",lt_{}ns", 1ull << i);
+    }
+  }
+  if (!json) {
+    out += "\n";
+  }
+
+  bool first = true;
+  uint32_t slot_count = std::min(export_slot_count_.load(), kMaxExports);
+  for (uint32_t slot = 0; slot < slot_count; ++slot) {
+    uint64_t calls = 0;
+    uint64_t total_ticks = 0;
+    uint64_t buckets[kHistogramBucketCount] = {};
+    for (uint32_t shard_index = 0; shard_index < kShardCount; ++shard_index) {
+      calls += shards_[shard_index].call_counts[slot].load(
+          std::memory_order_relaxed);
+      total_ticks += shards_[shard_index].total_ticks[slot].load(
+          std::memory_order_relaxed);
+      if (has_timing) {
+        auto histogram = GetHistogram(shard_index, slot);
+        for (uint32_t i = 0; i < kHistogramBucketCount; ++i) {
+          buckets[i] += histogram[i].load(std::memory_order_relaxed);
+        }
+      }
+    }
+    if (!calls) {
+      continue;
+    }
+
+    auto& export_slot = export_slots_[slot];
+    const char* module_name =
+        export_slot.module_id < xe::countof(module_names_)
+            ? module_names_[export_slot.module_id]
+            : "?";
+    double total_us = total_ticks * ns_per_tick_ / 1000.0;
+    double mean_us = total_us / calls;
+    if (json) {
+      out += fmt::format(
+          "{}  {{\"module\": \"{}\", \"export\": \"{}\", \"ordinal\": {}, "
+          "\"calls\": {}",
+          first ? "" : ",\n", module_name, export_slot.export_entry->name,
+          export_slot.export_entry->ordinal, calls);
+      if (has_timing) {
+        out += fmt::format(", \"total_us\": {:.3f}, \"mean_us\": {:.3f}",
+                           total_us, mean_us);
+        out += ", \"histogram_log2_ns\": [";
+        for (uint32_t i = 0; i < kHistogramBucketCount; ++i) {
+          out += fmt::format(i ? ", {}" : "{}", buckets[i]);
+        }
+        out += "]";
+      }
+      out += "}";
+    } else {
+      out += fmt::format("{},{},{},{},{:.3f},{:.3f}", module_name,
+                         export_slot.export_entry->name,
+                         export_slot.export_entry->ordinal, calls, total_us,
+                         mean_us);
+      if (has_timing) {
+        for (uint32_t i = 0; i < kHistogramBucketCount; ++i) {
+          out += fmt::format(",{}", buckets[i]);
+        }
+      }
+      out += "\n";
+    }
+    first = false;
+  }
+  if (json) {
+    out += "\n]\n";
+  }
+
+  fwrite(out.data(), 1, out.size(), file);
+  fclose(file);
+  XELOGI("Wrote kernel export stats to {}", xe::path_to_utf8(path));
+  return true;
+}
+
+}  // namespace util
+}  // namespace kernel
+}  // namespace xe
@@ -0,0 +1,62 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_KERNEL_UTIL_KERNEL_EXPORT_STATS_H_
+#define XENIA_KERNEL_UTIL_KERNEL_EXPORT_STATS_H_
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+
+#include "xenia/cpu/export_resolver.h"
+
+namespace xe {
+namespace kernel {
+namespace util {
+
+// Per-export call counters (always on) and latency histograms (enabled with
+// --kernel_export_latency_histograms), updated from the shim trampolines.
+// Counters are sharded per thread so that hot exports called from many
+// threads don't bounce a single cache line around; shards are summed when a
+// report is written.
+class KernelExportStats {
+ public:
+  static constexpr uint32_t kInvalidSlot = UINT32_MAX;
+  static constexpr uint32_t kMaxExports = 1024;
+  static constexpr uint32_t kShardCount = 16;
+  // Power-of-two nanosecond buckets: [0, 1), [1, 2), [2, 4), ... [2^30, inf).
+  static constexpr uint32_t kHistogramBucketCount = 32;
+
+  // Allocates a stats slot for the export. Called once per export when its
+  // shim is registered.
+  static uint32_t RegisterExport(cpu::Export* export_entry, uint16_t module_id);
+
+  static void Initialize(bool latency_histograms);
+  static void Shutdown();
+
+  static bool is_timing_enabled() {
+    return timing_enabled_.load(std::memory_order_relaxed);
+  }
+
+  static void RecordCall(uint32_t slot);
+  static void RecordLatency(uint32_t slot, uint64_t host_ticks);
+
+  // Writes all exports with at least one call to the given file, as JSON if
+  // the extension is .json and CSV otherwise.
+  static bool DumpReport(const std::filesystem::path& path);
+
+ private:
+  static std::atomic<bool> timing_enabled_;
+};
+
+}  // namespace util
+}  // namespace kernel
+}  // namespace xe
+
+#endif  // XENIA_KERNEL_UTIL_KERNEL_EXPORT_STATS_H_
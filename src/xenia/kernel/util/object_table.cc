@@ -28,18 +28,27 @@ ObjectTable::~ObjectTable() { Reset(); }
 void ObjectTable::Reset() {
   auto global_lock = global_critical_region_.Acquire();
 
-  // Release all objects.
-  for (uint32_t n = 0; n < table_capacity_; n++) {
-    ObjectTableEntry& entry = table_[n];
-    if (entry.object) {
-      entry.object->Release();
+  std::vector<XObject*> objects;
+  {
+    std::unique_lock<std::shared_mutex> table_lock(table_mutex_);
+    for (uint32_t n = 0; n < table_capacity_; n++) {
+      ObjectTableEntry& entry = table_[n];
+      if (entry.object) {
+        objects.push_back(entry.object);
+      }
     }
+
+    table_capacity_ = 0;
+    last_free_entry_ = 0;
+    free(table_);
+    table_ = nullptr;
   }
 
-  table_capacity_ = 0;
-  last_free_entry_ = 0;
-  free(table_);
-  table_ = nullptr;
+  // Release all objects, outside the table lock as destructors may look up
+  // other objects.
+  for (XObject* object : objects) {
+    object->Release();
+  }
 }
 
 X_STATUS ObjectTable::FindFreeSlot(uint32_t* out_slot) {
@@ -102,6 +111,7 @@ X_STATUS ObjectTable::AddHandle(XObject* object, X_HANDLE* out_handle) {
   uint32_t handle = 0;
   {
     auto global_lock = global_critical_region_.Acquire();
+    std::unique_lock<std::shared_mutex> table_lock(table_mutex_);
 
     // Find a free slot.
     uint32_t slot = 0;
@@ -185,15 +195,18 @@ X_STATUS ObjectTable::RemoveHandle(X_HANDLE handle) {
     return X_STATUS_INVALID_HANDLE;
   }
 
+  auto global_lock = global_critical_region_.Acquire();
   ObjectTableEntry* entry = LookupTable(handle);
   if (!entry) {
     return X_STATUS_INVALID_HANDLE;
   }
 
-  auto global_lock = global_critical_region_.Acquire();
   if (entry->object) {
     auto object = entry->object;
-    entry->object = nullptr;
+    {
+      std::unique_lock<std::shared_mutex> table_lock(table_mutex_);
+      entry->object = nullptr;
+    }
     assert_zero(entry->handle_ref_count);
     entry->handle_ref_count = 0;
 
@@ -231,15 +244,22 @@ std::vector<object_ref<XObject>> ObjectTable::GetAllObjects() {
 
 void ObjectTable::PurgeAllObjects() {
   auto lock = global_critical_region_.Acquire();
-  for (uint32_t slot = 0; slot < table_capacity_; slot++) {
-    auto& entry = table_[slot];
-    if (entry.object && !entry.object->is_host_object()) {
-      entry.handle_ref_count = 0;
-      entry.object->Release();
-
-      entry.object = nullptr;
+  std::vector<XObject*> objects;
+  {
+    std::unique_lock<std::shared_mutex> table_lock(table_mutex_);
+    for (uint32_t slot = 0; slot < table_capacity_; slot++) {
+      auto& entry = table_[slot];
+      if (entry.object && !entry.object->is_host_object()) {
+        entry.handle_ref_count = 0;
+        objects.push_back(entry.object);
+
+        entry.object = nullptr;
+      }
     }
   }
+  for (XObject* object : objects) {
+    object->Release();
+  }
 }
 
 ObjectTable::ObjectTableEntry* ObjectTable::LookupTable(X_HANDLE handle) {
@@ -274,8 +294,10 @@ XObject* ObjectTable::LookupObject(X_HANDLE handle, bool already_locked) {
   }
 
   XObject* object = nullptr;
+  // Holding the global lock already excludes changes to the table.
+  std::shared_lock<std::shared_mutex> table_lock(table_mutex_, std::defer_lock);
   if (!already_locked) {
-    global_critical_region_.mutex().lock();
+    table_lock.lock();
   }
 
   // Lower 2 bits are ignored.
@@ -289,15 +311,12 @@ XObject* ObjectTable::LookupObject(X_HANDLE handle, bool already_locked) {
     }
   }
 
-  // Retain the object pointer.
+  // Retain the object pointer while the table lock keeps RemoveHandle from
+  // releasing it.
   if (object) {
     object->Retain();
   }
 
-  if (!already_locked) {
-    global_critical_region_.mutex().unlock();
-  }
-
   return object;
 }
 
@@ -379,6 +398,8 @@ bool ObjectTable::Save(ByteStream* stream) {
 }
 
 bool ObjectTable::Restore(ByteStream* stream) {
+  auto global_lock = global_critical_region_.Acquire();
+  std::unique_lock<std::shared_mutex> table_lock(table_mutex_);
   Resize(stream->Read<uint32_t>());
   for (uint32_t i = 0; i < table_capacity_; i++) {
     auto& entry = table_[i];
@@ -390,6 +411,8 @@ bool ObjectTable::Restore(ByteStream* stream) {
 }
 
 X_STATUS ObjectTable::RestoreHandle(X_HANDLE handle, XObject* object) {
+  auto global_lock = global_critical_region_.Acquire();
+  std::unique_lock<std::shared_mutex> table_lock(table_mutex_);
   uint32_t slot = handle >> 2;
   assert_true(table_capacity_ >= slot);
 
@@ -10,6 +10,7 @@
 #ifndef XENIA_KERNEL_UTIL_OBJECT_TABLE_H_
 #define XENIA_KERNEL_UTIL_OBJECT_TABLE_H_
 
+#include <shared_mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -92,10 +93,16 @@ class ObjectTable {
                         std::vector<object_ref<XObject>>* results);
 
   X_HANDLE TranslateHandle(X_HANDLE handle);
+  // Both require the global lock and exclusive table_mutex_ to be held.
   X_STATUS FindFreeSlot(uint32_t* out_slot);
   bool Resize(uint32_t new_capacity);
 
   xe::global_critical_region global_critical_region_;
+  // Changes to table_, table_capacity_ and the entry objects are made with
+  // both the global lock and this held exclusively, so LookupObject, which is
+  // on the path of every Ke* call on a dispatcher object, only needs this
+  // shared.
+  std::shared_mutex table_mutex_;
   uint32_t table_capacity_ = 0;
   ObjectTableEntry* table_ = nullptr;
   uint32_t last_free_entry_ = 0;
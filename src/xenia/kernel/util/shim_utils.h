@@ -15,6 +15,7 @@
 
 #include "third_party/fmt/include/fmt/format.h"
 #include "xenia/base/byte_order.h"
+#include "xenia/base/clock.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/memory.h"
 #include "xenia/base/string_buffer.h"
@@ -22,6 +23,8 @@
 #include "xenia/cpu/ppc/ppc_context.h"
 #include "xenia/kernel/kernel_flags.h"
 #include "xenia/kernel/kernel_state.h"
+#include "xenia/kernel/util/kernel_call_trace.h"
+#include "xenia/kernel/util/kernel_export_stats.h"
 
 namespace xe {
 namespace kernel {
@@ -514,9 +517,12 @@ xe::cpu::Export* RegisterExport(R (*fn)(Ps&...), const char* name,
       ORDINAL, xe::cpu::Export::Type::kFunction, name,
       tags | xe::cpu::ExportTag::kImplemented | xe::cpu::ExportTag::kLog);
   static R (*FN)(Ps & ...) = fn;
+  static const uint32_t stats_slot =
+      util::KernelExportStats::RegisterExport(export_entry, uint16_t(MODULE));
   struct X {
     static void Trampoline(PPCContext* ppc_context) {
       ++export_entry->function_data.call_count;
+      util::KernelExportStats::RecordCall(stats_slot);
       Param::Init init = {
           ppc_context,
           sizeof...(Ps),
@@ -528,10 +534,27 @@ xe::cpu::Export* RegisterExport(R (*fn)(Ps&...), const char* name,
            cvars::log_high_frequency_kernel_calls)) {
         PrintKernelCall(export_entry, params);
       }
+      util::KernelCallTraceRecord trace_record;
+      bool trace = util::KernelCallTracer::is_enabled();
+      if (trace) {
+        util::KernelCallTracer::BeginRecord(&trace_record, uint16_t(MODULE),
+                                            ORDINAL, ppc_context,
+                                            sizeof...(Ps));
+      }
+      uint64_t timing_start = util::KernelExportStats::is_timing_enabled()
+                                  ? Clock::QueryHostTickCount()
+                                  : 0;
       auto result =
           KernelTrampoline(FN, std::forward<std::tuple<Ps...>>(params),
                            std::make_index_sequence<sizeof...(Ps)>());
       result.Store(ppc_context);
+      if (timing_start) {
+        util::KernelExportStats::RecordLatency(
+            stats_slot, Clock::QueryHostTickCount() - timing_start);
+      }
+      if (trace) {
+        util::KernelCallTracer::EndRecord(&trace_record, ppc_context->r[3]);
+      }
       if (export_entry->tags &
           (xe::cpu::ExportTag::kLog | xe::cpu::ExportTag::kLogResult)) {
         // TODO(benvanik): log result.
@@ -549,9 +572,12 @@ xe::cpu::Export* RegisterExport(void (*fn)(Ps&...), const char* name,
       ORDINAL, xe::cpu::Export::Type::kFunction, name,
       tags | xe::cpu::ExportTag::kImplemented | xe::cpu::ExportTag::kLog);
   static void (*FN)(Ps & ...) = fn;
+  static const uint32_t stats_slot =
+      util::KernelExportStats::RegisterExport(export_entry, uint16_t(MODULE));
   struct X {
     static void Trampoline(PPCContext* ppc_context) {
       ++export_entry->function_data.call_count;
+      util::KernelExportStats::RecordCall(stats_slot);
       Param::Init init = {
           ppc_context,
           sizeof...(Ps),
@@ -562,8 +588,25 @@ xe::cpu::Export* RegisterExport(void (*fn)(Ps&...), const char* name,
            cvars::log_high_frequency_kernel_calls)) {
         PrintKernelCall(export_entry, params);
       }
+      util::KernelCallTraceRecord trace_record;
+      bool trace = util::KernelCallTracer::is_enabled();
+      if (trace) {
+        util::KernelCallTracer::BeginRecord(&trace_record, uint16_t(MODULE),
+                                            ORDINAL, ppc_context,
+                                            sizeof...(Ps));
+      }
+      uint64_t timing_start = util::KernelExportStats::is_timing_enabled()
+                                  ? Clock::QueryHostTickCount()
+                                  : 0;
       KernelTrampoline(FN, std::forward<std::tuple<Ps...>>(params),
                        std::make_index_sequence<sizeof...(Ps)>());
+      if (timing_start) {
+        util::KernelExportStats::RecordLatency(
+            stats_slot, Clock::QueryHostTickCount() - timing_start);
+      }
+      if (trace) {
+        util::KernelCallTracer::EndRecord(&trace_record, 0);
+      }
     }
   };
   export_entry->function_data.trampoline = &X::Trampoline;
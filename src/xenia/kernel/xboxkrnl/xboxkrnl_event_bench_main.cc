@@ -0,0 +1,158 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "third_party/fmt/include/fmt/format.h"
+#include "xenia/base/clock.h"
+#include "xenia/base/cvar.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/main.h"
+#include "xenia/base/threading.h"
+#include "xenia/emulator.h"
+#include "xenia/gpu/graphics_system.h"
+#include "xenia/gpu/null/null_graphics_system.h"
+#include "xenia/kernel/kernel_state.h"
+#include "xenia/kernel/xboxkrnl/xboxkrnl_threading.h"
+#include "xenia/kernel/xevent.h"
+
+DEFINE_int32(bench_calls, 1000000,
+             "Number of KeSetEvent and KeResetEvent pairs each thread makes in "
+             "each configuration.",
+             "General");
+DEFINE_int32(bench_threads, -1,
+             "Number of threads making calls, or -1 to run 1, 2, 4 and 8.",
+             "General");
+DEFINE_bool(bench_shared_event, false,
+            "Make all threads signal the same event instead of one each.",
+            "General");
+
+namespace xe {
+namespace kernel {
+namespace xboxkrnl {
+
+// Times KeSetEvent and KeResetEvent on guest events initialized in place, the
+// way titles inline KeInitializeEvent, from several host threads at once. Each
+// call goes through XObject::GetNativeObject and the object table lookup.
+class EventBench {
+ public:
+  int Main(const std::vector<std::string>& args);
+
+ private:
+  bool Setup();
+  // Returns the time taken by all threads to make their calls, in seconds.
+  double Run(uint32_t thread_count);
+
+  std::unique_ptr<Emulator> emulator_;
+  std::vector<X_KEVENT*> events_;
+};
+
+int EventBench::Main(const std::vector<std::string>& args) {
+  if (!Setup()) {
+    XELOGE("Unable to setup the emulator");
+    return 1;
+  }
+
+  std::vector<uint32_t> thread_counts;
+  if (cvars::bench_threads > 0) {
+    thread_counts.push_back(uint32_t(cvars::bench_threads));
+  } else {
+    thread_counts = {1, 2, 4, 8};
+  }
+  fmt::print("{} event, {} set/reset pairs per thread\n",
+             cvars::bench_shared_event ? "shared" : "per-thread",
+             cvars::bench_calls);
+  fmt::print("{:>8} {:>10} {:>14}\n", "threads", "ms", "calls/s");
+  for (uint32_t thread_count : thread_counts) {
+    double seconds = Run(thread_count);
+    fmt::print("{:>8} {:>10.1f} {:>14.0f}\n", thread_count, seconds * 1000.0,
+               2.0 * cvars::bench_calls * thread_count / seconds);
+  }
+
+  emulator_.reset();
+  return 0;
+}
+
+bool EventBench::Setup() {
+  emulator_ = std::make_unique<Emulator>("", "", "");
+  X_STATUS result = emulator_->Setup(
+      nullptr, nullptr,
+      []() {
+        return std::unique_ptr<gpu::GraphicsSystem>(
+            new gpu::null::NullGraphicsSystem());
+      },
+      nullptr);
+  if (XFAILED(result)) {
+    XELOGE("Failed to setup emulator: {:08X}", result);
+    return false;
+  }
+
+  Memory* memory = emulator_->memory();
+  uint32_t event_count = cvars::bench_shared_event ? 1 : 8;
+  if (cvars::bench_threads > 0 && !cvars::bench_shared_event) {
+    event_count = uint32_t(cvars::bench_threads);
+  }
+  for (uint32_t i = 0; i < event_count; ++i) {
+    uint32_t guest_ptr = memory->SystemHeapAlloc(sizeof(X_KEVENT));
+    if (!guest_ptr) {
+      return false;
+    }
+    auto event = memory->TranslateVirtual<X_KEVENT*>(guest_ptr);
+    std::memset(event, 0, sizeof(X_KEVENT));
+    // SynchronizationEvent, not signaled. Notification events have no host
+    // implementation on POSIX yet.
+    event->header.type = 1;
+    event->header.size = sizeof(X_KEVENT) / 4;
+    events_.push_back(event);
+  }
+  // The first call on each event creates its XEvent, keep that out of the
+  // timed runs.
+  for (X_KEVENT* event : events_) {
+    xeKeResetEvent(event);
+  }
+  return true;
+}
+
+double EventBench::Run(uint32_t thread_count) {
+  int32_t calls = cvars::bench_calls;
+  uint64_t start_ticks = Clock::QueryHostTickCount();
+  std::vector<std::thread> threads;
+  for (uint32_t i = 0; i < thread_count; ++i) {
+    X_KEVENT* event = events_[i % events_.size()];
+    threads.emplace_back([event, calls]() {
+      xe::threading::set_name("Event Bench");
+      for (int32_t j = 0; j < calls; ++j) {
+        xeKeSetEvent(event, 0, 0);
+        xeKeResetEvent(event);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  return double(Clock::QueryHostTickCount() - start_ticks) /
+         double(Clock::QueryHostTickFrequency());
+}
+
+int event_bench_main(const std::vector<std::string>& args) {
+  EventBench bench;
+  return bench.Main(args);
+}
+
+}  // namespace xboxkrnl
+}  // namespace kernel
+}  // namespace xe
+
+DEFINE_ENTRY_POINT("xenia-kernel-event-bench",
+                   xe::kernel::xboxkrnl::event_bench_main,
+                   "[--bench_threads=N] [--bench_shared_event]");
@@ -178,7 +178,13 @@ dword_result_t NtReadFile(dword_t file_handle, dword_t event_handle,
   }
 
   if (XSUCCEEDED(result)) {
-    if (true || file->is_synchronous()) {
+    // Overlapped reads need an explicit offset, as the file position is
+    // meaningless with multiple reads in flight. An offset of -1 also means
+    // "use the file position".
+    auto file_io_pool = kernel_state()->file_io_pool();
+    bool use_file_position =
+        !byte_offset_ptr || *byte_offset_ptr == uint64_t(-1);
+    if (file->is_synchronous() || !file_io_pool || use_file_position) {
       // Synchronous.
       uint32_t bytes_read = 0;
       result = file->Read(
@@ -209,22 +215,48 @@ dword_result_t NtReadFile(dword_t file_handle, dword_t event_handle,
       // we have written the info out.
       signal_event = true;
     } else {
-      // TODO(benvanik): async.
-
-      // X_STATUS_PENDING if not returning immediately.
-      // XFile is waitable and signalled after each async req completes.
-      // reset the input event (->Reset())
-      /*xeNtReadFileState* call_state = new xeNtReadFileState();
-      XAsyncRequest* request = new XAsyncRequest(
-      state, file,
-      (XAsyncRequest::CompletionCallback)xeNtReadFileCompleted,
-      call_state);*/
-      // result = file->Read(buffer.guest_address(), buffer_length, byte_offset,
-      //                     request);
+      // Overlapped. The read is done on a host I/O thread, which then fills
+      // the status block before signaling anything, so a guest waiting on the
+      // event, the file or a completion port sees the results.
       if (io_status_block) {
         io_status_block->status = X_STATUS_PENDING;
         io_status_block->information = 0;
       }
+      if (ev) {
+        ev->Reset();
+      }
+      file->ResetWaitHandle();
+
+      uint32_t buffer_ptr = buffer.guest_address();
+      uint32_t length = buffer_length;
+      uint64_t byte_offset = *byte_offset_ptr;
+      uint32_t apc_routine = static_cast<uint32_t>(apc_routine_ptr) & ~1u;
+      uint32_t apc_context_ptr = apc_context.guest_address();
+      uint32_t io_status_block_ptr = io_status_block.guest_address();
+      auto thread = retain_object(XThread::GetCurrentThread());
+      file_io_pool->Queue([file, ev, thread, buffer_ptr, length, byte_offset,
+                           apc_routine, apc_context_ptr,
+                           io_status_block_ptr]() -> uint32_t {
+        uint32_t bytes_read = 0;
+        X_STATUS status = file->Read(buffer_ptr, length, byte_offset,
+                                     &bytes_read, apc_context_ptr, false);
+        if (io_status_block_ptr) {
+          auto status_block =
+              kernel_state()->memory()->TranslateVirtual<X_IO_STATUS_BLOCK*>(
+                  io_status_block_ptr);
+          status_block->status = status;
+          status_block->information = bytes_read;
+        }
+        file->NotifyCompletion(apc_context_ptr, bytes_read, status);
+        if (apc_routine && apc_context_ptr) {
+          thread->EnqueueApc(apc_routine, apc_context_ptr, io_status_block_ptr,
+                             0);
+        }
+        if (ev) {
+          ev->Set(0, false);
+        }
+        return bytes_read;
+      });
 
       result = X_STATUS_PENDING;
     }
@@ -10,6 +10,7 @@
 #include "xenia/kernel/xboxkrnl/xboxkrnl_rtl.h"
 
 #include <algorithm>
+#include <atomic>
 #include <string>
 
 #include "xenia/base/atomic.h"
@@ -419,9 +420,23 @@ dword_result_t RtlInitializeCriticalSectionAndSpinCount(
 DECLARE_XBOXKRNL_EXPORT1(RtlInitializeCriticalSectionAndSpinCount, kNone,
                          kImplemented);
 
+// Contended critical sections park the host thread on a wait queue keyed by
+// the guest address of the section instead of waiting on an XEvent, so no
+// kernel object or handle is ever created for them.
+//
+// Spinning is adaptive: each (hashed) critical section remembers roughly how
+// many iterations recent acquisitions needed and spins at most about twice
+// that, bounded by the spin count the title requested.
+static std::atomic<int32_t> critical_section_spin_hints_[64];
+
+static std::atomic<int32_t>& GetCriticalSectionSpinHint(uint32_t cs_ptr) {
+  size_t index = (cs_ptr >> 2) % xe::countof(critical_section_spin_hints_);
+  return critical_section_spin_hints_[index];
+}
+
 void RtlEnterCriticalSection(pointer_t<X_RTL_CRITICAL_SECTION> cs) {
   uint32_t cur_thread = XThread::GetCurrentThread()->guest_object();
-  uint32_t spin_count = cs->header.absolute * 256;
+  int32_t spin_count = cs->header.absolute * 256;
 
   if (cs->owning_thread == cur_thread) {
     // We already own the lock.
@@ -431,9 +446,21 @@ void RtlEnterCriticalSection(pointer_t<X_RTL_CRITICAL_SECTION> cs) {
   }
 
   // Spin loop
-  while (spin_count--) {
-    if (xe::atomic_cas(-1, 0, &cs->lock_count)) {
-      // Acquired.
+  if (spin_count) {
+    auto& spin_hint = GetCriticalSectionSpinHint(cs.guest_address());
+    int32_t hint = spin_hint.load(std::memory_order_relaxed);
+    int32_t spin_limit = std::min(spin_count, hint * 2 + 16);
+    int32_t spins = 0;
+    bool acquired = false;
+    while (spins < spin_limit) {
+      if (xe::atomic_cas(-1, 0, &cs->lock_count)) {
+        acquired = true;
+        break;
+      }
+      ++spins;
+    }
+    spin_hint.store(hint + (spins - hint) / 8, std::memory_order_relaxed);
+    if (acquired) {
       cs->owning_thread = cur_thread;
       cs->recursion_count = 1;
       return;
@@ -441,9 +468,8 @@ void RtlEnterCriticalSection(pointer_t<X_RTL_CRITICAL_SECTION> cs) {
   }
 
   if (xe::atomic_inc(&cs->lock_count) != 0) {
-    // Create a full waiter.
-    xeKeWaitForSingleObject(reinterpret_cast<void*>(cs.host_address()), 8, 0, 0,
-                            nullptr);
+    // Park until RtlLeaveCriticalSection hands us the lock.
+    xe::threading::ParkingLot::Park(cs.guest_address());
   }
 
   assert_true(cs->owning_thread == 0);
@@ -491,7 +517,7 @@ void RtlLeaveCriticalSection(pointer_t<X_RTL_CRITICAL_SECTION> cs) {
   cs->owning_thread = 0;
   if (xe::atomic_dec(&cs->lock_count) != -1) {
     // There were waiters - wake one of them.
-    xeKeSetEvent(reinterpret_cast<X_KEVENT*>(cs.host_address()), 1, 0);
+    xe::threading::ParkingLot::Unpark(cs.guest_address());
   }
 }
 DECLARE_XBOXKRNL_EXPORT2(RtlLeaveCriticalSection, kNone, kImplemented,
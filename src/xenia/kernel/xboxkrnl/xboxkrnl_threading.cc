@@ -404,7 +404,7 @@ dword_result_t KePulseEvent(pointer_t<X_KEVENT> event_ptr, dword_t increment,
 DECLARE_XBOXKRNL_EXPORT2(KePulseEvent, kThreading, kImplemented,
                          kHighFrequency);
 
-dword_result_t KeResetEvent(pointer_t<X_KEVENT> event_ptr) {
+uint32_t xeKeResetEvent(X_KEVENT* event_ptr) {
   auto ev = XObject::GetNativeObject<XEvent>(kernel_state(), event_ptr);
   if (!ev) {
     assert_always();
@@ -413,6 +413,10 @@ dword_result_t KeResetEvent(pointer_t<X_KEVENT> event_ptr) {
 
   return ev->Reset();
 }
+
+dword_result_t KeResetEvent(pointer_t<X_KEVENT> event_ptr) {
+  return xeKeResetEvent(event_ptr);
+}
 DECLARE_XBOXKRNL_EXPORT1(KeResetEvent, kThreading, kImplemented);
 
 dword_result_t NtCreateEvent(lpdword_t handle_ptr,
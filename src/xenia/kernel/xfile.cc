@@ -91,7 +91,7 @@ X_STATUS XFile::QueryDirectory(X_FILE_DIRECTORY_INFORMATION* out_info,
 
 X_STATUS XFile::Read(uint32_t buffer_guest_address, uint32_t buffer_length,
                      uint64_t byte_offset, uint32_t* out_bytes_read,
-                     uint32_t apc_context) {
+                     uint32_t apc_context, bool notify_completion) {
   if (byte_offset == uint64_t(-1)) {
     // Read from current position.
     byte_offset = position_;
@@ -158,19 +158,26 @@ X_STATUS XFile::Read(uint32_t buffer_guest_address, uint32_t buffer_length,
     }
   }
 
+  if (out_bytes_read) {
+    *out_bytes_read = uint32_t(bytes_read);
+  }
+
+  if (notify_completion) {
+    NotifyCompletion(apc_context, uint32_t(bytes_read), result);
+  }
+  return result;
+}
+
+void XFile::NotifyCompletion(uint32_t apc_context, uint32_t num_bytes,
+                             X_STATUS status) {
   XIOCompletion::IONotification notify;
   notify.apc_context = apc_context;
-  notify.num_bytes = uint32_t(bytes_read);
-  notify.status = result;
+  notify.num_bytes = num_bytes;
+  notify.status = status;
 
   NotifyIOCompletionPorts(notify);
 
-  if (out_bytes_read) {
-    *out_bytes_read = uint32_t(bytes_read);
-  }
-
   async_event_->Set();
-  return result;
 }
 
 X_STATUS XFile::Write(uint32_t buffer_guest_address, uint32_t buffer_length,
@@ -234,7 +241,7 @@ bool XFile::Save(ByteStream* stream) {
   }
 
   stream->Write(file_->entry()->absolute_path());
-  stream->Write<uint64_t>(position_);
+  stream->Write<uint64_t>(position_.load());
   stream->Write(file_access());
   stream->Write<bool>(
       (file_->entry()->attributes() & vfs::kFileAttributeDirectory) != 0);
@@ -10,6 +10,7 @@
 #ifndef XENIA_KERNEL_XFILE_H_
 #define XENIA_KERNEL_XFILE_H_
 
+#include <atomic>
 #include <string>
 
 #include "xenia/kernel/xevent.h"
@@ -97,9 +98,17 @@ class XFile : public XObject {
   // Don't do within the global critical region because invalidation callbacks
   // may be triggered (as per the usual rule of not doing I/O within the global
   // critical region).
+  // With notify_completion false, the caller must call NotifyCompletion once
+  // it has written the results out, as done for overlapped reads.
   X_STATUS Read(uint32_t buffer_guess_address, uint32_t buffer_length,
                 uint64_t byte_offset, uint32_t* out_bytes_read,
-                uint32_t apc_context);
+                uint32_t apc_context, bool notify_completion = true);
+  // Notifies the completion ports and signals the file.
+  void NotifyCompletion(uint32_t apc_context, uint32_t num_bytes,
+                        X_STATUS status);
+  // Unsignals the file before an overlapped operation is started, so that
+  // waits on it don't complete on an earlier operation.
+  void ResetWaitHandle() { async_event_->Reset(); }
 
   X_STATUS Write(uint32_t buffer_guess_address, uint32_t buffer_length,
                  uint64_t byte_offset, uint32_t* out_bytes_written,
@@ -134,7 +143,8 @@ class XFile : public XObject {
 
   // TODO(benvanik): create flags, open state, etc.
 
-  uint64_t position_ = 0;
+  // Updated by the host I/O threads completing overlapped reads.
+  std::atomic<uint64_t> position_ = {0};
 
   xe::filesystem::WildcardEngine find_engine_;
   size_t find_index_ = 0;
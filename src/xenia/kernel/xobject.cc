@@ -9,6 +9,7 @@
 
 #include "xenia/kernel/xobject.h"
 
+#include <atomic>
 #include <vector>
 
 #include "xenia/base/byte_stream.h"
@@ -177,17 +178,23 @@ void XObject::SetAttributes(uint32_t obj_attributes_ptr) {
   }
 }
 
-uint32_t XObject::TimeoutTicksToMs(int64_t timeout_ticks) {
+std::chrono::nanoseconds XObject::TimeoutTicksToDuration(
+    int64_t timeout_ticks) {
   if (timeout_ticks > 0) {
     // Absolute time, based on January 1, 1601.
-    // TODO(benvanik): convert time to relative time.
-    assert_always();
-    return 0;
+    int64_t relative_ticks =
+        timeout_ticks - static_cast<int64_t>(Clock::QueryGuestSystemTime());
+    return std::chrono::nanoseconds(std::max(relative_ticks, int64_t(0)) *
+                                    100);
   } else if (timeout_ticks < 0) {
     // Relative time.
-    return (uint32_t)(-timeout_ticks / 10000);  // Ticks -> MS
+    constexpr int64_t max_ticks = std::chrono::nanoseconds::max().count() / 100;
+    if (timeout_ticks < -max_ticks) {
+      return std::chrono::nanoseconds::max();
+    }
+    return std::chrono::nanoseconds(-timeout_ticks * 100);
   } else {
-    return 0;
+    return std::chrono::nanoseconds::zero();
   }
 }
 
@@ -199,13 +206,13 @@ X_STATUS XObject::Wait(uint32_t wait_reason, uint32_t processor_mode,
     return X_STATUS_SUCCESS;
   }
 
-  auto timeout_ms =
-      opt_timeout ? std::chrono::milliseconds(Clock::ScaleGuestDurationMillis(
-                        TimeoutTicksToMs(*opt_timeout)))
-                  : std::chrono::milliseconds::max();
+  auto timeout = opt_timeout ? Clock::ScaleGuestDuration(
+                                  TimeoutTicksToDuration(*opt_timeout))
+                            : std::chrono::nanoseconds::max();
 
-  auto result =
-      xe::threading::Wait(wait_handle, alertable ? true : false, timeout_ms);
+  auto result = xe::threading::Wait(wait_handle, alertable ? true : false,
+                                    timeout,
+                                    xe::threading::WaitPrecision::kPrecise);
   switch (result) {
     case xe::threading::WaitResult::kSuccess:
       WaitCallback();
@@ -226,14 +233,14 @@ X_STATUS XObject::Wait(uint32_t wait_reason, uint32_t processor_mode,
 X_STATUS XObject::SignalAndWait(XObject* signal_object, XObject* wait_object,
                                 uint32_t wait_reason, uint32_t processor_mode,
                                 uint32_t alertable, uint64_t* opt_timeout) {
-  auto timeout_ms =
-      opt_timeout ? std::chrono::milliseconds(Clock::ScaleGuestDurationMillis(
-                        TimeoutTicksToMs(*opt_timeout)))
-                  : std::chrono::milliseconds::max();
+  auto timeout = opt_timeout ? Clock::ScaleGuestDuration(
+                                  TimeoutTicksToDuration(*opt_timeout))
+                            : std::chrono::nanoseconds::max();
 
   auto result = xe::threading::SignalAndWait(
       signal_object->GetWaitHandle(), wait_object->GetWaitHandle(),
-      alertable ? true : false, timeout_ms);
+      alertable ? true : false, timeout,
+      xe::threading::WaitPrecision::kPrecise);
   switch (result) {
     case xe::threading::WaitResult::kSuccess:
       wait_object->WaitCallback();
@@ -261,14 +268,14 @@ X_STATUS XObject::WaitMultiple(uint32_t count, XObject** objects,
     assert_not_null(wait_handles[i]);
   }
 
-  auto timeout_ms =
-      opt_timeout ? std::chrono::milliseconds(Clock::ScaleGuestDurationMillis(
-                        TimeoutTicksToMs(*opt_timeout)))
-                  : std::chrono::milliseconds::max();
+  auto timeout = opt_timeout ? Clock::ScaleGuestDuration(
+                                  TimeoutTicksToDuration(*opt_timeout))
+                            : std::chrono::nanoseconds::max();
 
   if (wait_type) {
-    auto result = xe::threading::WaitAny(std::move(wait_handles),
-                                         alertable ? true : false, timeout_ms);
+    auto result = xe::threading::WaitAny(
+        std::move(wait_handles), alertable ? true : false, timeout,
+        xe::threading::WaitPrecision::kPrecise);
     switch (result.first) {
       case xe::threading::WaitResult::kSuccess:
         objects[result.second]->WaitCallback();
@@ -287,8 +294,9 @@ X_STATUS XObject::WaitMultiple(uint32_t count, XObject** objects,
         return X_STATUS_UNSUCCESSFUL;
     }
   } else {
-    auto result = xe::threading::WaitAll(std::move(wait_handles),
-                                         alertable ? true : false, timeout_ms);
+    auto result = xe::threading::WaitAll(
+        std::move(wait_handles), alertable ? true : false, timeout,
+        xe::threading::WaitPrecision::kPrecise);
     switch (result) {
       case xe::threading::WaitResult::kSuccess:
         for (uint32_t i = 0; i < count; i++) {
@@ -372,71 +380,92 @@ object_ref<XObject> XObject::GetNativeObject(KernelState* kernel_state,
   // each time.
   // We identify this by setting wait_list_flink to a magic value. When set,
   // wait_list_blink will hold a handle to our object.
-
-  auto global_lock = xe::global_critical_region::AcquireDirect();
+  //
+  // This is on the path of every Ke* call on a guest dispatcher object, so it
+  // avoids the global lock: already-initialized headers are read directly, and
+  // first use claims the header by swapping wait_list_flink to a busy marker.
+  // Threads racing the initializer spin until the magic is published.
 
   auto header = reinterpret_cast<X_DISPATCH_HEADER*>(native_ptr);
+  auto flink_ptr =
+      reinterpret_cast<volatile uint32_t*>(&header->wait_list_flink);
 
   if (as_type == -1) {
     as_type = header->type;
   }
 
-  if (header->wait_list_flink == 'XEN\0') {
-    // Already initialized.
-    // TODO: assert if the type of the object != as_type
-    uint32_t handle = header->wait_list_blink;
-    auto object = kernel_state->object_table()->LookupObject<XObject>(handle);
-
-    // TODO(benvanik): assert nothing has been changed in the struct.
-    return object;
-  } else {
-    // First use, create new.
-    // https://www.nirsoft.net/kernel_struct/vista/KOBJECTS.html
-    XObject* object = nullptr;
-    switch (as_type) {
-      case 0:  // EventNotificationObject
-      case 1:  // EventSynchronizationObject
-      {
-        auto ev = new XEvent(kernel_state);
-        ev->InitializeNative(native_ptr, header);
-        object = ev;
-      } break;
-      case 2:  // MutantObject
-      {
-        auto mutant = new XMutant(kernel_state);
-        mutant->InitializeNative(native_ptr, header);
-        object = mutant;
-      } break;
-      case 5:  // SemaphoreObject
-      {
-        auto sem = new XSemaphore(kernel_state);
-        sem->InitializeNative(native_ptr, header);
-        object = sem;
-      } break;
-      case 3:   // ProcessObject
-      case 4:   // QueueObject
-      case 6:   // ThreadObject
-      case 7:   // GateObject
-      case 8:   // TimerNotificationObject
-      case 9:   // TimerSynchronizationObject
-      case 18:  // ApcObject
-      case 19:  // DpcObject
-      case 20:  // DeviceQueueObject
-      case 21:  // EventPairObject
-      case 22:  // InterruptObject
-      case 23:  // ProfileObject
-      case 24:  // ThreadedDpcObject
-      default:
-        assert_always();
-        return NULL;
+  uint32_t flink;
+  while (true) {
+    flink = xe::byte_swap(*flink_ptr);
+    if (flink == kNativeMagic) {
+      // Already initialized.
+      // Pairs with the publishing exchange in StashHandle.
+      std::atomic_thread_fence(std::memory_order_acquire);
+      // TODO: assert if the type of the object != as_type
+      uint32_t handle = header->wait_list_blink;
+      auto object = kernel_state->object_table()->LookupObject<XObject>(handle);
+
+      // TODO(benvanik): assert nothing has been changed in the struct.
+      return object;
+    } else if (flink == kNativeBusyMagic) {
+      // Another thread is initializing this object.
+      xe::threading::MaybeYield();
+      continue;
     }
+    if (xe::atomic_cas(xe::byte_swap(flink), xe::byte_swap(kNativeBusyMagic),
+                       flink_ptr)) {
+      break;
+    }
+  }
 
-    // Stash pointer in struct.
-    // FIXME: This assumes the object contains a dispatch header (some don't!)
-    StashHandle(header, object->handle());
-
-    return object_ref<XObject>(object);
+  // First use, create new.
+  // https://www.nirsoft.net/kernel_struct/vista/KOBJECTS.html
+  XObject* object = nullptr;
+  switch (as_type) {
+    case 0:  // EventNotificationObject
+    case 1:  // EventSynchronizationObject
+    {
+      auto ev = new XEvent(kernel_state);
+      ev->InitializeNative(native_ptr, header);
+      object = ev;
+    } break;
+    case 2:  // MutantObject
+    {
+      auto mutant = new XMutant(kernel_state);
+      mutant->InitializeNative(native_ptr, header);
+      object = mutant;
+    } break;
+    case 5:  // SemaphoreObject
+    {
+      auto sem = new XSemaphore(kernel_state);
+      sem->InitializeNative(native_ptr, header);
+      object = sem;
+    } break;
+    case 3:   // ProcessObject
+    case 4:   // QueueObject
+    case 6:   // ThreadObject
+    case 7:   // GateObject
+    case 8:   // TimerNotificationObject
+    case 9:   // TimerSynchronizationObject
+    case 18:  // ApcObject
+    case 19:  // DpcObject
+    case 20:  // DeviceQueueObject
+    case 21:  // EventPairObject
+    case 22:  // InterruptObject
+    case 23:  // ProfileObject
+    case 24:  // ThreadedDpcObject
+    default:
+      assert_always();
+      // Release the claim so the guest list pointer is left untouched.
+      xe::atomic_exchange(xe::byte_swap(flink), flink_ptr);
+      return NULL;
   }
+
+  // Stash pointer in struct.
+  // FIXME: This assumes the object contains a dispatch header (some don't!)
+  StashHandle(header, object->handle());
+
+  return object_ref<XObject>(object);
 }
 
 }  // namespace kernel
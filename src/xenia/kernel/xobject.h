@@ -12,9 +12,12 @@
 
 #include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <cstddef>
 #include <string>
 
+#include "xenia/base/atomic.h"
+#include "xenia/base/byte_order.h"
 #include "xenia/base/threading.h"
 #include "xenia/memory.h"
 #include "xenia/xbox.h"
@@ -205,13 +208,26 @@ class XObject {
     return reinterpret_cast<T*>(CreateNative(sizeof(T)));
   }
 
+  // Magic values stored in X_DISPATCH_HEADER::wait_list_flink. kNativeMagic
+  // marks a header whose wait_list_blink holds the handle of our object;
+  // kNativeBusyMagic marks a header currently being initialized by another
+  // thread in GetNativeObject.
+  static constexpr uint32_t kNativeMagic = 'XEN\0';
+  static constexpr uint32_t kNativeBusyMagic = 'XEN!';
+
   // Stash native pointer into X_DISPATCH_HEADER
+  // The handle is written before the magic is published so that lock-free
+  // readers in GetNativeObject never observe the magic with a stale handle.
   static void StashHandle(X_DISPATCH_HEADER* header, uint32_t handle) {
-    header->wait_list_flink = 'XEN\0';
     header->wait_list_blink = handle;
+    xe::atomic_exchange(
+        xe::byte_swap(kNativeMagic),
+        reinterpret_cast<volatile uint32_t*>(&header->wait_list_flink));
   }
 
-  static uint32_t TimeoutTicksToMs(int64_t timeout_ticks);
+  // Converts a guest timeout in 100ns ticks (negative for relative, positive
+  // for an absolute FILETIME) into a relative duration, unscaled.
+  static std::chrono::nanoseconds TimeoutTicksToDuration(int64_t timeout_ticks);
 
   KernelState* kernel_state_;
 
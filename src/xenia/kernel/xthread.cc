@@ -784,23 +784,10 @@ X_STATUS XThread::Suspend(uint32_t* out_suspend_count) {
 
 X_STATUS XThread::Delay(uint32_t processor_mode, uint32_t alertable,
                         uint64_t interval) {
-  int64_t timeout_ticks = interval;
-  uint32_t timeout_ms;
-  if (timeout_ticks > 0) {
-    // Absolute time, based on January 1, 1601.
-    // TODO(benvanik): convert time to relative time.
-    assert_always();
-    timeout_ms = 0;
-  } else if (timeout_ticks < 0) {
-    // Relative time.
-    timeout_ms = uint32_t(-timeout_ticks / 10000);  // Ticks -> MS
-  } else {
-    timeout_ms = 0;
-  }
-  timeout_ms = Clock::ScaleGuestDurationMillis(timeout_ms);
+  auto timeout = Clock::ScaleGuestDuration(TimeoutTicksToDuration(interval));
   if (alertable) {
-    auto result =
-        xe::threading::AlertableSleep(std::chrono::milliseconds(timeout_ms));
+    auto result = xe::threading::AlertableSleep(
+        timeout, xe::threading::WaitPrecision::kPrecise);
     switch (result) {
       default:
       case xe::threading::SleepResult::kSuccess:
@@ -809,7 +796,7 @@ X_STATUS XThread::Delay(uint32_t processor_mode, uint32_t alertable,
         return X_STATUS_USER_APC;
     }
   } else {
-    xe::threading::Sleep(std::chrono::milliseconds(timeout_ms));
+    xe::threading::Sleep(timeout, xe::threading::WaitPrecision::kPrecise);
     return X_STATUS_SUCCESS;
   }
 }
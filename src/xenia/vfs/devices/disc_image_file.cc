@@ -16,6 +16,10 @@
 namespace xe {
 namespace vfs {
 
+// Reads at least this large hint the OS to read the range ahead of the copy.
+// Smaller reads are left to the page fault readahead.
+constexpr size_t kPrefetchMinLength = 64 * 1024;
+
 DiscImageFile::DiscImageFile(uint32_t file_access, DiscImageEntry* entry)
     : File(file_access, entry), entry_(entry) {}
 
@@ -31,6 +35,15 @@ X_STATUS DiscImageFile::ReadSync(void* buffer, size_t buffer_length,
   size_t real_offset = entry_->data_offset() + byte_offset;
   size_t real_length =
       std::min(buffer_length, entry_->data_size() - byte_offset);
+  if (real_length >= kPrefetchMinLength) {
+    entry_->mmap()->Prefetch(real_offset, real_length);
+  }
+  auto read_ahead =
+      read_ahead_.OnRead(byte_offset, real_length, entry_->data_size());
+  if (read_ahead.length) {
+    entry_->mmap()->Prefetch(entry_->data_offset() + read_ahead.offset,
+                             read_ahead.length);
+  }
   std::memcpy(buffer, entry_->mmap()->data() + real_offset, real_length);
   *out_bytes_read = real_length;
   return X_STATUS_SUCCESS;
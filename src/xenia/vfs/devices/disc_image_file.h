@@ -11,6 +11,7 @@
 #define XENIA_VFS_DEVICES_DISC_IMAGE_FILE_H_
 
 #include "xenia/vfs/file.h"
+#include "xenia/vfs/read_ahead.h"
 
 namespace xe {
 namespace vfs {
@@ -34,6 +35,7 @@ class DiscImageFile : public File {
 
  private:
   DiscImageEntry* entry_;
+  ReadAheadPredictor read_ahead_;
 };
 
 }  // namespace vfs
@@ -17,8 +17,6 @@
 namespace xe {
 namespace vfs {
 
-class HostPathEntry;
-
 class HostPathDevice : public Device {
  public:
   HostPathDevice(const std::string_view mount_path,
@@ -41,8 +39,6 @@ class HostPathDevice : public Device {
   uint32_t bytes_per_sector() const override { return 0x200; }
 
  private:
-  void PopulateEntry(HostPathEntry* parent_entry);
-
   std::string name_;
   std::filesystem::path host_path_;
   std::unique_ptr<Entry> root_entry_;
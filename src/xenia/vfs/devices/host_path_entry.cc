@@ -75,6 +75,7 @@ std::unique_ptr<MappedMemory> HostPathEntry::OpenMapped(MappedMemory::Mode mode,
 
 std::unique_ptr<Entry> HostPathEntry::CreateEntryInternal(
     const std::string_view name, uint32_t attributes) {
+  missing_children_.erase(string_key_case(name));
   auto full_path = host_path_ / xe::to_path(name);
   if (attributes & kFileAttributeDirectory) {
     if (!std::filesystem::create_directories(full_path)) {
@@ -107,6 +108,41 @@ bool HostPathEntry::DeleteEntryInternal(Entry* entry) {
   }
 }
 
+void HostPathEntry::EnsureChildrenPopulated() {
+  auto global_lock = global_critical_region_.Acquire();
+  if (children_populated_ || !(attributes_ & kFileAttributeDirectory)) {
+    return;
+  }
+  children_populated_ = true;
+  auto child_infos = xe::filesystem::ListFiles(host_path_);
+  for (auto& child_info : child_infos) {
+    children_.push_back(std::unique_ptr<Entry>(HostPathEntry::Create(
+        device_, this, host_path_ / child_info.name, child_info)));
+  }
+}
+
+Entry* HostPathEntry::AddMissingChild(const std::string_view name) {
+  // Picks up files written to the host directory after it was listed.
+  if (!(attributes_ & kFileAttributeDirectory) || name.empty() ||
+      name == "." || name == ".." ||
+      name.find_first_of("\\/") != std::string_view::npos) {
+    return nullptr;
+  }
+  auto global_lock = global_critical_region_.Acquire();
+  if (missing_children_.count(string_key_case(name))) {
+    return nullptr;
+  }
+  auto full_path = host_path_ / xe::to_path(name);
+  xe::filesystem::FileInfo file_info;
+  if (!xe::filesystem::GetInfo(full_path, &file_info)) {
+    missing_children_.insert(string_key_case::create(name));
+    return nullptr;
+  }
+  children_.push_back(std::unique_ptr<Entry>(
+      HostPathEntry::Create(device_, this, full_path, file_info)));
+  return children_.back().get();
+}
+
 void HostPathEntry::update() {
   xe::filesystem::FileInfo file_info;
   if (!xe::filesystem::GetInfo(host_path_, &file_info)) {
@@ -11,8 +11,10 @@
 #define XENIA_VFS_DEVICES_HOST_PATH_ENTRY_H_
 
 #include <string>
+#include <unordered_set>
 
 #include "xenia/base/filesystem.h"
+#include "xenia/base/string_key.h"
 #include "xenia/vfs/entry.h"
 
 namespace xe {
@@ -46,8 +48,16 @@ class HostPathEntry : public Entry {
   std::unique_ptr<Entry> CreateEntryInternal(const std::string_view name,
                                              uint32_t attributes) override;
   bool DeleteEntryInternal(Entry* entry) override;
+  void EnsureChildrenPopulated() override;
+  Entry* AddMissingChild(const std::string_view name) override;
 
   std::filesystem::path host_path_;
+  bool children_populated_ = false;
+  // Names AddMissingChild found no host file for, so that repeated probes
+  // for them don't stat the host every time. A name is removed when the
+  // child is created through this entry, files created on the host behind
+  // the emulator's back are only picked up if they weren't probed before.
+  std::unordered_set<string_key_case> missing_children_;
 };
 
 }  // namespace vfs
@@ -122,7 +122,8 @@ StfsContainerDevice::Error StfsContainerDevice::MapFiles() {
   // NOTE: data_file_count is 0 for STFS and 1 for SVOD
   if (header_.data_file_count <= 1) {
     XELOGI("STFS container is a single file.");
-    mmap_.emplace(std::make_pair(0, std::move(header_map)));
+    mmap_total_size_ = header_map->size();
+    mmap_.push_back(std::move(header_map));
     return Error::kSuccess;
   }
 
@@ -156,9 +157,11 @@ StfsContainerDevice::Error StfsContainerDevice::MapFiles() {
     if (!data) {
       XELOGI("Failed to map SVOD file {}.", xe::path_to_utf8(path));
       mmap_.clear();
+      mmap_total_size_ = 0;
       return Error::kErrorReadError;
     }
-    mmap_.emplace(std::make_pair(i, std::move(data)));
+    mmap_total_size_ += data->size();
+    mmap_.push_back(std::move(data));
   }
   XELOGI("SVOD successfully mapped {} files.", fragment_files.size());
   return Error::kSuccess;
@@ -177,6 +180,36 @@ Entry* StfsContainerDevice::ResolvePath(const std::string_view path) {
   return root_entry_->ResolvePath(path);
 }
 
+void StfsContainerDevice::ReadChildren(StfsContainerEntry* parent) {
+  switch (header_.descriptor_type) {
+    case StfsDescriptorType::kStfs:
+      ReadChildrenSTFS(parent);
+      break;
+    case StfsDescriptorType::kSvod:
+      if (parent->data_size_ &&
+          ReadEntrySVOD(uint32_t(parent->block_), 0, parent) !=
+              Error::kSuccess) {
+        XELOGE("Failed to read SVOD directory {}", parent->path());
+      }
+      break;
+  }
+}
+
+void StfsContainerDevice::ReadBlockList(StfsContainerEntry* entry) {
+  if (!(entry->attributes() & kFileAttributeNormal)) {
+    return;
+  }
+  switch (header_.descriptor_type) {
+    case StfsDescriptorType::kStfs:
+      ReadBlockListSTFS(entry);
+      break;
+    case StfsDescriptorType::kSvod:
+      ReadBlockListSVOD(entry);
+      break;
+  }
+  entry->BuildBlockIndex();
+}
+
 StfsContainerDevice::Error StfsContainerDevice::ReadPackageType(
     const uint8_t* map_ptr, size_t map_size,
     StfsPackageType* package_type_out) {
@@ -304,15 +337,16 @@ StfsContainerDevice::Error StfsContainerDevice::ReadSVOD() {
   uint64_t root_creation_timestamp =
       decode_fat_timestamp(root_creation_date, root_creation_time);
 
+  // Directories are only traversed when they're first listed.
   auto root_entry = new StfsContainerEntry(this, nullptr, "", &mmap_);
   root_entry->attributes_ = kFileAttributeDirectory;
   root_entry->access_timestamp_ = root_creation_timestamp;
   root_entry->create_timestamp_ = root_creation_timestamp;
   root_entry->write_timestamp_ = root_creation_timestamp;
+  root_entry->block_ = root_block;
+  root_entry->data_size_ = root_size;
   root_entry_ = std::unique_ptr<Entry>(root_entry);
-
-  // Traverse all child entries
-  return ReadEntrySVOD(root_block, 0, root_entry);
+  return Error::kSuccess;
 }
 
 StfsContainerDevice::Error StfsContainerDevice::ReadEntrySVOD(
@@ -329,7 +363,13 @@ StfsContainerDevice::Error StfsContainerDevice::ReadEntrySVOD(
   entry_address += true_ordinal_offset;
 
   // Read block's descriptor
-  auto data = mmap_.at(entry_file)->data() + entry_address;
+  if (entry_file >= mmap_.size() ||
+      entry_address + 0x0E > mmap_[entry_file]->size()) {
+    XELOGE("SVOD directory entry at block {} is outside the data files",
+           block + block_offset);
+    return Error::kErrorDamagedFile;
+  }
+  auto data = mmap_[entry_file]->data() + entry_address;
 
   uint16_t node_l = xe::load<uint16_t>(data + 0x00);
   uint16_t node_r = xe::load<uint16_t>(data + 0x02);
@@ -337,6 +377,11 @@ StfsContainerDevice::Error StfsContainerDevice::ReadEntrySVOD(
   uint32_t length = xe::load<uint32_t>(data + 0x08);
   uint8_t attributes = xe::load<uint8_t>(data + 0x0C);
   uint8_t name_length = xe::load<uint8_t>(data + 0x0D);
+  if (entry_address + 0x0E + name_length > mmap_[entry_file]->size()) {
+    XELOGE("SVOD directory entry at block {} is outside the data files",
+           block + block_offset);
+    return Error::kErrorDamagedFile;
+  }
   auto name_buffer = reinterpret_cast<const char*>(data + 0x0E);
   auto name = std::string(name_buffer, name_length);
 
@@ -358,22 +403,14 @@ StfsContainerDevice::Error StfsContainerDevice::ReadEntrySVOD(
   //       solves this issues.
   auto entry = StfsContainerEntry::Create(this, parent, name, &mmap_);
   if (attributes & kFileAttributeDirectory) {
-    // Entry is a directory
+    // Entry is a directory, its listing is read when it's first used.
     entry->attributes_ = kFileAttributeDirectory | kFileAttributeReadOnly;
     entry->data_offset_ = 0;
-    entry->data_size_ = 0;
-    entry->block_ = block;
+    entry->data_size_ = length;
+    entry->block_ = data_block;
     entry->access_timestamp_ = root_entry_->create_timestamp();
     entry->create_timestamp_ = root_entry_->create_timestamp();
     entry->write_timestamp_ = root_entry_->create_timestamp();
-
-    if (length) {
-      // If length is greater than 0, traverse the directory's children
-      auto directory_result = ReadEntrySVOD(data_block, 0, entry.get());
-      if (directory_result != Error::kSuccess) {
-        return directory_result;
-      }
-    }
   } else {
     // Entry is a file
     entry->attributes_ = kFileAttributeNormal | kFileAttributeReadOnly;
@@ -385,35 +422,6 @@ StfsContainerDevice::Error StfsContainerDevice::ReadEntrySVOD(
     entry->access_timestamp_ = root_entry_->create_timestamp();
     entry->create_timestamp_ = root_entry_->create_timestamp();
     entry->write_timestamp_ = root_entry_->create_timestamp();
-
-    // Fill in all block records, sector by sector.
-    if (entry->attributes() & X_FILE_ATTRIBUTE_NORMAL) {
-      uint32_t block_index = data_block;
-      size_t remaining_size = xe::round_up(length, 0x800);
-
-      size_t last_record = -1;
-      size_t last_offset = -1;
-      while (remaining_size) {
-        const size_t BLOCK_SIZE = 0x800;
-
-        size_t offset, file_index;
-        BlockToOffsetSVOD(block_index, &offset, &file_index);
-
-        block_index++;
-        remaining_size -= BLOCK_SIZE;
-
-        if (offset - last_offset == 0x800) {
-          // Consecutive, so append to last entry.
-          entry->block_list_[last_record].length += BLOCK_SIZE;
-          last_offset = offset;
-          continue;
-        }
-
-        entry->block_list_.push_back({file_index, offset, BLOCK_SIZE});
-        last_record = entry->block_list_.size() - 1;
-        last_offset = offset;
-      }
-    }
   }
 
   parent->children_.emplace_back(std::move(entry));
@@ -429,6 +437,28 @@ StfsContainerDevice::Error StfsContainerDevice::ReadEntrySVOD(
   return Error::kSuccess;
 }
 
+void StfsContainerDevice::ReadBlockListSVOD(StfsContainerEntry* entry) {
+  // Fill in all block records, sector by sector.
+  const size_t BLOCK_SIZE = 0x800;
+  size_t block_index = entry->block_;
+  size_t remaining_size = xe::round_up(entry->data_size_, BLOCK_SIZE);
+  while (remaining_size) {
+    size_t offset, file_index;
+    BlockToOffsetSVOD(block_index, &offset, &file_index);
+    if (file_index >= mmap_.size() ||
+        offset + BLOCK_SIZE > mmap_[file_index]->size()) {
+      XELOGE("SVOD file {} extends past the data files", entry->path());
+      break;
+    }
+
+    block_index++;
+    remaining_size -= BLOCK_SIZE;
+
+    // Consecutive blocks are merged by BuildBlockIndex.
+    entry->block_list_.push_back({file_index, offset, BLOCK_SIZE});
+  }
+}
+
 void StfsContainerDevice::BlockToOffsetSVOD(size_t block, size_t* out_address,
                                             size_t* out_file_index) {
   // SVOD Systems use hash blocks for integrity checks. These hash blocks
@@ -492,90 +522,26 @@ void StfsContainerDevice::BlockToOffsetSVOD(size_t block, size_t* out_address,
 
 StfsContainerDevice::Error StfsContainerDevice::ReadSTFS() {
   auto data = mmap_.at(0)->data();
+  size_t data_size = mmap_.at(0)->size();
 
-  auto root_entry = new StfsContainerEntry(this, nullptr, "", &mmap_);
-  root_entry->attributes_ = kFileAttributeDirectory;
-  root_entry_ = std::unique_ptr<Entry>(root_entry);
-
-  std::vector<StfsContainerEntry*> all_entries;
-
-  // Load all listings.
+  // Only the locations of the listings are kept, entries are created from the
+  // mapped file table when their directory is first listed.
   auto& volume_descriptor = header_.stfs_volume_descriptor;
   uint32_t table_block_index = volume_descriptor.file_table_block_number;
   for (size_t n = 0; n < volume_descriptor.file_table_block_count; n++) {
-    const uint8_t* p = data + BlockToOffsetSTFS(table_block_index);
+    size_t table_offset = BlockToOffsetSTFS(table_block_index);
+    if (table_offset + 0x1000 > data_size) {
+      XELOGE("STFS file table block {} is outside the package",
+             table_block_index);
+      return Error::kErrorDamagedFile;
+    }
     for (size_t m = 0; m < 0x1000 / 0x40; m++) {
-      const uint8_t* name_buffer = p;  // 0x28b
-      if (name_buffer[0] == 0) {
+      size_t record_offset = table_offset + m * 0x40;
+      if (data[record_offset] == 0) {
         // Done.
         break;
       }
-      uint8_t name_length_flags = xe::load_and_swap<uint8_t>(p + 0x28);
-      // TODO(benvanik): use for allocation_size_?
-      // uint32_t allocated_block_count = load_uint24_le(p + 0x29);
-      uint32_t start_block_index = load_uint24_le(p + 0x2F);
-      uint16_t path_indicator = xe::load_and_swap<uint16_t>(p + 0x32);
-      uint32_t file_size = xe::load_and_swap<uint32_t>(p + 0x34);
-
-      // both date and time parts of the timestamp are big endian
-      uint16_t update_date = xe::load_and_swap<uint16_t>(p + 0x38);
-      uint16_t update_time = xe::load_and_swap<uint16_t>(p + 0x3A);
-      uint32_t access_date = xe::load_and_swap<uint16_t>(p + 0x3C);
-      uint32_t access_time = xe::load_and_swap<uint16_t>(p + 0x3E);
-      p += 0x40;
-
-      StfsContainerEntry* parent_entry = nullptr;
-      if (path_indicator == 0xFFFF) {
-        parent_entry = root_entry;
-      } else {
-        parent_entry = all_entries[path_indicator];
-      }
-
-      std::string name(reinterpret_cast<const char*>(name_buffer),
-                       name_length_flags & 0x3F);
-      auto entry = StfsContainerEntry::Create(this, parent_entry, name, &mmap_);
-
-      // bit 0x40 = consecutive blocks (not fragmented?)
-      if (name_length_flags & 0x80) {
-        entry->attributes_ = kFileAttributeDirectory;
-      } else {
-        entry->attributes_ = kFileAttributeNormal | kFileAttributeReadOnly;
-        entry->data_offset_ = BlockToOffsetSTFS(start_block_index);
-        entry->data_size_ = file_size;
-      }
-      entry->size_ = file_size;
-      entry->allocation_size_ = xe::round_up(file_size, kSectorSize);
-
-      entry->create_timestamp_ = decode_fat_timestamp(update_date, update_time);
-      entry->access_timestamp_ = decode_fat_timestamp(access_date, access_time);
-      entry->write_timestamp_ = entry->create_timestamp_;
-
-      all_entries.push_back(entry.get());
-
-      // Fill in all block records.
-      // It's easier to do this now and just look them up later, at the cost
-      // of some memory. Nasty chain walk.
-      // TODO(benvanik): optimize if flag 0x40 (consecutive) is set.
-      if (entry->attributes() & X_FILE_ATTRIBUTE_NORMAL) {
-        uint32_t block_index = start_block_index;
-        size_t remaining_size = file_size;
-        uint32_t info = 0x80;
-        while (remaining_size && block_index && info >= 0x80) {
-          size_t block_size =
-              std::min(static_cast<size_t>(0x1000), remaining_size);
-          size_t offset = BlockToOffsetSTFS(block_index);
-          entry->block_list_.push_back({0, offset, block_size});
-          remaining_size -= block_size;
-          auto block_hash = GetBlockHash(data, block_index, 0);
-          if (table_size_shift_ && block_hash.info < 0x80) {
-            block_hash = GetBlockHash(data, block_index, 1);
-          }
-          block_index = block_hash.next_block_index;
-          info = block_hash.info;
-        }
-      }
-
-      parent_entry->children_.emplace_back(std::move(entry));
+      stfs_records_.push_back(record_offset);
     }
 
     auto block_hash = GetBlockHash(data, table_block_index, 0);
@@ -587,10 +553,122 @@ StfsContainerDevice::Error StfsContainerDevice::ReadSTFS() {
       break;
     }
   }
+  stfs_records_.shrink_to_fit();
+
+  // Group the records by parent, the root's children going last.
+  size_t record_count = stfs_records_.size();
+  std::vector<uint32_t> parents(record_count);
+  stfs_child_offsets_.assign(record_count + 2, 0);
+  for (size_t i = 0; i < record_count; i++) {
+    const uint8_t* p = data + stfs_records_[i];
+    uint16_t path_indicator = xe::load_and_swap<uint16_t>(p + 0x32);
+    // Parents must be directories, records are skipped otherwise.
+    size_t parent = record_count;
+    if (path_indicator != 0xFFFF) {
+      parent = path_indicator;
+      if (parent >= record_count || parent == i ||
+          !(data[stfs_records_[parent] + 0x28] & 0x80)) {
+        XELOGW("STFS file table record {} has an invalid parent {}", i,
+               path_indicator);
+        parent = record_count + 1;
+      }
+    }
+    parents[i] = uint32_t(parent);
+    if (parent <= record_count) {
+      stfs_child_offsets_[parent + 1]++;
+    }
+  }
+  for (size_t i = 1; i < stfs_child_offsets_.size(); i++) {
+    stfs_child_offsets_[i] += stfs_child_offsets_[i - 1];
+  }
+  stfs_children_.resize(stfs_child_offsets_.back());
+  std::vector<uint32_t> next_child(stfs_child_offsets_.begin(),
+                                   stfs_child_offsets_.end() - 1);
+  for (size_t i = 0; i < record_count; i++) {
+    if (parents[i] <= record_count) {
+      stfs_children_[next_child[parents[i]]++] = uint32_t(i);
+    }
+  }
 
+  auto root_entry = new StfsContainerEntry(this, nullptr, "", &mmap_);
+  root_entry->attributes_ = kFileAttributeDirectory;
+  root_entry->record_index_ = uint32_t(record_count);
+  root_entry_ = std::unique_ptr<Entry>(root_entry);
   return Error::kSuccess;
 }
 
+void StfsContainerDevice::ReadChildrenSTFS(StfsContainerEntry* parent) {
+  auto data = mmap_.at(0)->data();
+  uint32_t first_child = stfs_child_offsets_[parent->record_index_];
+  uint32_t last_child = stfs_child_offsets_[parent->record_index_ + 1];
+  parent->children_.reserve(last_child - first_child);
+  for (uint32_t i = first_child; i < last_child; i++) {
+    uint32_t record_index = stfs_children_[i];
+    const uint8_t* p = data + stfs_records_[record_index];
+    const uint8_t* name_buffer = p;  // 0x28b
+    uint8_t name_length_flags = xe::load_and_swap<uint8_t>(p + 0x28);
+    // TODO(benvanik): use for allocation_size_?
+    // uint32_t allocated_block_count = load_uint24_le(p + 0x29);
+    uint32_t start_block_index = load_uint24_le(p + 0x2F);
+    uint32_t file_size = xe::load_and_swap<uint32_t>(p + 0x34);
+
+    // both date and time parts of the timestamp are big endian
+    uint16_t update_date = xe::load_and_swap<uint16_t>(p + 0x38);
+    uint16_t update_time = xe::load_and_swap<uint16_t>(p + 0x3A);
+    uint32_t access_date = xe::load_and_swap<uint16_t>(p + 0x3C);
+    uint32_t access_time = xe::load_and_swap<uint16_t>(p + 0x3E);
+
+    std::string name(reinterpret_cast<const char*>(name_buffer),
+                     name_length_flags & 0x3F);
+    auto entry = StfsContainerEntry::Create(this, parent, name, &mmap_);
+    entry->record_index_ = record_index;
+
+    // bit 0x40 = consecutive blocks (not fragmented?)
+    if (name_length_flags & 0x80) {
+      entry->attributes_ = kFileAttributeDirectory;
+    } else {
+      entry->attributes_ = kFileAttributeNormal | kFileAttributeReadOnly;
+      entry->data_offset_ = BlockToOffsetSTFS(start_block_index);
+      entry->data_size_ = file_size;
+      entry->block_ = start_block_index;
+    }
+    entry->size_ = file_size;
+    entry->allocation_size_ = xe::round_up(file_size, kSectorSize);
+
+    entry->create_timestamp_ = decode_fat_timestamp(update_date, update_time);
+    entry->access_timestamp_ = decode_fat_timestamp(access_date, access_time);
+    entry->write_timestamp_ = entry->create_timestamp_;
+
+    parent->children_.emplace_back(std::move(entry));
+  }
+}
+
+void StfsContainerDevice::ReadBlockListSTFS(StfsContainerEntry* entry) {
+  // Nasty chain walk.
+  // TODO(benvanik): optimize if flag 0x40 (consecutive) is set.
+  auto data = mmap_.at(0)->data();
+  size_t data_size = mmap_.at(0)->size();
+  uint32_t block_index = uint32_t(entry->block_);
+  size_t remaining_size = entry->data_size_;
+  uint32_t info = 0x80;
+  while (remaining_size && block_index && info >= 0x80) {
+    size_t block_size = std::min(static_cast<size_t>(0x1000), remaining_size);
+    size_t offset = BlockToOffsetSTFS(block_index);
+    if (offset + block_size > data_size) {
+      XELOGE("STFS file {} extends past the package", entry->path());
+      break;
+    }
+    entry->block_list_.push_back({0, offset, block_size});
+    remaining_size -= block_size;
+    auto block_hash = GetBlockHash(data, block_index, 0);
+    if (table_size_shift_ && block_hash.info < 0x80) {
+      block_hash = GetBlockHash(data, block_index, 1);
+    }
+    block_index = block_hash.next_block_index;
+    info = block_hash.info;
+  }
+}
+
 size_t StfsContainerDevice::BlockToOffsetSTFS(uint64_t block_index) {
   uint64_t block;
   uint32_t block_shift = 0;
@@ -10,9 +10,9 @@
 #ifndef XENIA_VFS_DEVICES_STFS_CONTAINER_DEVICE_H_
 #define XENIA_VFS_DEVICES_STFS_CONTAINER_DEVICE_H_
 
-#include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "xenia/base/mapped_memory.h"
 #include "xenia/vfs/device.h"
@@ -186,6 +186,8 @@ class StfsContainerDevice : public Device {
   uint32_t bytes_per_sector() const override { return 0x200; }
 
  private:
+  friend class StfsContainerEntry;
+
   const uint32_t kSectorSize = 0x1000;
 
   enum class Error {
@@ -210,12 +212,20 @@ class StfsContainerDevice : public Device {
                                StfsPackageType* package_type_out);
   Error ReadHeaderAndVerify(const uint8_t* map_ptr, size_t map_size);
 
+  // Creates the entries of a directory when it's first listed.
+  void ReadChildren(StfsContainerEntry* parent);
+  // Builds the block records of a file when it's first opened.
+  void ReadBlockList(StfsContainerEntry* entry);
+
   Error ReadSVOD();
   Error ReadEntrySVOD(uint32_t sector, uint32_t ordinal,
                       StfsContainerEntry* parent);
   void BlockToOffsetSVOD(size_t sector, size_t* address, size_t* file_index);
+  void ReadBlockListSVOD(StfsContainerEntry* entry);
 
   Error ReadSTFS();
+  void ReadChildrenSTFS(StfsContainerEntry* parent);
+  void ReadBlockListSTFS(StfsContainerEntry* entry);
   size_t BlockToOffsetSTFS(uint64_t block);
 
   BlockHash GetBlockHash(const uint8_t* map_ptr, uint32_t block_index,
@@ -223,7 +233,7 @@ class StfsContainerDevice : public Device {
 
   std::string name_;
   std::filesystem::path host_path_;
-  std::map<size_t, std::unique_ptr<MappedMemory>> mmap_;
+  std::vector<std::unique_ptr<MappedMemory>> mmap_;
   size_t mmap_total_size_;
 
   size_t base_offset_;
@@ -232,6 +242,13 @@ class StfsContainerDevice : public Device {
   StfsPackageType package_type_;
   StfsHeader header_;
   uint32_t table_size_shift_;
+
+  // Offsets of the STFS file table records in the mapping, and the record
+  // indices of the children of each directory (and then the root) in file
+  // table order, as ranges of stfs_children_.
+  std::vector<size_t> stfs_records_;
+  std::vector<uint32_t> stfs_child_offsets_;
+  std::vector<uint32_t> stfs_children_;
 };
 
 }  // namespace vfs
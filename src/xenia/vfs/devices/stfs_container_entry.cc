@@ -9,9 +9,10 @@
 
 #include "xenia/vfs/devices/stfs_container_entry.h"
 #include "xenia/base/math.h"
+#include "xenia/vfs/devices/stfs_container_device.h"
 #include "xenia/vfs/devices/stfs_container_file.h"
 
-#include <map>
+#include <algorithm>
 
 namespace xe {
 namespace vfs {
@@ -23,7 +24,10 @@ StfsContainerEntry::StfsContainerEntry(Device* device, Entry* parent,
       mmap_(mmap),
       data_offset_(0),
       data_size_(0),
-      block_(0) {}
+      block_(0),
+      record_index_(0),
+      children_populated_(false),
+      block_list_populated_(false) {}
 
 StfsContainerEntry::~StfsContainerEntry() = default;
 
@@ -36,7 +40,65 @@ std::unique_ptr<StfsContainerEntry> StfsContainerEntry::Create(
   return std::move(entry);
 }
 
+void StfsContainerEntry::BuildBlockIndex() {
+  // STFS files are usually mostly consecutive, broken up by the hash tables.
+  size_t merged_count = 0;
+  for (size_t i = 0; i < block_list_.size(); ++i) {
+    const BlockRecord& record = block_list_[i];
+    if (merged_count) {
+      BlockRecord& last_record = block_list_[merged_count - 1];
+      if (last_record.file == record.file &&
+          last_record.offset + last_record.length == record.offset) {
+        last_record.length += record.length;
+        continue;
+      }
+    }
+    block_list_[merged_count++] = record;
+  }
+  block_list_.resize(merged_count);
+  block_list_.shrink_to_fit();
+
+  block_record_file_offsets_.resize(block_list_.size());
+  size_t file_offset = 0;
+  for (size_t i = 0; i < block_list_.size(); ++i) {
+    block_record_file_offsets_[i] = file_offset;
+    file_offset += block_list_[i].length;
+  }
+}
+
+size_t StfsContainerEntry::FindBlockRecord(size_t byte_offset) const {
+  // The last record starting at or before the offset.
+  auto it = std::upper_bound(block_record_file_offsets_.cbegin(),
+                             block_record_file_offsets_.cend(), byte_offset);
+  if (it == block_record_file_offsets_.cbegin()) {
+    return block_list_.size();
+  }
+  size_t index =
+      size_t(std::distance(block_record_file_offsets_.cbegin(), it)) - 1;
+  if (byte_offset - block_record_file_offsets_[index] >=
+      block_list_[index].length) {
+    return block_list_.size();
+  }
+  return index;
+}
+
+void StfsContainerEntry::EnsureChildrenPopulated() {
+  auto global_lock = global_critical_region_.Acquire();
+  if (children_populated_ || !(attributes_ & kFileAttributeDirectory)) {
+    return;
+  }
+  children_populated_ = true;
+  static_cast<StfsContainerDevice*>(device_)->ReadChildren(this);
+}
+
 X_STATUS StfsContainerEntry::Open(uint32_t desired_access, File** out_file) {
+  {
+    auto global_lock = global_critical_region_.Acquire();
+    if (!block_list_populated_) {
+      block_list_populated_ = true;
+      static_cast<StfsContainerDevice*>(device_)->ReadBlockList(this);
+    }
+  }
   *out_file = new StfsContainerFile(desired_access, this);
   return X_STATUS_SUCCESS;
 }
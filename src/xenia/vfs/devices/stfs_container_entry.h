@@ -10,7 +10,7 @@
 #ifndef XENIA_VFS_DEVICES_STFS_CONTAINER_ENTRY_H_
 #define XENIA_VFS_DEVICES_STFS_CONTAINER_ENTRY_H_
 
-#include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -20,7 +20,8 @@
 
 namespace xe {
 namespace vfs {
-typedef std::map<size_t, std::unique_ptr<MappedMemory>> MultifileMemoryMap;
+// One mapping per data file, shared by all entries of the device.
+typedef std::vector<std::unique_ptr<MappedMemory>> MultifileMemoryMap;
 
 class StfsContainerDevice;
 
@@ -49,14 +50,37 @@ class StfsContainerEntry : public Entry {
   };
   const std::vector<BlockRecord>& block_list() const { return block_list_; }
 
+  // Returns the index of the block record containing the byte offset within
+  // the file, or block_list().size() if it's past the end.
+  size_t FindBlockRecord(size_t byte_offset) const;
+  // Offset within the file of the first byte of the block record.
+  size_t block_record_file_offset(size_t index) const {
+    return block_record_file_offsets_[index];
+  }
+
+ protected:
+  void EnsureChildrenPopulated() override;
+
  private:
   friend class StfsContainerDevice;
 
+  // Merges physically contiguous block records into extents and builds the
+  // offset index. Must be called after block_list_ is populated.
+  void BuildBlockIndex();
+
   MultifileMemoryMap* mmap_;
   size_t data_offset_;
   size_t data_size_;
+  // First data block of files, or listing block of SVOD directories.
   size_t block_;
+  // Index of the STFS file table record, or the record count for the root.
+  uint32_t record_index_;
+  bool children_populated_;
+  // Block records are only built when the file is first opened.
+  bool block_list_populated_;
   std::vector<BlockRecord> block_list_;
+  // Prefix sums of the block record lengths, for binary searching.
+  std::vector<size_t> block_record_file_offsets_;
 };
 
 }  // namespace vfs
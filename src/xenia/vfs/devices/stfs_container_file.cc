@@ -18,6 +18,11 @@
 namespace xe {
 namespace vfs {
 
+// Reads at least this large hint the OS to read all the blocks involved
+// before copying, so they're fetched together rather than as each record's
+// pages fault.
+constexpr size_t kPrefetchMinLength = 64 * 1024;
+
 StfsContainerFile::StfsContainerFile(uint32_t file_access,
                                      StfsContainerEntry* entry)
     : File(file_access, entry), entry_(entry) {}
@@ -26,6 +31,25 @@ StfsContainerFile::~StfsContainerFile() = default;
 
 void StfsContainerFile::Destroy() { delete this; }
 
+void StfsContainerFile::PrefetchRange(size_t byte_offset, size_t length) {
+  const auto& block_list = entry_->block_list();
+  size_t first_record = entry_->FindBlockRecord(byte_offset);
+  if (first_record >= block_list.size()) {
+    return;
+  }
+  size_t src_offset = entry_->block_record_file_offset(first_record);
+  for (size_t i = first_record; i < block_list.size() && length; i++) {
+    auto& record = block_list[i];
+    size_t read_offset =
+        (byte_offset > src_offset) ? byte_offset - src_offset : 0;
+    size_t read_length = std::min(record.length - read_offset, length);
+    entry_->mmap()->at(record.file)->Prefetch(record.offset + read_offset,
+                                              read_length);
+    src_offset += record.length;
+    length -= read_length;
+  }
+}
+
 X_STATUS StfsContainerFile::ReadSync(void* buffer, size_t buffer_length,
                                      size_t byte_offset,
                                      size_t* out_bytes_read) {
@@ -39,14 +63,23 @@ X_STATUS StfsContainerFile::ReadSync(void* buffer, size_t buffer_length,
       std::min(buffer_length, entry_->size() - byte_offset);
   *out_bytes_read = remaining_length;
 
-  for (size_t i = 0; i < entry_->block_list().size(); i++) {
-    auto& record = entry_->block_list()[i];
-    if (src_offset + record.length <= byte_offset) {
-      // Doesn't begin in this region. Skip it.
-      src_offset += record.length;
-      continue;
-    }
+  const auto& block_list = entry_->block_list();
+  size_t first_record = entry_->FindBlockRecord(byte_offset);
+  if (first_record < block_list.size()) {
+    src_offset = entry_->block_record_file_offset(first_record);
+  }
+
+  if (remaining_length >= kPrefetchMinLength) {
+    PrefetchRange(byte_offset, remaining_length);
+  }
+  auto read_ahead =
+      read_ahead_.OnRead(byte_offset, remaining_length, entry_->size());
+  if (read_ahead.length) {
+    PrefetchRange(read_ahead.offset, read_ahead.length);
+  }
 
+  for (size_t i = first_record; i < block_list.size(); i++) {
+    auto& record = block_list[i];
     uint8_t* src = entry_->mmap()->at(record.file)->data();
 
     size_t read_offset =
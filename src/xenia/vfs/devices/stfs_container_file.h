@@ -11,6 +11,7 @@
 #define XENIA_VFS_DEVICES_STFS_CONTAINER_FILE_H_
 
 #include "xenia/vfs/file.h"
+#include "xenia/vfs/read_ahead.h"
 
 #include "xenia/xbox.h"
 
@@ -35,7 +36,11 @@ class StfsContainerFile : public File {
   X_STATUS SetLength(size_t length) override { return X_STATUS_ACCESS_DENIED; }
 
  private:
+  // Hints the OS to read the blocks backing the given range of the file.
+  void PrefetchRange(size_t byte_offset, size_t length);
+
   StfsContainerEntry* entry_;
+  ReadAheadPredictor read_ahead_;
 };
 
 }  // namespace vfs
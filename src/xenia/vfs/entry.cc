@@ -16,6 +16,8 @@
 namespace xe {
 namespace vfs {
 
+constexpr size_t kChildIndexMinCount = 16;
+
 Entry::Entry(Device* device, Entry* parent, const std::string_view path)
     : device_(device),
       parent_(parent),
@@ -39,6 +41,7 @@ void Entry::Dump(xe::StringBuffer* string_buffer, int indent) {
   }
   string_buffer->Append(name());
   string_buffer->Append('\n');
+  EnsureChildrenPopulated();
   for (auto& child : children_) {
     child->Dump(string_buffer, indent + 2);
   }
@@ -48,14 +51,34 @@ bool Entry::is_read_only() const { return device_->is_read_only(); }
 
 Entry* Entry::GetChild(const std::string_view name) {
   auto global_lock = global_critical_region_.Acquire();
-  auto it = std::find_if(children_.cbegin(), children_.cend(),
-                         [&](const auto& child) {
-                           return xe::utf8::equal_case(child->name(), name);
-                         });
-  if (it == children_.cend()) {
-    return nullptr;
+  EnsureChildrenPopulated();
+  // Small directories are faster to search without hashing.
+  if (children_.size() >= kChildIndexMinCount) {
+    UpdateChildIndex();
+    auto it = child_index_.find(string_key_case(name));
+    if (it != child_index_.end()) {
+      return it->second;
+    }
+  } else {
+    auto it = std::find_if(children_.cbegin(), children_.cend(),
+                           [&](const auto& child) {
+                             return xe::utf8::equal_case(child->name(), name);
+                           });
+    if (it != children_.cend()) {
+      return (*it).get();
+    }
+  }
+  return AddMissingChild(name);
+}
+
+void Entry::UpdateChildIndex() {
+  // Children are only ever appended, so only the new ones are added.
+  for (; child_index_count_ < children_.size(); ++child_index_count_) {
+    // The first child wins if names only differ in case, like in the linear
+    // search.
+    auto child = children_[child_index_count_].get();
+    child_index_.emplace(string_key_case(child->name()), child);
   }
-  return (*it).get();
 }
 
 Entry* Entry::ResolvePath(const std::string_view path) {
@@ -74,6 +97,7 @@ Entry* Entry::ResolvePath(const std::string_view path) {
 Entry* Entry::IterateChildren(const xe::filesystem::WildcardEngine& engine,
                               size_t* current_index) {
   auto global_lock = global_critical_region_.Acquire();
+  EnsureChildrenPopulated();
   while (*current_index < children_.size()) {
     auto& child = children_[*current_index];
     *current_index = *current_index + 1;
@@ -114,12 +138,33 @@ bool Entry::Delete(Entry* entry) {
   if (!DeleteEntryInternal(entry)) {
     return false;
   }
+  // The entry is destroyed when it's erased.
+  std::string name = entry->name();
+  bool indexed = child_index_count_ != 0;
+  if (indexed) {
+    UpdateChildIndex();
+    auto it = child_index_.find(string_key_case(name));
+    if (it != child_index_.end() && it->second == entry) {
+      child_index_.erase(it);
+    }
+  }
   for (auto it = children_.begin(); it != children_.end(); ++it) {
     if (it->get() == entry) {
       children_.erase(it);
       break;
     }
   }
+  if (indexed) {
+    // Another child may have the same name in a different case.
+    auto it = std::find_if(children_.cbegin(), children_.cend(),
+                           [&](const auto& child) {
+                             return xe::utf8::equal_case(child->name(), name);
+                           });
+    if (it != children_.cend()) {
+      child_index_.emplace(string_key_case((*it)->name()), it->get());
+    }
+    child_index_count_ = children_.size();
+  }
   Touch();
   return true;
 }
@@ -12,6 +12,7 @@
 
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "xenia/base/filesystem.h"
@@ -19,6 +20,7 @@
 #include "xenia/base/mapped_memory.h"
 #include "xenia/base/mutex.h"
 #include "xenia/base/string_buffer.h"
+#include "xenia/base/string_key.h"
 #include "xenia/xbox.h"
 
 namespace xe {
@@ -99,10 +101,14 @@ class Entry {
   Entry* GetChild(const std::string_view name);
   Entry* ResolvePath(const std::string_view path);
 
-  const std::vector<std::unique_ptr<Entry>>& children() const {
+  const std::vector<std::unique_ptr<Entry>>& children() {
+    EnsureChildrenPopulated();
     return children_;
   }
-  size_t child_count() const { return children_.size(); }
+  size_t child_count() {
+    EnsureChildrenPopulated();
+    return children_.size();
+  }
   Entry* IterateChildren(const xe::filesystem::WildcardEngine& engine,
                          size_t* current_index);
 
@@ -131,6 +137,15 @@ class Entry {
     return nullptr;
   }
   virtual bool DeleteEntryInternal(Entry* entry) { return false; }
+  // Called before the children are accessed, for devices populating
+  // directories on first use.
+  virtual void EnsureChildrenPopulated() {}
+  // Called when GetChild doesn't find the name, for devices whose backing
+  // storage may have gained the child since the directory was populated.
+  // Returns the child after appending it to children_, or nullptr.
+  virtual Entry* AddMissingChild(const std::string_view name) {
+    return nullptr;
+  }
 
   xe::global_critical_region global_critical_region_;
   Device* device_;
@@ -145,6 +160,14 @@ class Entry {
   uint64_t access_timestamp_;
   uint64_t write_timestamp_;
   std::vector<std::unique_ptr<Entry>> children_;
+
+ private:
+  // Case-insensitive name lookup for directories with many children. Devices
+  // append to children_ directly while populating, so the children past
+  // child_index_count_ are added lazily. Deletion updates it in place.
+  void UpdateChildIndex();
+  std::unordered_map<string_key_case, Entry*> child_index_;
+  size_t child_index_count_ = 0;
 };
 
 }  // namespace vfs
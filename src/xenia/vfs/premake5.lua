@@ -13,6 +13,7 @@ project("xenia-vfs")
   })
   recursive_platform_files()
   removefiles({"vfs_dump.cc"})
+  removefiles({"vfs_read_replay.cc"})
 
 project("xenia-vfs-dump")
   uuid("2EF270C7-41A8-4D0E-ACC5-59693A9CCE32")
@@ -33,3 +34,22 @@ project("xenia-vfs-dump")
     project_root,
   })
 
+
+project("xenia-vfs-read-replay")
+  uuid("8d4a3f5e-6c1b-4f2a-9e7d-3b5c1a2f4e60")
+  kind("ConsoleApp")
+  language("C++")
+  links({
+    "fmt",
+    "xenia-base",
+    "xenia-vfs",
+  })
+  defines({})
+
+  files({
+    "vfs_read_replay.cc",
+    project_root.."/src/xenia/base/main_"..platform_suffix..".cc",
+  })
+  resincludedirs({
+    project_root,
+  })
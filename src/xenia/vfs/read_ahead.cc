@@ -0,0 +1,110 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/vfs/read_ahead.h"
+
+#include <algorithm>
+
+#include "xenia/base/cvar.h"
+
+DEFINE_bool(vfs_read_ahead, true,
+            "Prefetch the predicted next ranges of sequential and strided "
+            "reads from disc images and STFS packages.",
+            "VFS");
+
+namespace xe {
+namespace vfs {
+
+ReadAheadPredictor::Stats ReadAheadPredictor::stats_;
+
+bool ReadAheadPredictor::is_enabled() { return cvars::vfs_read_ahead; }
+
+void ReadAheadPredictor::ResetStats() {
+  stats_.read_count = 0;
+  stats_.read_bytes = 0;
+  stats_.prefetch_count = 0;
+  stats_.prefetch_bytes = 0;
+  stats_.predicted_read_count = 0;
+  stats_.predicted_read_bytes = 0;
+}
+
+ReadAheadPredictor::Range ReadAheadPredictor::OnRead(size_t offset,
+                                                     size_t length,
+                                                     size_t file_size) {
+  stats_.read_count.fetch_add(1, std::memory_order_relaxed);
+  stats_.read_bytes.fetch_add(length, std::memory_order_relaxed);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (length && offset >= prefetched_begin_ &&
+      offset + length <= prefetched_end_) {
+    stats_.predicted_read_count.fetch_add(1, std::memory_order_relaxed);
+    stats_.predicted_read_bytes.fetch_add(length, std::memory_order_relaxed);
+  }
+
+  bool sequential = false;
+  if (has_last_read_) {
+    int64_t stride = int64_t(offset) - int64_t(last_offset_);
+    if (offset == last_offset_ + last_length_) {
+      // Lengths may vary between sequential reads.
+      sequential = true;
+      ++run_length_;
+    } else if (stride && stride == stride_) {
+      ++run_length_;
+    } else {
+      run_length_ = 0;
+      window_length_ = 0;
+    }
+    stride_ = stride;
+  }
+  has_last_read_ = true;
+  last_offset_ = offset;
+  last_length_ = length;
+
+  if (!length || run_length_ < kMinRunLength || !is_enabled()) {
+    return {0, 0};
+  }
+
+  size_t begin, end;
+  if (sequential) {
+    size_t next_offset = offset + length;
+    window_length_ = std::max(
+        length, window_length_ ? std::min(window_length_ * 2, kMaxWindowLength)
+                               : length);
+    begin = next_offset;
+    end = next_offset + window_length_;
+    if (begin >= prefetched_begin_ && begin < prefetched_end_) {
+      // Only extend the window once half of what's ahead has been read, so
+      // streaming in small chunks doesn't issue a hint per read.
+      if (prefetched_end_ - begin > window_length_ / 2) {
+        return {0, 0};
+      }
+      begin = prefetched_end_;
+    }
+    prefetched_begin_ = next_offset;
+  } else {
+    if (stride_ < 0 && size_t(-stride_) > offset) {
+      return {0, 0};
+    }
+    begin = offset + stride_;
+    end = begin + length;
+    prefetched_begin_ = begin;
+  }
+  end = std::min(end, file_size);
+  if (begin >= end) {
+    return {0, 0};
+  }
+  prefetched_end_ = end;
+
+  stats_.prefetch_count.fetch_add(1, std::memory_order_relaxed);
+  stats_.prefetch_bytes.fetch_add(end - begin, std::memory_order_relaxed);
+  return {begin, end - begin};
+}
+
+}  // namespace vfs
+}  // namespace xe
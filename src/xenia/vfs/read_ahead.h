@@ -0,0 +1,73 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_VFS_READ_AHEAD_H_
+#define XENIA_VFS_READ_AHEAD_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace xe {
+namespace vfs {
+
+// Watches the reads made through one open file for sequential or strided
+// patterns and predicts the range that will be read next, so that devices
+// backed by a mapped image can prefetch it before the guest faults on it.
+class ReadAheadPredictor {
+ public:
+  struct Range {
+    size_t offset;
+    size_t length;
+  };
+
+  // Process-wide counters, summed over all files.
+  struct Stats {
+    std::atomic<uint64_t> read_count;
+    std::atomic<uint64_t> read_bytes;
+    std::atomic<uint64_t> prefetch_count;
+    std::atomic<uint64_t> prefetch_bytes;
+    // Reads that were entirely inside a range prefetched earlier. Their pages
+    // would otherwise have been faulted in from storage by the copy.
+    std::atomic<uint64_t> predicted_read_count;
+    std::atomic<uint64_t> predicted_read_bytes;
+  };
+
+  static bool is_enabled();
+  static Stats& stats() { return stats_; }
+  static void ResetStats();
+
+  // Records a read of the file and returns the range to prefetch next, which
+  // is empty if there's no pattern yet or it's already been prefetched.
+  Range OnRead(size_t offset, size_t length, size_t file_size);
+
+ private:
+  // Reads needed to match a pattern before anything is prefetched.
+  static constexpr uint32_t kMinRunLength = 2;
+  // The sequential window starts at the read length and doubles up to this.
+  static constexpr size_t kMaxWindowLength = 4 * 1024 * 1024;
+
+  static Stats stats_;
+
+  std::mutex mutex_;
+  bool has_last_read_ = false;
+  size_t last_offset_ = 0;
+  size_t last_length_ = 0;
+  int64_t stride_ = 0;
+  uint32_t run_length_ = 0;
+  size_t window_length_ = 0;
+  size_t prefetched_begin_ = 0;
+  size_t prefetched_end_ = 0;
+};
+
+}  // namespace vfs
+}  // namespace xe
+
+#endif  // XENIA_VFS_READ_AHEAD_H_
@@ -0,0 +1,177 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2020 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "third_party/fmt/include/fmt/format.h"
+#include "xenia/base/clock.h"
+#include "xenia/base/filesystem.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/main.h"
+#include "xenia/base/utf8.h"
+#include "xenia/vfs/devices/disc_image_device.h"
+#include "xenia/vfs/devices/stfs_container_device.h"
+#include "xenia/vfs/file.h"
+#include "xenia/vfs/read_ahead.h"
+
+DEFINE_transient_path(source, "",
+                      "Disc image (.iso) or STFS package to read from.",
+                      "General");
+DEFINE_transient_path(trace_file, "",
+                      "Read trace to replay, with one 'path offset length' "
+                      "line per read and paths relative to the image root.",
+                      "General");
+DEFINE_int32(replay_iterations, 1,
+             "Number of times to replay the trace. Only the first can see a "
+             "cold page cache.",
+             "General");
+
+namespace xe {
+namespace vfs {
+
+struct ReplayRead {
+  std::string path;
+  size_t offset;
+  size_t length;
+};
+
+static bool LoadTrace(const std::filesystem::path& path,
+                      std::vector<ReplayRead>* out_reads) {
+  auto file = xe::filesystem::OpenFile(path, "rt");
+  if (!file) {
+    return false;
+  }
+  char line[1024];
+  while (fgets(line, sizeof(line), file)) {
+    std::string_view line_view(line);
+    while (!line_view.empty() &&
+           (line_view.back() == '\n' || line_view.back() == '\r')) {
+      line_view.remove_suffix(1);
+    }
+    // Paths may contain spaces, so the numbers are taken from the end.
+    auto length_start = line_view.find_last_of(' ');
+    if (line_view.empty() || line_view[0] == '#' ||
+        length_start == std::string_view::npos) {
+      continue;
+    }
+    auto offset_start = line_view.find_last_of(' ', length_start - 1);
+    if (offset_start == std::string_view::npos) {
+      continue;
+    }
+    ReplayRead read;
+    read.path = std::string(line_view.substr(0, offset_start));
+    read.offset = size_t(std::strtoull(
+        std::string(line_view.substr(offset_start + 1)).c_str(), nullptr, 0));
+    read.length = size_t(std::strtoull(
+        std::string(line_view.substr(length_start + 1)).c_str(), nullptr, 0));
+    out_reads->push_back(std::move(read));
+  }
+  fclose(file);
+  return true;
+}
+
+int vfs_read_replay_main(const std::vector<std::string>& args) {
+  if (cvars::source.empty() || cvars::trace_file.empty()) {
+    XELOGE("Usage: {} [--vfs_read_ahead=false] [source] [trace_file]",
+           xe::path_to_utf8(args[0]));
+    return 1;
+  }
+
+  std::vector<ReplayRead> reads;
+  if (!LoadTrace(cvars::trace_file, &reads)) {
+    XELOGE("Failed to open {}", xe::path_to_utf8(cvars::trace_file));
+    return 1;
+  }
+
+  std::unique_ptr<Device> device;
+  auto extension = xe::utf8::lower_ascii(
+      xe::path_to_utf8(cvars::source.extension()));
+  if (extension == ".iso") {
+    device = std::make_unique<DiscImageDevice>("", cvars::source);
+  } else {
+    device = std::make_unique<StfsContainerDevice>("", cvars::source);
+  }
+  if (!device->Initialize()) {
+    XELOGE("Failed to initialize device");
+    return 1;
+  }
+
+  // Files stay open across the whole replay so that each keeps its access
+  // pattern history, as they would in a game.
+  std::unordered_map<std::string, File*> files;
+  size_t max_length = 0;
+  for (auto& read : reads) {
+    max_length = std::max(max_length, read.length);
+    if (files.count(read.path)) {
+      continue;
+    }
+    auto entry = device->ResolvePath(read.path);
+    File* file = nullptr;
+    if (!entry ||
+        entry->Open(FileAccess::kFileReadData, &file) != X_STATUS_SUCCESS) {
+      XELOGE("Failed to open {} in the image", read.path);
+      return 1;
+    }
+    files.emplace(read.path, file);
+  }
+  std::vector<uint8_t> buffer(max_length);
+
+  fmt::print("{:>4} {:>10} {:>10} {:>10} {:>12} {:>10}\n", "run", "ms",
+             "reads", "MB/s", "predicted", "prefetches");
+  for (int32_t i = 0; i < cvars::replay_iterations; ++i) {
+    ReadAheadPredictor::ResetStats();
+    uint64_t read_bytes = 0;
+    uint64_t start_ticks = Clock::QueryHostTickCount();
+    for (auto& read : reads) {
+      size_t bytes_read = 0;
+      if (files[read.path]->ReadSync(buffer.data(), read.length, read.offset,
+                                     &bytes_read) == X_STATUS_SUCCESS) {
+        read_bytes += bytes_read;
+      }
+    }
+    uint64_t end_ticks = Clock::QueryHostTickCount();
+    double seconds = double(end_ticks - start_ticks) /
+                     double(Clock::QueryHostTickFrequency());
+    auto& stats = ReadAheadPredictor::stats();
+    fmt::print("{:>4} {:>10.3f} {:>10} {:>10.2f} {:>12} {:>10}\n", i,
+               seconds * 1000.0, reads.size(),
+               read_bytes / seconds / (1024.0 * 1024.0),
+               stats.predicted_read_count.load(),
+               stats.prefetch_count.load());
+  }
+
+  // Predicted reads were prefetched in full, so none of their pages had to
+  // be faulted in from storage by the copy.
+  auto& stats = ReadAheadPredictor::stats();
+  fmt::print(
+      "last run: {} of {} reads ({:.2f} of {:.2f} MB) predicted, {:.2f} MB "
+      "prefetched in {} hints\n",
+      stats.predicted_read_count.load(), stats.read_count.load(),
+      stats.predicted_read_bytes / (1024.0 * 1024.0),
+      stats.read_bytes / (1024.0 * 1024.0),
+      stats.prefetch_bytes / (1024.0 * 1024.0), stats.prefetch_count.load());
+
+  for (auto& it : files) {
+    it.second->Destroy();
+  }
+  return 0;
+}
+
+}  // namespace vfs
+}  // namespace xe
+
+DEFINE_ENTRY_POINT("xenia-vfs-read-replay", xe::vfs::vfs_read_replay_main,
+                   "[--vfs_read_ahead=false] [source] [trace_file]", "source",
+                   "trace_file");
@@ -16,6 +16,10 @@
 namespace xe {
 namespace vfs {
 
+// The cache is cleared when full, as paths are usually reused within a phase
+// of a title (level loading, etc.).
+constexpr size_t kMaxResolvedPathCacheSize = 4096;
+
 VirtualFileSystem::VirtualFileSystem() {}
 
 VirtualFileSystem::~VirtualFileSystem() {
@@ -28,6 +32,7 @@ VirtualFileSystem::~VirtualFileSystem() {
 bool VirtualFileSystem::RegisterDevice(std::unique_ptr<Device> device) {
   auto global_lock = global_critical_region_.Acquire();
   devices_.emplace_back(std::move(device));
+  ClearResolvedPathCache();
   return true;
 }
 
@@ -36,6 +41,9 @@ bool VirtualFileSystem::UnregisterDevice(const std::string_view path) {
   for (auto it = devices_.begin(); it != devices_.end(); ++it) {
     if ((*it)->mount_path() == path) {
       XELOGD("Unregistered device: {}", (*it)->mount_path());
+      // Cache hits don't take the global lock, so the entries must be out of
+      // the cache before they're destroyed.
+      ClearResolvedPathCache();
       devices_.erase(it);
       return true;
     }
@@ -47,6 +55,7 @@ bool VirtualFileSystem::RegisterSymbolicLink(const std::string_view path,
                                              const std::string_view target) {
   auto global_lock = global_critical_region_.Acquire();
   symlinks_.insert({std::string(path), std::string(target)});
+  ClearResolvedPathCache();
   XELOGD("Registered symbolic link: {} => {}", path, target);
 
   return true;
@@ -63,6 +72,7 @@ bool VirtualFileSystem::UnregisterSymbolicLink(const std::string_view path) {
   XELOGD("Unregistered symbolic link: {} => {}", it->first, it->second);
 
   symlinks_.erase(it);
+  ClearResolvedPathCache();
   return true;
 }
 
@@ -99,7 +109,23 @@ bool VirtualFileSystem::ResolveSymbolicLink(const std::string_view path,
   return was_resolved;
 }
 
+void VirtualFileSystem::ClearResolvedPathCache() {
+  std::lock_guard<std::mutex> lock(resolved_path_cache_mutex_);
+  resolved_path_cache_.clear();
+  ++resolved_path_cache_generation_;
+}
+
 Entry* VirtualFileSystem::ResolvePath(const std::string_view path) {
+  uint64_t cache_generation;
+  {
+    std::lock_guard<std::mutex> lock(resolved_path_cache_mutex_);
+    auto it = resolved_path_cache_.find(string_key(path));
+    if (it != resolved_path_cache_.end()) {
+      return it->second;
+    }
+    cache_generation = resolved_path_cache_generation_;
+  }
+
   auto global_lock = global_critical_region_.Acquire();
 
   // Resolve relative paths
@@ -123,7 +149,17 @@ Entry* VirtualFileSystem::ResolvePath(const std::string_view path) {
 
   const auto& device = *it;
   auto relative_path = normalized_path.substr(device->mount_path().size());
-  return device->ResolvePath(relative_path);
+  Entry* entry = device->ResolvePath(relative_path);
+  if (entry) {
+    std::lock_guard<std::mutex> lock(resolved_path_cache_mutex_);
+    if (resolved_path_cache_generation_ == cache_generation) {
+      if (resolved_path_cache_.size() >= kMaxResolvedPathCacheSize) {
+        resolved_path_cache_.clear();
+      }
+      resolved_path_cache_.emplace(string_key::create(path), entry);
+    }
+  }
+  return entry;
 }
 
 Entry* VirtualFileSystem::CreatePath(const std::string_view path,
@@ -160,12 +196,21 @@ bool VirtualFileSystem::DeletePath(const std::string_view path) {
   if (!entry) {
     return false;
   }
-  auto parent = entry->parent();
-  if (!parent) {
+  if (!entry->parent()) {
     // Can't delete root.
     return false;
   }
-  return parent->Delete(entry);
+  return DeleteEntry(entry);
+}
+
+bool VirtualFileSystem::DeleteEntry(Entry* entry) {
+  // Cache hits don't take the global lock, so the entry must be out of the
+  // cache before it's destroyed. Holding the lock across both keeps a racing
+  // ResolvePath from caching it again, as it resolves under the lock and only
+  // caches if the generation hasn't changed.
+  auto global_lock = global_critical_region_.Acquire();
+  ClearResolvedPathCache();
+  return entry->Delete();
 }
 
 X_STATUS VirtualFileSystem::OpenFile(Entry* root_entry,
@@ -257,7 +302,7 @@ X_STATUS VirtualFileSystem::OpenFile(Entry* root_entry,
         return X_STATUS_ACCESS_DENIED;
       case FileDisposition::kSuperscede:
         // Replace (by delete + recreate).
-        if (!entry->Delete()) {
+        if (!DeleteEntry(entry)) {
           return X_STATUS_ACCESS_DENIED;
         }
         entry = nullptr;
@@ -271,7 +316,7 @@ X_STATUS VirtualFileSystem::OpenFile(Entry* root_entry,
       case FileDisposition::kOverwrite:
       case FileDisposition::kOverwriteIf:
         // Overwrite (we do by delete + recreate).
-        if (!entry->Delete()) {
+        if (!DeleteEntry(entry)) {
           return X_STATUS_ACCESS_DENIED;
         }
         entry = nullptr;
@@ -11,11 +11,13 @@
 #define XENIA_VFS_VIRTUAL_FILE_SYSTEM_H_
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
 #include "xenia/base/mutex.h"
+#include "xenia/base/string_key.h"
 #include "xenia/vfs/device.h"
 #include "xenia/vfs/entry.h"
 #include "xenia/vfs/file.h"
@@ -51,7 +53,18 @@ class VirtualFileSystem {
   std::vector<std::unique_ptr<Device>> devices_;
   std::unordered_map<std::string, std::string> symlinks_;
 
+  // Successfully resolved paths as passed to ResolvePath, checked without
+  // taking the global lock. Cleared whenever an entry may be destroyed or a
+  // path may resolve differently.
+  std::mutex resolved_path_cache_mutex_;
+  std::unordered_map<string_key, Entry*> resolved_path_cache_;
+  // Incremented on every clear, so that a resolution racing with a clear
+  // doesn't insert a stale entry.
+  uint64_t resolved_path_cache_generation_ = 0;
+
   bool ResolveSymbolicLink(const std::string_view path, std::string& result);
+  void ClearResolvedPathCache();
+  bool DeleteEntry(Entry* entry);
 };
 
 }  // namespace vfs